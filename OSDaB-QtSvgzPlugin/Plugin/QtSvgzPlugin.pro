@@ -14,5 +14,9 @@ QMAKE_TARGET_PRODUCT = QtSvgzPlugin
 QMAKE_TARGET_COPYRIGHT = Copyright (C) 2007 Angius Fabrizio - GNU GPL v2 or later
 QMAKE_TARGET_DESCRIPTION = SVGZ icon engine plugin for Qt4.
 
-HEADERS += qtsvgz_plugin.h qtsvgz_engine.h
-SOURCES += qtsvgz_plugin.cpp qtsvgz_engine.cpp
\ No newline at end of file
+HEADERS += qtsvgz_plugin.h qtsvgz_engine.h gzbackend.h
+SOURCES += qtsvgz_plugin.cpp qtsvgz_engine.cpp
+
+# Optional faster deflate backends (see the comments in the sources)
+# DEFINES += OSDAB_ZLIB_NG OSDAB_LIBDEFLATE
+# LIBS += -lz-ng -ldeflate
\ No newline at end of file
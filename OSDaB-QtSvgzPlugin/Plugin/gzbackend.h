@@ -0,0 +1,95 @@
+/**************************************************************************
+** Filename: gzbackend.h
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**************************************************************************/
+
+#ifndef OSDAB_GZBACKEND__H
+#define OSDAB_GZBACKEND__H
+
+/*!
+	Deflate backend of the SVGZ icon engine.
+
+	#define OSDAB_ZLIB_NG to use the native zlib-ng API (link libz-ng) instead of zlib
+	and OSDAB_LIBDEFLATE to decompress files up to GZ_WHOLE_FILE_LIMIT bytes in one
+	go with libdeflate (link libdeflate). Both select the best code for the CPU at
+	run time.
+*/
+// #define OSDAB_ZLIB_NG
+// #define OSDAB_LIBDEFLATE
+
+#ifdef OSDAB_ZLIB_NG
+#include <zlib-ng.h>
+typedef zng_stream gz_z_stream;
+typedef unsigned int uInt;
+typedef unsigned char Bytef;
+#define GZ_Z(f) zng_##f
+#else
+#include "zlib/zlib.h"
+typedef z_stream gz_z_stream;
+#define GZ_Z(f) f
+#endif
+
+#ifdef OSDAB_LIBDEFLATE
+#include <libdeflate.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+
+#define GZ_WHOLE_FILE_LIMIT (64*1024*1024)
+
+/*!
+	Decompresses a whole single member gzip file with libdeflate.
+	Returns false if the file is too big or could not be decoded, in which
+	case the (streaming) zlib code should be used.
+*/
+static inline bool inflateWholeFile(QFile& file, QByteArray& out)
+{
+	// gzip header (10 bytes) + trailer (8 bytes)
+	const qint64 compressedSize = file.size();
+	if (compressedSize < 18 || compressedSize > GZ_WHOLE_FILE_LIMIT)
+		return false;
+
+	const QByteArray in = file.readAll();
+	if (in.size() != compressedSize)
+		return false;
+
+	// ISIZE: uncompressed size modulo 2^32 (last 4 bytes, little endian)
+	const unsigned char* trailer = (const unsigned char*) in.constData() + in.size() - 4;
+	const quint32 uncompressedSize = trailer[0] | (trailer[1] << 8)
+		| (trailer[2] << 16) | ((quint32) trailer[3] << 24);
+	if (uncompressedSize > GZ_WHOLE_FILE_LIMIT)
+		return false;
+
+	libdeflate_decompressor* d = libdeflate_alloc_decompressor();
+	if (!d)
+		return false;
+
+	out.resize(uncompressedSize);
+	size_t actualSize = 0;
+	const libdeflate_result res = libdeflate_gzip_decompress(d, in.constData(), in.size(),
+		out.data(), out.size(), &actualSize);
+	libdeflate_free_decompressor(d);
+
+	if (res != LIBDEFLATE_SUCCESS || actualSize != uncompressedSize) {
+		out.clear();
+		return false;
+	}
+	return true;
+}
+#endif // OSDAB_LIBDEFLATE
+
+#endif // OSDAB_GZBACKEND__H
@@ -19,7 +19,6 @@
 **************************************************************************/
 
 #include "qtsvgz_engine.h"
-#include "zlib/zlib.h"
 #include <QIcon>
 #include <QPainter>
 #include <QPixmap>
@@ -33,6 +32,8 @@
 #include <QBuffer>
 #include <QtDebug>
 
+#include "gzbackend.h"
+
 #define GZ_READ_BUFFER (256*1024)
 
 #define GZ_OK 0
@@ -78,6 +79,18 @@ public:
 			return GZ_FILE_OPEN_ERROR;
 		}
 
+#ifdef OSDAB_LIBDEFLATE
+		QByteArray whole;
+		if (inflateWholeFile(file, whole)) {
+			if (output->write(whole) != whole.size()) {
+				qDebug("Write error");
+				return GZ_WRITE_ERROR;
+			}
+			return GZ_OK;
+		}
+		file.seek(0);
+#endif
+
 		quint64 compressedSize = file.size();
 
 		uInt rep = compressedSize / GZ_READ_BUFFER;
@@ -91,7 +104,7 @@ public:
 		char buffer2[GZ_READ_BUFFER];
 
 		/* Allocate inflate state */
-		z_stream zstr;
+		gz_z_stream zstr;
 		zstr.zalloc = Z_NULL;
 		zstr.zfree = Z_NULL;
 		zstr.opaque = Z_NULL;
@@ -107,7 +120,7 @@ public:
 			return a Z_DATA_ERROR.  If a gzip stream is being decoded, strm->adler is
 			a crc32 instead of an adler32.
 		*/
-		if ( (zret = inflateInit2_(&zstr, MAX_WBITS + 16, ZLIB_VERSION, sizeof(z_stream))) != Z_OK ) {
+		if ( (zret = GZ_Z(inflateInit2)(&zstr, MAX_WBITS + 16)) != Z_OK ) {
 			qDebug("Failed to initialize zlib");
 			return GZ_INVALID_STREAM;
 		}
@@ -120,7 +133,7 @@ public:
 			if (read == 0)
 				break;
 			if (read < 0) {
-				(void)inflateEnd(&zstr);
+				(void)GZ_Z(inflateEnd)(&zstr);
 				qDebug("Read error");
 				return GZ_READ_ERROR;
 			}
@@ -137,13 +150,13 @@ public:
 				zstr.avail_out = GZ_READ_BUFFER;
 				zstr.next_out = (Bytef*) buffer2;;
 
-				zret = inflate(&zstr, Z_NO_FLUSH);
+				zret = GZ_Z(inflate)(&zstr, Z_NO_FLUSH);
 
 				switch (zret) {
 					case Z_NEED_DICT:
 					case Z_DATA_ERROR:
 					case Z_MEM_ERROR:
-						inflateEnd(&zstr);
+						GZ_Z(inflateEnd)(&zstr);
 						qDebug("zlib failed to decode file");
 						return GZ_INVALID_STREAM;
 					default:
@@ -152,7 +165,7 @@ public:
 
 				szDecomp = GZ_READ_BUFFER - zstr.avail_out;
 				if (output->write(buffer2, szDecomp) != szDecomp) {
-					inflateEnd(&zstr);
+					GZ_Z(inflateEnd)(&zstr);
 					qDebug("Write error");
 					return GZ_WRITE_ERROR;
 				}
@@ -161,7 +174,7 @@ public:
 
 		} while (zret != Z_STREAM_END);
 
-		inflateEnd(&zstr);
+		GZ_Z(inflateEnd)(&zstr);
 
 		return GZ_OK;
 	}
@@ -0,0 +1,704 @@
+/****************************************************************************
+** Filename: main.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Benchmark for the Zip and UnZip classes on reproducible synthetic corpora.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zip.h"
+#include "unzip.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#ifdef OSDAB_NAMESPACE
+using namespace Osdab::Zip;
+#endif
+
+using namespace std;
+
+/*!
+    Bump this when the corpora change so that old corpora are generated again
+    and results of different versions are not compared.
+*/
+#define BENCH_CORPUS_VERSION 1
+
+//! Corpora are written in chunks of this size
+#define BENCH_CHUNK (1024*1024)
+
+namespace {
+
+//! xorshift64* generator: the corpora must be the same on every run and platform.
+class Random
+{
+public:
+    explicit Random(quint64 seed) : s(seed ? seed : 1) {}
+
+    quint64 next()
+    {
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+        return s * Q_UINT64_C(2685821657736338717);
+    }
+
+    //! Returns a number in [min, max].
+    qint64 range(qint64 min, qint64 max)
+    {
+        return min + qint64(next() % quint64(max - min + 1));
+    }
+
+private:
+    quint64 s;
+};
+
+enum Content
+{
+    //! Words and punctuation, compresses about 3:1
+    Text,
+    //! Fixed size records with counters and a few random bytes
+    Records,
+    //! Random byte runs, like uncompressed bitmaps
+    Runs,
+    //! Incompressible
+    Noise
+};
+
+struct Corpus
+{
+    QString name;
+    QString path;
+    int files;
+    qint64 bytes;
+};
+
+struct Options
+{
+    QString workDir;
+    QString output;
+    double scale;
+    QList<int> threads;
+    QList<int> levels;
+    QStringList corpora;
+    int repeat;
+    bool keep;
+};
+
+//! Adds a share of the files of a corpus to an archive in concurrent mode.
+class AddThread : public QThread
+{
+public:
+    AddThread(Zip* z, const QStringList& p, Zip::CompressionLevel l) :
+        zip(z), paths(p), level(l), ec(Zip::Ok) {}
+
+    inline Zip::ErrorCode result() const { return ec; }
+
+protected:
+    void run() { ec = zip->addFiles(paths, QString(), Zip::RelativePaths, level); }
+
+private:
+    Zip* zip;
+    QStringList paths;
+    Zip::CompressionLevel level;
+    Zip::ErrorCode ec;
+};
+
+const char* const words[] = {
+    "the", "archive", "entry", "central", "directory", "header", "data", "file",
+    "compressed", "size", "offset", "local", "record", "of", "and", "to", "in",
+    "is", "a", "with", "for", "zip", "deflate", "stream", "buffer", "window",
+    "OSDaB", "Qt", "QString", "int", "return", "const", "void", "0x04034b50"
+};
+const int wordCount = sizeof(words) / sizeof(words[0]);
+
+void fill(QByteArray& data, Content content, Random& rng)
+{
+    char* p = data.data();
+    const int size = data.size();
+    int i = 0;
+
+    switch (content) {
+    case Text:
+        while (i < size) {
+            const char* w = words[rng.range(0, wordCount - 1)];
+            while (*w && i < size)
+                p[i++] = *w++;
+            if (i < size) {
+                const qint64 r = rng.range(0, 15);
+                p[i++] = r == 0 ? '\n' : r == 1 ? '.' : r == 2 ? ',' : ' ';
+            }
+        }
+        break;
+    case Records:
+        while (i < size) {
+            char record[64];
+            const quint64 n = rng.next();
+            memset(record, ' ', sizeof(record));
+            // counter, "timestamp" and 8 random bytes
+            const quint64 counter = quint64(i / 64);
+            const quint64 timestamp = Q_UINT64_C(1500000000) + i / 640;
+            for (int j = 0; j < 8; ++j) {
+                record[j] = char(counter >> (j * 8));
+                record[8 + j] = char(timestamp >> (j * 8));
+                record[56 + j] = char(n >> (j * 8));
+            }
+            memcpy(record + 16, "sensor=42;unit=mV;status=OK;", 28);
+            const int len = qMin<int>(sizeof(record), size - i);
+            memcpy(p + i, record, len);
+            i += len;
+        }
+        break;
+    case Runs:
+        while (i < size) {
+            const int len = qMin<int>(int(rng.range(1, 512)), size - i);
+            memset(p + i, int(rng.next() & 0xFF), len);
+            i += len;
+        }
+        break;
+    case Noise:
+        for (; i + 8 <= size; i += 8) {
+            const quint64 n = rng.next();
+            memcpy(p + i, &n, 8);
+        }
+        for (; i < size; ++i)
+            p[i] = char(rng.next());
+        break;
+    }
+}
+
+bool writeFile(const QString& path, qint64 size, Content content, Random& rng)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray chunk;
+    while (size > 0) {
+        chunk.resize(int(qMin<qint64>(size, BENCH_CHUNK)));
+        fill(chunk, content, rng);
+        if (file.write(chunk) != chunk.size())
+            return false;
+        size -= chunk.size();
+    }
+    return true;
+}
+
+bool removeTree(const QString& path)
+{
+    QDir dir(path);
+    if (!dir.exists())
+        return true;
+
+    const QFileInfoList list = dir.entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System
+        | QDir::NoDotAndDotDot);
+    for (int i = 0; i < list.size(); ++i) {
+        const QFileInfo& info = list.at(i);
+        const bool ok = info.isDir() && !info.isSymLink()
+            ? removeTree(info.absoluteFilePath())
+            : QFile::remove(info.absoluteFilePath());
+        if (!ok)
+            return false;
+    }
+    return dir.rmdir(path);
+}
+
+qint64 scaled(qint64 n, double scale)
+{
+    return qMax<qint64>(1, qint64(n * scale));
+}
+
+/*!
+    Writes the files of a corpus. Every corpus has its own seed, so a corpus
+    is the same whatever the other corpora and the scale of the others are.
+*/
+bool generate(const QString& name, const QString& path, double scale)
+{
+    QDir dir;
+    if (!dir.mkpath(path))
+        return false;
+
+    // FNV-1a: qHash() is not the same in every Qt version
+    quint64 seed = Q_UINT64_C(14695981039346656037) + BENCH_CORPUS_VERSION;
+    const QByteArray latin1 = name.toLatin1();
+    for (int i = 0; i < latin1.size(); ++i)
+        seed = (seed ^ uchar(latin1.at(i))) * Q_UINT64_C(1099511628211);
+    Random rng(seed);
+
+    if (name == QLatin1String("tiny")) {
+        // Many small source-like files in a hundred directories
+        const qint64 count = scaled(10000, scale);
+        for (qint64 i = 0; i < count; ++i) {
+            const QString sub = QString::fromLatin1("%1/d%2").arg(path).arg(i % 100, 2, 10, QLatin1Char('0'));
+            if (i < 100 && !dir.mkpath(sub))
+                return false;
+            const QString file = QString::fromLatin1("%1/f%2.txt").arg(sub).arg(i, 5, 10, QLatin1Char('0'));
+            if (!writeFile(file, rng.range(64, 4096), Text, rng))
+                return false;
+        }
+    } else if (name == QLatin1String("huge")) {
+        // A few large, moderately compressible binaries
+        for (int i = 0; i < 3; ++i) {
+            const QString file = QString::fromLatin1("%1/huge%2.bin").arg(path).arg(i);
+            if (!writeFile(file, scaled(64 * 1024 * 1024, scale), Records, rng))
+                return false;
+        }
+    } else if (name == QLatin1String("random")) {
+        for (int i = 0; i < 16; ++i) {
+            const QString file = QString::fromLatin1("%1/random%2.dat").arg(path).arg(i, 2, 10, QLatin1Char('0'));
+            if (!writeFile(file, scaled(8 * 1024 * 1024, scale), Noise, rng))
+                return false;
+        }
+    } else if (name == QLatin1String("media")) {
+        // Already compressed formats (stored by AutoFull), bitmaps and documents
+        static const char* const exts[] = { "jpg", "png", "mp3", "bmp", "html", "txt" };
+        const qint64 count = scaled(300, scale);
+        for (qint64 i = 0; i < count; ++i) {
+            const int kind = int(i % 6);
+            const QString file = QString::fromLatin1("%1/media%2.%3").arg(path)
+                .arg(i, 4, 10, QLatin1Char('0')).arg(QLatin1String(exts[kind]));
+            bool ok;
+            if (kind < 3)
+                ok = writeFile(file, rng.range(256 * 1024, 4 * 1024 * 1024), Noise, rng);
+            else if (kind == 3)
+                ok = writeFile(file, rng.range(1024 * 1024, 4 * 1024 * 1024), Runs, rng);
+            else ok = writeFile(file, rng.range(16 * 1024, 256 * 1024), Text, rng);
+            if (!ok)
+                return false;
+        }
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+//! Generates the corpus unless it already exists with the same version and scale.
+bool prepare(Corpus& corpus, const QString& root, double scale)
+{
+    corpus.path = root + QLatin1Char('/') + corpus.name;
+    const QString stamp = QString::fromLatin1("%1 %2").arg(BENCH_CORPUS_VERSION).arg(scale);
+    const QString stampPath = corpus.path + QLatin1String(".stamp");
+
+    QFile stampFile(stampPath);
+    const bool ready = stampFile.open(QIODevice::ReadOnly)
+        && QString::fromLatin1(stampFile.readAll()) == stamp;
+    stampFile.close();
+
+    if (!ready) {
+        cerr << "Generating corpus " << corpus.name.toLatin1().constData() << "..." << endl;
+        if (!removeTree(corpus.path) || !generate(corpus.name, corpus.path, scale))
+            return false;
+        if (!stampFile.open(QIODevice::WriteOnly) || stampFile.write(stamp.toLatin1()) < 0)
+            return false;
+        stampFile.close();
+    }
+
+    corpus.files = 0;
+    corpus.bytes = 0;
+    QDirIterator it(corpus.path, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        ++corpus.files;
+        corpus.bytes += it.fileInfo().size();
+    }
+    return true;
+}
+
+/*!
+    Returns the peak resident set size in KB since the last call to
+    resetPeakRss() (since the process started on other systems than Linux)
+    or -1 if it is not available.
+*/
+qint64 peakRss()
+{
+#if defined(Q_OS_LINUX)
+    QFile status(QLatin1String("/proc/self/status"));
+    if (status.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = status.readAll().split('\n');
+        for (int i = 0; i < lines.size(); ++i) {
+            if (lines.at(i).startsWith("VmHWM:"))
+                return lines.at(i).mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return -1;
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return -1;
+    return qint64(pmc.PeakWorkingSetSize / 1024);
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(Q_OS_MAC)
+    return qint64(usage.ru_maxrss / 1024);
+#else
+    return qint64(usage.ru_maxrss);
+#endif
+#else
+    return -1;
+#endif
+}
+
+//! Resets the peak resident set size (Linux 4.0 or later only).
+void resetPeakRss()
+{
+#if defined(Q_OS_LINUX)
+    QFile clearRefs(QLatin1String("/proc/self/clear_refs"));
+    if (clearRefs.open(QIODevice::WriteOnly))
+        clearRefs.write("5");
+#endif
+}
+
+QString jsonString(const QString& s)
+{
+    QString r = QLatin1String("\"");
+    for (int i = 0; i < s.length(); ++i) {
+        const ushort c = s.at(i).unicode();
+        if (c == '"' || c == '\\')
+            r += QLatin1Char('\\');
+        if (c < 0x20)
+            r += QString::fromLatin1("\\u%1").arg(c, 4, 16, QLatin1Char('0'));
+        else r += s.at(i);
+    }
+    return r + QLatin1Char('"');
+}
+
+class Report
+{
+public:
+    void add(const Corpus& corpus, const char* operation, int level, int threads,
+        qint64 archiveBytes, qint64 nsecs, qint64 rss)
+    {
+        const double secs = qMax<qint64>(nsecs, 1) / 1e9;
+        QString r = QString::fromLatin1("    {\"corpus\": %1, \"operation\": \"%2\", "
+            "\"level\": %3, \"threads\": %4, \"files\": %5, \"bytes\": %6, "
+            "\"archive_bytes\": %7, \"seconds\": %8, \"mb_per_sec\": %9, ")
+            .arg(jsonString(corpus.name)).arg(QLatin1String(operation))
+            .arg(level).arg(threads).arg(corpus.files).arg(corpus.bytes)
+            .arg(archiveBytes).arg(secs, 0, 'f', 6).arg(corpus.bytes / 1048576.0 / secs, 0, 'f', 2);
+        r += QString::fromLatin1("\"files_per_sec\": %1, \"peak_rss_kb\": %2}")
+            .arg(corpus.files / secs, 0, 'f', 1).arg(rss);
+        results.append(r);
+
+        cerr << corpus.name.toLatin1().constData() << " " << operation
+            << " level=" << level << " threads=" << threads << ": "
+            << secs << " s" << endl;
+    }
+
+    QString toJson(const Options& options) const
+    {
+        QString json = QString::fromLatin1("{\n  \"version\": %1,\n  \"qt\": %2,\n"
+            "  \"scale\": %3,\n  \"repeat\": %4,\n  \"results\": [\n")
+            .arg(BENCH_CORPUS_VERSION).arg(jsonString(QLatin1String(qVersion())))
+            .arg(options.scale).arg(options.repeat);
+        json += results.join(QLatin1String(",\n"));
+        json += QLatin1String("\n  ]\n}\n");
+        return json;
+    }
+
+private:
+    QStringList results;
+};
+
+//! Runs the add benchmark, returns false if the archive could not be created.
+bool benchAdd(Report& report, const Corpus& corpus, const QString& archive,
+    int level, int threads, const Options& options)
+{
+    qint64 best = -1;
+    qint64 rss = -1;
+
+    for (int run = 0; run < options.repeat; ++run) {
+        QFile::remove(archive);
+        resetPeakRss();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        Zip zip;
+        Zip::ErrorCode ec = zip.createArchive(archive);
+        if (ec == Zip::Ok && threads <= 1) {
+            ec = zip.addDirectory(corpus.path, Zip::CompressionLevel(level));
+        } else if (ec == Zip::Ok) {
+            // Top level entries are shared among the threads
+            QStringList shares[64];
+            threads = qMin(threads, 64);
+            const QFileInfoList list = QDir(corpus.path).entryInfoList(
+                QDir::AllEntries | QDir::NoDotAndDotDot, QDir::Name);
+            for (int i = 0; i < list.size(); ++i)
+                shares[i % threads].append(list.at(i).absoluteFilePath());
+
+            zip.setConcurrent(true);
+            QList<AddThread*> workers;
+            for (int i = 0; i < threads; ++i) {
+                workers.append(new AddThread(&zip, shares[i], Zip::CompressionLevel(level)));
+                workers.last()->start();
+            }
+            for (int i = 0; i < workers.size(); ++i) {
+                workers.at(i)->wait();
+                if (ec == Zip::Ok)
+                    ec = workers.at(i)->result();
+                delete workers.at(i);
+            }
+        }
+        if (ec == Zip::Ok)
+            ec = zip.closeArchive();
+
+        const qint64 nsecs = timer.nsecsElapsed();
+        if (ec != Zip::Ok) {
+            cerr << "Unable to create " << archive.toLatin1().constData() << ": "
+                << zip.formatError(ec).toLatin1().constData() << endl;
+            return false;
+        }
+        if (best < 0 || nsecs < best)
+            best = nsecs;
+        rss = qMax(rss, peakRss());
+    }
+
+    report.add(corpus, "add", level, threads, QFileInfo(archive).size(), best, rss);
+    return true;
+}
+
+enum ReadOperation
+{
+    Open,
+    EntryList,
+    Verify,
+    Extract
+};
+
+void benchRead(Report& report, const Corpus& corpus, const QString& archive,
+    int level, ReadOperation op, int threads, const Options& options)
+{
+    static const char* const names[] = { "open", "entry_list", "verify", "extract" };
+
+    // Opening and listing are too fast to be measured only once
+    const int runs = op == Open || op == EntryList ? qMax(10, options.repeat) : options.repeat;
+    const QString extractDir = options.workDir + QLatin1String("/extract");
+    qint64 best = -1;
+    qint64 rss = -1;
+
+    for (int run = 0; run < runs; ++run) {
+        removeTree(extractDir);
+        resetPeakRss();
+
+        UnZip unzip;
+        QElapsedTimer timer;
+        if (op == Open)
+            timer.start();
+
+        UnZip::ErrorCode ec = unzip.openArchive(archive);
+        if (op != Open)
+            timer.start();
+
+        if (ec == UnZip::Ok) {
+            switch (op) {
+            case EntryList:
+                if (unzip.entryList().size() < corpus.files)
+                    ec = UnZip::Corrupted;
+                break;
+            case Verify:
+                ec = threads > 1 ? unzip.verifyArchive(threads) : unzip.verifyArchive();
+                break;
+            case Extract:
+                ec = unzip.extractAll(extractDir);
+                break;
+            default: ;
+            }
+        }
+
+        const qint64 nsecs = timer.nsecsElapsed();
+        unzip.closeArchive();
+
+        if (ec != UnZip::Ok) {
+            cerr << names[op] << " failed on " << archive.toLatin1().constData() << ": "
+                << unzip.formatError(ec).toLatin1().constData() << endl;
+            return;
+        }
+        if (best < 0 || nsecs < best)
+            best = nsecs;
+        rss = qMax(rss, peakRss());
+    }
+
+    removeTree(extractDir);
+    report.add(corpus, names[op], level, threads, QFileInfo(archive).size(), best, rss);
+}
+
+QList<int> parseList(const char* arg, int min, int max)
+{
+    QList<int> list;
+    const QStringList items = QString::fromLatin1(arg).split(QLatin1Char(','));
+    for (int i = 0; i < items.size(); ++i) {
+        bool ok;
+        const int n = items.at(i).toInt(&ok);
+        if (!ok || n < min || n > max)
+            return QList<int>();
+        list.append(n);
+    }
+    return list;
+}
+
+void usage()
+{
+    cout << "Benchmark for the OSDaB Project Zip/UnZip classes" << endl << endl;
+    cout << "zipbench [-o JSON_FILE] [-s SCALE] [-t THREADS] [-l LEVELS] [-c CORPORA] [-r REPEAT] [-k] [WORK_DIR]" << endl << endl;
+    cout << "  -o  Write the results to JSON_FILE instead of the standard output" << endl;
+    cout << "  -s  Multiply the size of the corpora by SCALE (default 1, about 0.8G)" << endl;
+    cout << "  -t  Comma separated thread counts for add (default 1,2,4)" << endl;
+    cout << "  -l  Comma separated compression levels, 0 (store) to 9 (default 0,1,6,9)" << endl;
+    cout << "  -c  Comma separated corpora: tiny, huge, random, media (default all)" << endl;
+    cout << "  -r  Runs of each operation, the fastest is reported (default 1)" << endl;
+    cout << "  -k  Keep the archives" << endl << endl;
+    cout << "Corpora are generated once in WORK_DIR (default: a zipbench directory" << endl;
+    cout << "in the temporary directory) and reused as long as the scale doesn't change." << endl;
+    exit(EXIT_FAILURE);
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    options.workDir = QDir::tempPath() + QLatin1String("/zipbench");
+    options.scale = 1;
+    options.threads << 1 << 2 << 4;
+    options.levels << 0 << 1 << 6 << 9;
+    options.corpora << QLatin1String("tiny") << QLatin1String("huge")
+        << QLatin1String("random") << QLatin1String("media");
+    options.repeat = 1;
+    options.keep = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (arg[0] != '-') {
+            options.workDir = QDir(QString::fromLocal8Bit(arg)).absolutePath();
+            continue;
+        }
+        if (strlen(arg) != 2)
+            return false;
+        if (arg[1] == 'k') {
+            options.keep = true;
+            continue;
+        }
+        if (++i == argc)
+            return false;
+
+        const char* value = argv[i];
+        switch (arg[1]) {
+        case 'o': options.output = QString::fromLocal8Bit(value); break;
+        case 's': options.scale = atof(value); if (options.scale <= 0) return false; break;
+        case 't': options.threads = parseList(value, 1, 64); if (options.threads.isEmpty()) return false; break;
+        case 'l': options.levels = parseList(value, 0, 9); if (options.levels.isEmpty()) return false; break;
+        case 'c': options.corpora = QString::fromLatin1(value).split(QLatin1Char(',')); break;
+        case 'r': options.repeat = atoi(value); if (options.repeat < 1) return false; break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        usage();
+
+    const QString corpusDir = options.workDir + QLatin1String("/corpus");
+    const QString archiveDir = options.workDir + QLatin1String("/archives");
+    if (!QDir().mkpath(corpusDir) || !QDir().mkpath(archiveDir)) {
+        cerr << "Unable to create " << options.workDir.toLatin1().constData() << endl;
+        return EXIT_FAILURE;
+    }
+
+    Report report;
+    bool ok = true;
+
+    for (int c = 0; c < options.corpora.size(); ++c) {
+        Corpus corpus;
+        corpus.name = options.corpora.at(c);
+        if (!prepare(corpus, corpusDir, options.scale)) {
+            cerr << "Unable to generate corpus " << corpus.name.toLatin1().constData() << endl;
+            ok = false;
+            continue;
+        }
+
+        for (int l = 0; l < options.levels.size(); ++l) {
+            const int level = options.levels.at(l);
+            QString readArchive;
+
+            for (int t = 0; t < options.threads.size(); ++t) {
+                const int threads = options.threads.at(t);
+                const QString archive = QString::fromLatin1("%1/%2-%3-%4.zip")
+                    .arg(archiveDir, corpus.name).arg(level).arg(threads);
+                if (!benchAdd(report, corpus, archive, level, threads, options)) {
+                    ok = false;
+                    continue;
+                }
+                // The reads are timed on the first archive
+                if (readArchive.isEmpty())
+                    readArchive = archive;
+                else if (!options.keep)
+                    QFile::remove(archive);
+            }
+
+            if (readArchive.isEmpty())
+                continue;
+
+            benchRead(report, corpus, readArchive, level, Open, 1, options);
+            benchRead(report, corpus, readArchive, level, EntryList, 1, options);
+            for (int t = 0; t < options.threads.size(); ++t)
+                benchRead(report, corpus, readArchive, level, Verify, options.threads.at(t), options);
+            benchRead(report, corpus, readArchive, level, Extract, 1, options);
+
+            if (!options.keep)
+                QFile::remove(readArchive);
+        }
+    }
+
+    const QByteArray json = report.toJson(options).toUtf8();
+    if (options.output.isEmpty()) {
+        cout << json.constData();
+    } else {
+        QFile out(options.output);
+        if (!out.open(QIODevice::WriteOnly) || out.write(json) != json.size()) {
+            cerr << "Unable to write " << options.output.toLatin1().constData() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -7,8 +7,19 @@ TARGET = zip
 INCLUDEPATH += . ../
 
 # Input
-HEADERS += ../zipglobal.h ../zip.h ../zip_p.h ../unzip.h ../unzip_p.h ../zipentry_p.h
-SOURCES += main.cpp ../zipglobal.cpp ../zip.cpp ../unzip.cpp
+HEADERS += ../zipglobal.h ../zip.h ../zip_p.h ../unzip.h ../unzip_p.h ../zipaes_p.h ../zipblockcache_p.h ../zipcache.h ../zipcodec_p.h ../zipcrc32_p.h ../zipentry_p.h ../zipentrydevice_p.h ../zipfileengine.h ../zipfileengine_p.h ../zipindex_p.h ../zippipeline_p.h ../zipscanner_p.h ../zipsearch_p.h ../ziptrace_p.h ../zipwritebuffer_p.h
+SOURCES += main.cpp ../zipglobal.cpp ../zip.cpp ../unzip.cpp ../zipaes.cpp ../zipblockcache.cpp ../zipcache.cpp ../zipcodec.cpp ../zipcrc32.cpp ../zipentrydevice.cpp ../zipfileengine.cpp ../zipindex.cpp ../zippipeline.cpp ../zipscanner.cpp ../zipsearch.cpp ../zipwritebuffer.cpp
 DESTDIR = bin
 MOC_DIR = tmp
 OBJECTS_DIR = tmp
+
+# The zip: file engine uses a private class with Qt 5 (see zipfileengine_p.h)
+greaterThan(QT_MAJOR_VERSION, 4): QT += core-private
+
+# Optional compression methods (see zipcodec_p.h)
+# DEFINES += OSDAB_ZIP_ZSTD OSDAB_ZIP_LZMA
+# LIBS += -lzstd -llzma
+
+# Optional faster deflate backends (see zipcodec_p.h)
+# DEFINES += OSDAB_ZIP_ZLIB_NG OSDAB_ZIP_LIBDEFLATE
+# LIBS += -lz-ng -ldeflate
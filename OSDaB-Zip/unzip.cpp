@@ -27,16 +27,32 @@
 
 #include "unzip.h"
 #include "unzip_p.h"
+#include "zipaes_p.h"
+#include "zipblockcache_p.h"
+#include "zipcache.h"
+#include "zipcodec_p.h"
+#include "zipcrc32_p.h"
 #include "zipentry_p.h"
+#include "zipentrydevice_p.h"
+#include "zipscanner_p.h"
+#include "zipsearch_p.h"
+#include "ziptrace_p.h"
 
+#include <QtCore/QBuffer>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QScopedPointer>
 #include <QtCore/QString>
 #include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 
-// You can remove this #include if you replace the qDebug() statements.
-#include <QtCore/QtDebug>
+
+#include <string.h>
 
 /*!
  \class UnZip unzip.h
@@ -65,6 +81,8 @@
  \value UnZip::InvalidDevice A null device has been passed as parameter.
  \value UnZip::InvalidArchive This is not a valid (or supported) ZIP archive.
  \value UnZip::HeaderConsistencyError Local header record info does not match with the central directory record info. The archive may be corrupted.
+ \value UnZip::Canceled The operation has been canceled (see cancel() and ZipProgressObserver).
+ \value UnZip::InvalidPattern The search pattern is empty or not a valid regular expression.
 
  \value UnZip::Skip Internal use only.
  \value UnZip::SkipAll Internal use only.
@@ -77,6 +95,17 @@
  \value UnZip::NoSilentDirectoryCreation Doesn't attempt to silently create missing output directories.
 */
 
+/*! \enum UnZip::CompareOptions Options for compare().
+ \value UnZip::CompareMetadata Default. Only compares the central directory records.
+ \value UnZip::CompareContents Decompresses and compares the entries with the same CRC and size.
+*/
+
+/*! \enum UnZip::SearchOptions Options for search().
+ \value UnZip::SearchLiteral Default. The pattern is a string, matched exactly.
+ \value UnZip::SearchRegExp The pattern is a regular expression (Perl syntax).
+ \value UnZip::SearchCaseInsensitive Ignores the case of the pattern.
+*/
+
 //! Local header size (excluding signature, excluding variable length fields)
 #define UNZIP_LOCAL_HEADER_SIZE 26
 //! Central Directory file entry size (excluding signature, excluding variable length fields)
@@ -133,7 +162,7 @@
 #define UNZIP_VERSION 0x14
 
 //! CRC32 routine
-#define CRC32(c, b) crcTable[((int)c^b) & 0xff] ^ (c >> 8)
+#define CRC32(c, b) ZipCrc32::updateByte(c, b)
 
 OSDAB_BEGIN_NAMESPACE(Zip)
 
@@ -154,6 +183,199 @@ UnZip::ZipEntry::ZipEntry()
 }
 
 
+/************************************************************************
+ SearchHit
+*************************************************************************/
+
+/*! \class UnZip::SearchHit unzip.h
+ A line of an entry matching the pattern passed to UnZip::search():
+ \a offset is the position of the first match in the uncompressed entry,
+ \a line the line number (starting from 1) and \a text the line, without
+ the line break.
+*/
+UnZip::SearchHit::SearchHit() :
+    offset(0),
+    line(0)
+{
+}
+
+
+/************************************************************************
+ EntryView
+*************************************************************************/
+
+/*! \class UnZip::EntryView unzip.h
+
+ Lightweight reference to an entry of the open archive, returned by
+ UnZip::entryAt(), UnZip::entry() and passed to UnZip::EntryVisitor.
+ Fields are read from the internal entry table when requested: nothing is
+ copied or converted when the view is created.
+ A view is valid until the archive is closed.
+*/
+
+/*!
+ Creates an invalid view.
+*/
+UnZip::EntryView::EntryView() :
+    d(0), name(0), entry(0), position(-1)
+{
+}
+
+/*!
+ Returns false if the entry does not exist.
+*/
+bool UnZip::EntryView::isValid() const
+{
+    return d != 0;
+}
+
+/*!
+ Returns the position of the entry, the argument of UnZip::entryAt().
+ Entries are sorted by name.
+*/
+int UnZip::EntryView::index() const
+{
+    return position;
+}
+
+/*!
+ Returns the complete path of the entry. Archives read from an index file
+ copy the name here.
+*/
+QString UnZip::EntryView::filename() const
+{
+    Q_ASSERT(d);
+    return name ? *name : d->index.name(position);
+}
+
+QString UnZip::EntryView::comment() const
+{
+    Q_ASSERT(d);
+    return entry ? entry->comment : d->index.comment(position);
+}
+
+quint32 UnZip::EntryView::compressedSize() const
+{
+    Q_ASSERT(d);
+    return entry ? entry->szComp : d->index.record(position).szComp;
+}
+
+quint32 UnZip::EntryView::uncompressedSize() const
+{
+    Q_ASSERT(d);
+    return entry ? entry->szUncomp : d->index.record(position).szUncomp;
+}
+
+quint32 UnZip::EntryView::crc32() const
+{
+    Q_ASSERT(d);
+    return entry ? entry->crc : d->index.record(position).crc;
+}
+
+/*!
+ Returns the compression method field of the entry, e.g. 8 for deflate.
+ This is the actual method of AES encrypted entries.
+*/
+quint16 UnZip::EntryView::compressionMethod() const
+{
+    Q_ASSERT(d);
+    return entry ? entry->compMethod : d->index.record(position).compMethod;
+}
+
+/*!
+ Returns the modification date in MS-DOS format, as stored in the archive.
+*/
+quint16 UnZip::EntryView::dosDate() const
+{
+    Q_ASSERT(d);
+    const unsigned char* date = entry ? entry->modDate : d->index.record(position).modDate;
+    return date[0] | (date[1] << 8);
+}
+
+/*!
+ Returns the modification time in MS-DOS format, as stored in the archive.
+*/
+quint16 UnZip::EntryView::dosTime() const
+{
+    Q_ASSERT(d);
+    const unsigned char* time = entry ? entry->modTime : d->index.record(position).modTime;
+    return time[0] | (time[1] << 8);
+}
+
+/*!
+ Converts the modification date and time. Use dosDate() and dosTime() to
+ compare entries without a conversion.
+*/
+QDateTime UnZip::EntryView::lastModified() const
+{
+    Q_ASSERT(d);
+    if (entry)
+        return d->convertDateTime(entry->modDate, entry->modTime);
+    const ZipIndex::Entry& e = d->index.record(position);
+    return d->convertDateTime(e.modDate, e.modTime);
+}
+
+UnZip::CompressionMethod UnZip::EntryView::compression() const
+{
+    switch (compressionMethod()) {
+    case ZIP_METHOD_STORED: return NoCompression;
+    case ZIP_METHOD_DEFLATED: return Deflated;
+    case ZIP_METHOD_LZMA: return Lzma;
+    case ZIP_METHOD_ZSTD: return Zstd;
+    default: return UnknownCompression;
+    }
+}
+
+UnZip::FileType UnZip::EntryView::type() const
+{
+    Q_ASSERT(d);
+    if (name)
+        return name->endsWith(QLatin1Char('/')) ? Directory : File;
+    return d->index.isDirectory(position) ? Directory : File;
+}
+
+bool UnZip::EntryView::isEncrypted() const
+{
+    Q_ASSERT(d);
+    return (entry ? entry->gpFlag[0] : d->index.record(position).gpFlag[0]) & 0x01;
+}
+
+/*!
+ Returns a copy of the entry, as returned by UnZip::entryList().
+*/
+UnZip::ZipEntry UnZip::EntryView::toZipEntry() const
+{
+    ZipEntry z;
+    if (!d)
+        return z;
+
+    z.filename = filename();
+    z.comment = comment();
+    z.compressedSize = compressedSize();
+    z.uncompressedSize = uncompressedSize();
+    z.crc32 = crc32();
+    z.lastModified = lastModified();
+    z.compression = compression();
+    z.type = type();
+    z.encrypted = isEncrypted();
+    return z;
+}
+
+/*! \class UnZip::EntryVisitor unzip.h
+
+ Subclass and pass to UnZip::visitEntries() to walk the entries of the open
+ archive without building a list.
+*/
+
+UnZip::EntryVisitor::~EntryVisitor()
+{
+}
+
+/*! \fn bool UnZip::EntryVisitor::visit(const EntryView& entry)
+ Called for each entry, sorted by name. Return false to stop.
+*/
+
+
 /************************************************************************
  Private interface
 *************************************************************************/
@@ -166,21 +388,26 @@ UnzipPrivate::UnzipPrivate() :
     device(0),
     file(0),
     uBuffer(0),
-    crcTable(0),
     cdOffset(0),
     eocdOffset(0),
     cdEntryCount(0),
     unsupportedEntryCount(0),
-    comment()
+    comment(),
+    entryCache(0),
+    cacheBlockSize(0),
+    cacheBlocks(0),
+    cache(0),
+    observer(0),
+    canceled(0),
+    owner(0)
 {
     uBuffer = (unsigned char*) buffer1;
-    crcTable = (quint32*) get_crc_table();
 }
 
 //! \internal
 void UnzipPrivate::deviceDestroyed(QObject*)
 {
-    qDebug("Unexpected device destruction detected.");
+    ZIP_WARNING(unzipLog) << "Unexpected device destruction detected.";
     do_closeArchive();
 }
 
@@ -190,14 +417,25 @@ UnZip::ErrorCode UnzipPrivate::openArchive(QIODevice* dev)
     Q_ASSERT(!device);
     Q_ASSERT(dev);
 
+    const ZipTraceTimer traceTimer(ZIP_TRACE_ENABLED(unzipLog));
+
     if (!(dev->isOpen() || dev->open(QIODevice::ReadOnly))) {
-        qDebug() << "Unable to open device for reading";
+        ZIP_WARNING(unzipLog) << "Unable to open device for reading";
         return UnZip::OpenFailed;
     }
 
+    if (dev != file)
+        connect(dev, SIGNAL(destroyed(QObject*)), this, SLOT(deviceDestroyed(QObject*)));
+
     device = dev;
-    if (device != file)
-        connect(device, SIGNAL(destroyed(QObject*)), this, SLOT(deviceDestroyed(QObject*)));
+    if (cacheBlockSize > 0) {
+        cache = new ZipBlockCache(dev, cacheBlockSize, cacheBlocks);
+        cache->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        device = cache;
+    }
+
+    stats.reset();
+    canceled.fetchAndStoreRelaxed(0);
 
     UnZip::ErrorCode ec;
 
@@ -212,17 +450,27 @@ UnZip::ErrorCode UnzipPrivate::openArchive(QIODevice* dev)
         return UnZip::Ok;
     }
 
+    // A valid index replaces the central directory
+    ZipIndex::Key key;
+    const bool indexed = !indexPath.isEmpty() && indexKey(key);
+    if (indexed && index.open(indexPath, key)) {
+        unsupportedEntryCount = index.unsupportedEntries();
+        ZIP_TRACE(unzipLog) << "open entries=" << index.count()
+            << " us=" << traceTimer.usecs() << " result=" << int(UnZip::Ok) << " indexed=true";
+        return UnZip::Ok;
+    }
+
     bool continueParsing = true;
 
     while (continueParsing) {
         if (device->read(buffer1, 4) != 4) {
             if (headers) {
-                qDebug() << "Corrupted zip archive. Some files might be extracted.";
+                ZIP_WARNING(unzipLog) << "Corrupted zip archive. Some files might be extracted.";
                 ec = headers->size() != 0 ? UnZip::PartiallyCorrupted : UnZip::Corrupted;
                 break;
             } else {
                 closeArchive();
-                qDebug() << "Corrupted or invalid zip archive. Closing.";
+                ZIP_WARNING(unzipLog) << "Corrupted or invalid zip archive. Closing.";
                 ec = UnZip::Corrupted;
                 break;
             }
@@ -237,6 +485,11 @@ UnZip::ErrorCode UnzipPrivate::openArchive(QIODevice* dev)
 
     if (ec != UnZip::Ok)
         closeArchive();
+    else if (indexed && headers && !ZipIndex::write(indexPath, key, *headers, unsupportedEntryCount))
+        ZIP_WARNING(unzipLog) << "Unable to write the index" << indexPath;
+
+    ZIP_TRACE(unzipLog) << "open entries=" << (headers ? headers->size() : 0)
+        << " us=" << traceTimer.usecs() << " result=" << int(ec) << " indexed=false";
 
     return ec;
 }
@@ -292,7 +545,8 @@ UnZip::ErrorCode UnzipPrivate::parseLocalHeaderRecord(const QString& path, const
     bool checkFailed = false;
 
     if (!checkFailed)
-        checkFailed = entry.compMethod != getUShort(uBuffer, UNZIP_LH_OFF_CMETHOD);
+        checkFailed = (entry.isAesEncrypted() ? ZIP_METHOD_AES : entry.compMethod)
+            != getUShort(uBuffer, UNZIP_LH_OFF_CMETHOD);
     if (!checkFailed)
         checkFailed = entry.gpFlag[0] != uBuffer[UNZIP_LH_OFF_GPFLAG];
     if (!checkFailed)
@@ -328,7 +582,7 @@ UnZip::ErrorCode UnzipPrivate::parseLocalHeaderRecord(const QString& path, const
 
     QString filename = QString::fromAscii(buffer2, szName);
     if (filename != path) {
-        qDebug() << "Filename in local header mismatches.";
+        ZIP_WARNING(unzipLog) << "Filename in local header mismatches.";
         return UnZip::HeaderConsistencyError;
     }
 
@@ -540,32 +794,53 @@ UnZip::ErrorCode UnzipPrivate::parseCentralDirectoryRecord()
 
     UnZip::ErrorCode ec = UnZip::Ok;
 
-    if ((compMethod != 0) && (compMethod != 8)) {
-        qDebug() << "Unsupported compression method. Skipping file.";
+    QString filename;
+    if (device->read(buffer2, szName) != szName) {
+        ec = UnZip::ReadFailed;
         skipEntry = true;
+    } else {
+        filename = QString::fromAscii(buffer2, szName);
+        skipLength -= szName;
     }
 
-    if (!skipEntry && szName == 0) {
-        qDebug() << "Skipping file with no name.";
+    // WinZip AES encrypted entries store the actual compression method in the extra field
+    quint8 aesStrength = 0;
+    quint16 aesVersion = 0;
+    if (!skipEntry && compMethod == ZIP_METHOD_AES) {
+        if (device->read(buffer2, szExtra) != szExtra) {
+            ec = UnZip::ReadFailed;
+            skipEntry = true;
+        } else {
+            skipLength -= szExtra;
+            if (!parseAesExtraField((const unsigned char*) buffer2, szExtra, compMethod, aesStrength, aesVersion)) {
+                ZIP_WARNING(unzipLog) << "Unsupported AES encryption. Skipping file.";
+                skipEntry = true;
+            }
+            szExtra = 0;
+        }
+    }
+
+    const ZipCodec* codec = ZipCodec::codecForMethod(compMethod);
+    if (!skipEntry && (!codec || !(codec->capabilities() & ZipCodec::CanDecompress))) {
+        ZIP_WARNING(unzipLog) << "Unsupported compression method. Skipping file.";
         skipEntry = true;
     }
 
-    QString filename;
-    if (device->read(buffer2, szName) != szName) {
-        ec = UnZip::ReadFailed;
+    if (!skipEntry && szName == 0) {
+        ZIP_WARNING(unzipLog) << "Skipping file with no name.";
         skipEntry = true;
-    } else {
-        filename = QString::fromAscii(buffer2, szName);
     }
 
     // Unsupported features if version is bigger than UNZIP_VERSION
-    if (!skipEntry && buffer1[UNZIP_CD_OFF_VERSION] > UNZIP_VERSION) {
-        QString v = QString::number(buffer1[UNZIP_CD_OFF_VERSION]);
-        if (v.length() == 2)
-            v.insert(1, QLatin1Char('.'));
-        v = QString::fromLatin1("Unsupported PKZip version (%1). Skipping file: %2")
-            .arg(v, filename.isEmpty() ? QString::fromLatin1("<undefined>") : filename);
-        qDebug() << v.toLatin1().constData();
+    // (or the version required by the compression method or AES)
+    quint8 versionNeeded = UNZIP_VERSION;
+    if (codec)
+        versionNeeded = qMax<quint8>(versionNeeded, codec->versionNeeded());
+    if (aesStrength)
+        versionNeeded = qMax<quint8>(versionNeeded, ZIP_AES_VERSION);
+    if (!skipEntry && buffer1[UNZIP_CD_OFF_VERSION] > versionNeeded) {
+        ZIP_WARNING(unzipLog) << "Unsupported PKZip version" << int((quint8) buffer1[UNZIP_CD_OFF_VERSION])
+            << "- skipping file:" << (filename.isEmpty() ? QString::fromLatin1("<undefined>") : filename);
         skipEntry = true;
     }
 
@@ -581,6 +856,8 @@ UnZip::ErrorCode UnzipPrivate::parseCentralDirectoryRecord()
 
     ZipEntryP* h = new ZipEntryP;
     h->compMethod = compMethod;
+    h->aesStrength = aesStrength;
+    h->aesVersion = aesVersion;
 
     h->gpFlag[0] = buffer1[UNZIP_CD_OFF_GPFLAG];
     h->gpFlag[1] = buffer1[UNZIP_CD_OFF_GPFLAG + 1];
@@ -622,6 +899,100 @@ UnZip::ErrorCode UnzipPrivate::parseCentralDirectoryRecord()
     return UnZip::Ok;
 }
 
+/*! \internal Computes the properties of the open archive an index must match.
+    Returns false if the archive is not a file or if the central directory
+    can't be read. The device is left at the start of the central directory.
+*/
+bool UnzipPrivate::indexKey(ZipIndex::Key& key)
+{
+    QFile* f = qobject_cast<QFile*>(archiveDevice());
+    if (!f || eocdOffset < cdOffset)
+        return false;
+
+    const QDateTime modified = QFileInfo(f->fileName()).lastModified();
+    key.archiveSize = f->size();
+    key.modified = modified.toTime_t() * Q_INT64_C(1000) + modified.time().msec();
+    key.cdOffset = cdOffset;
+    key.cdSize = eocdOffset - cdOffset;
+    key.entryCount = cdEntryCount;
+
+    // Catches archives rewritten within the resolution of the modification time
+    quint32 crc = 0;
+    qint64 left = key.cdSize;
+    while (left > 0) {
+        const qint64 read = device->read(buffer1, qMin<qint64>(left, UNZIP_READ_BUFFER));
+        if (read <= 0)
+            break;
+        crc = ZipCrc32::update(crc, buffer1, read);
+        left -= read;
+    }
+    key.cdCrc = crc;
+
+    // The central directory is parsed from here if the index can't be used
+    return device->seek(cdOffset) && left == 0;
+}
+
+//! \internal Loads all the entries of the index in headers.
+void UnzipPrivate::loadIndexedHeaders()
+{
+    if (headers || !index.isOpen())
+        return;
+
+    headers = new QMap<QString, ZipEntryP*>();
+    for (int i = 0; i < index.count(); ++i) {
+        ZipEntryP* h = new ZipEntryP;
+        index.entry(i, *h);
+        headers->insert(index.name(i), h);
+    }
+}
+
+//! \internal Fills entryTable with the entries of headers.
+void UnzipPrivate::buildEntryTable()
+{
+    if (!headers || entryTable.size() == headers->size())
+        return;
+
+    entryTable.clear();
+    entryTable.reserve(headers->size());
+    for (QMap<QString,ZipEntryP*>::ConstIterator it = headers->constBegin();
+    it != headers->constEnd(); ++it)
+        entryTable.append(it);
+}
+
+/*! \internal Returns the position of the first entry whose name is not
+    less than \p name, or the number of entries.
+*/
+int UnzipPrivate::lowerBound(const QString& name)
+{
+    buildEntryTable();
+
+    int lo = 0;
+    int hi = headers ? entryTable.size() : index.count();
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        const bool less = headers ? entryTable.at(mid).key() < name : index.name(mid) < name;
+        if (less)
+            lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/*! \internal Returns the entry for \p path or 0. Entries of the index are
+    copied to \p buffer, without loading the other ones.
+*/
+const ZipEntryP* UnzipPrivate::findEntry(const QString& path, ZipEntryP& buffer) const
+{
+    if (headers)
+        return headers->value(path);
+
+    const int i = index.find(path);
+    if (i < 0)
+        return 0;
+    index.entry(i, buffer);
+    return &buffer;
+}
+
 //! \internal Closes the archive and resets the internal status.
 void UnzipPrivate::closeArchive()
 {
@@ -630,12 +1001,121 @@ void UnzipPrivate::closeArchive()
         return;
     }
 
-    if (device != file)
-        disconnect(device, 0, this, 0);
+    QIODevice* dev = archiveDevice();
+    if (dev != file)
+        disconnect(dev, 0, this, 0);
 
     do_closeArchive();
 }
 
+/*! \internal Compares the contents of \p path in this archive and in \p other,
+    setting \p equal. Stops at the first difference.
+*/
+UnZip::ErrorCode UnzipPrivate::compareContents(const QString& path, UnzipPrivate& other, bool& equal)
+{
+    UnZip::ErrorCode ec = UnZip::Ok;
+    QScopedPointer<QIODevice> dev(openEntry(path, ec));
+    if (!dev)
+        return ec;
+    QScopedPointer<QIODevice> otherDev(other.openEntry(path, ec));
+    if (!otherDev)
+        return ec;
+
+    equal = false;
+    for (;;) {
+        if (isCanceled())
+            return UnZip::Canceled;
+
+        const qint64 read = dev->read(buffer1, UNZIP_READ_BUFFER);
+        const qint64 otherRead = otherDev->read(buffer2, UNZIP_READ_BUFFER);
+        if (read < 0 || otherRead < 0)
+            return UnZip::ReadFailed;
+        if (read != otherRead || memcmp(buffer1, buffer2, read))
+            return UnZip::Ok;
+        if (!read)
+            break;
+    }
+
+    equal = true;
+    return UnZip::Ok;
+}
+
+//! \internal Creates the device returned by UnZip::openEntry().
+QIODevice* UnzipPrivate::openEntry(const QString& path, UnZip::ErrorCode& ec)
+{
+    if (!device) {
+        ec = UnZip::NoOpenArchive;
+        return 0;
+    }
+
+    ZipEntryP buffer;
+    const ZipEntryP* entry = hasEntries() ? findEntry(path, buffer) : 0;
+    if (!entry) {
+        ec = UnZip::FileNotFound;
+        return 0;
+    }
+    if (entry->isEncrypted()) {
+        ec = UnZip::WrongPassword;
+        return 0;
+    }
+
+    const ZipCodec* codec = ZipCodec::codecForMethod(entry->compMethod);
+    if (!codec || !(codec->capabilities() & ZipCodec::CanDecompress)) {
+        ec = UnZip::ZlibInit;
+        return 0;
+    }
+
+    if (!entry->lhEntryChecked) {
+        ec = parseLocalHeaderRecord(path, *entry);
+        entry->lhEntryChecked = true;
+        if (ec != UnZip::Ok)
+            return 0;
+    }
+
+    // Positional reads on a private file handle or buffer when possible
+    QIODevice* source = archiveDevice();
+    QFile* f = qobject_cast<QFile*>(source);
+    QBuffer* b = qobject_cast<QBuffer*>(source);
+    QIODevice* own = 0;
+    if (f) {
+        own = new QFile(f->fileName());
+    } else if (b) {
+        QBuffer* buffer = new QBuffer;
+        buffer->setData(b->data());
+        own = buffer;
+    }
+    if (own && !own->open(QIODevice::ReadOnly)) {
+        delete own;
+        ec = UnZip::OpenFailed;
+        return 0;
+    }
+
+    ZipEntryDeviceInfo info;
+    info.dataOffset = entry->dataOffset;
+    info.szComp = entry->szComp;
+    info.szUncomp = entry->szUncomp;
+    info.method = entry->compMethod;
+    info.crc = entry->crc;
+
+    ZipEntryDevice* dev = new ZipEntryDevice(own ? own : source, info);
+    if (own)
+        own->setParent(dev);
+    if (!dev->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        delete dev;
+        ec = UnZip::ReadFailed;
+        return 0;
+    }
+
+    ec = UnZip::Ok;
+    return dev;
+}
+
+//! \internal Returns the device of the archive, without the read cache.
+QIODevice* UnzipPrivate::archiveDevice() const
+{
+    return cache ? cache->source() : device;
+}
+
 //! \internal
 void UnzipPrivate::do_closeArchive()
 {
@@ -647,8 +1127,16 @@ void UnzipPrivate::do_closeArchive()
         delete headers;
         headers = 0;
     }
+    entryTable.clear();
+    index.close();
 
     device = 0;
+    if (cache) {
+        stats.cacheHits += cache->hits();
+        stats.cacheMisses += cache->misses();
+        delete cache;
+        cache = 0;
+    }
 
     if (file)
         delete file;
@@ -659,6 +1147,37 @@ void UnzipPrivate::do_closeArchive()
     unsupportedEntryCount = 0;
 
     comment.clear();
+    evictDeviceEntries();
+    cacheIdentity.clear();
+}
+
+//! \internal True if the archive operations have been canceled.
+bool UnzipPrivate::isCanceled()
+{
+    // Verification workers are canceled with their archive
+    UnzipPrivate* archive = owner ? owner : this;
+    return archive->canceled.fetchAndAddRelaxed(0) != 0;
+}
+
+/*! \internal Accounts \p in bytes read and \p out bytes extracted for the
+    current entry and reports them to the observer.
+    Returns false if the operation has been canceled.
+*/
+bool UnzipPrivate::progress(qint64 in, qint64 out)
+{
+    stats.entryBytesIn += in;
+    stats.entryBytesOut += out;
+    stats.bytesIn += in;
+    stats.bytesOut += out;
+
+    if (isCanceled())
+        return false;
+    if (!observer || observer->progress(stats))
+        return true;
+
+    // The following entries must not be extracted either
+    canceled.fetchAndStoreRelaxed(1);
+    return false;
 }
 
 //! \internal
@@ -682,7 +1201,7 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
 
         directory = QString("%1/%2").arg(dir.absolutePath()).arg(QDir::cleanPath(name));
         if (!createDirectory(directory)) {
-            qDebug() << QString("Unable to create directory: %1").arg(directory);
+            ZIP_WARNING(unzipLog) << "Unable to create directory" << directory;
             return UnZip::CreateDirFailed;
         }
 
@@ -702,7 +1221,7 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
         } else {
             directory = QString("%1/%2").arg(dir.absolutePath()).arg(QDir::cleanPath(dirname));
             if (!createDirectory(directory)) {
-                qDebug() << QString("Unable to create directory: %1").arg(directory);
+                ZIP_WARNING(unzipLog) << "Unable to create directory" << directory;
                 return UnZip::CreateDirFailed;
             }
         }
@@ -714,7 +1233,7 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
     const bool silentDirectoryCreation = !(options & UnZip::NoSilentDirectoryCreation);
     if (silentDirectoryCreation) {
         if (!createDirectory(directory)) {
-            qDebug() << QString("Unable to create output directory %1").arg(directory);
+            ZIP_WARNING(unzipLog) << "Unable to create output directory" << directory;
             return UnZip::CreateDirFailed;
         }
     }
@@ -723,7 +1242,7 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
 
     QFile outFile(name);
     if (!outFile.open(QIODevice::WriteOnly)) {
-        qDebug() << QString("Unable to open %1 for writing").arg(name);
+        ZIP_WARNING(unzipLog) << "Unable to open" << name << "for writing";
         return UnZip::OpenFailed;
     }
 
@@ -733,12 +1252,12 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
     const QDateTime lastModified = convertDateTime(entry.modDate, entry.modTime);
     const bool setTimeOk = OSDAB_ZIP_MANGLE(setFileTimestamp)(name, lastModified);
     if (!setTimeOk) {
-        qDebug() << QString("Unable to set last modified time on file: %1").arg(name);
+        ZIP_WARNING(unzipLog) << "Unable to set last modified time on file" << name;
     }
 
     if (ec != UnZip::Ok) {
         if (!outFile.remove())
-            qDebug() << QString("Unable to remove corrupted file: %1").arg(name);
+            ZIP_WARNING(unzipLog) << "Unable to remove corrupted file" << name;
     }
 
     return ec;
@@ -746,8 +1265,8 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
 
 //! \internal
 UnZip::ErrorCode UnzipPrivate::extractStoredFile(
-    const quint32 szComp, quint32** keys, quint32& myCRC, QIODevice* outDev,
-    UnZip::ExtractionOptions options)
+    const quint32 szComp, quint32** keys, ZipAesCipher* aes, quint32& myCRC,
+    QIODevice* outDev, UnZip::ExtractionOptions options)
 {
     const bool verify = (options & UnZip::VerifyOnly);
     const bool isEncrypted = keys != 0;
@@ -760,16 +1279,27 @@ UnZip::ErrorCode UnzipPrivate::extractStoredFile(
     qint64 read;
     quint64 tot = 0;
 
+    ZipStopwatch watch;
     while ( (read = device->read(buffer1, cur < rep ? UNZIP_READ_BUFFER : rem)) > 0 ) {
+        watch.lap(stats.readTime);
         if (isEncrypted)
             decryptBytes(*keys, buffer1, read);
+        else if (aes)
+            aes->decrypt(buffer1, read);
+        watch.lap(stats.compressTime);
 
-        myCRC = crc32(myCRC, uBuffer, read);
+        myCRC = ZipCrc32::update(myCRC, buffer1, read);
+        watch.lap(stats.crcTime);
         if (!verify) {
             if (outDev->write(buffer1, read) != read)
                 return UnZip::WriteFailed;
+            watch.lap(stats.writeTime);
         }
 
+        if (!progress(read, read))
+            return UnZip::Canceled;
+        watch.restart();
+
         cur++;
         tot += read;
         if (tot == szComp)
@@ -782,12 +1312,13 @@ UnZip::ErrorCode UnzipPrivate::extractStoredFile(
 }
 
 //! \internal
-UnZip::ErrorCode UnzipPrivate::inflateFile(
-    const quint32 szComp, quint32** keys, quint32& myCRC, QIODevice* outDev,
-    UnZip::ExtractionOptions options)
+UnZip::ErrorCode UnzipPrivate::decompressFile(const ZipCodec* codec,
+    const quint32 szComp, quint32** keys, ZipAesCipher* aes, quint32& myCRC,
+    QIODevice* outDev, UnZip::ExtractionOptions options)
 {
     const bool verify = (options & UnZip::VerifyOnly);
     const bool isEncrypted = keys != 0;
+    Q_ASSERT(codec);
     Q_ASSERT(verify ? true : outDev != 0);
 
     uInt rep = szComp / UNZIP_READ_BUFFER;
@@ -798,74 +1329,73 @@ UnZip::ErrorCode UnzipPrivate::inflateFile(
     qint64 read;
     quint64 tot = 0;
 
-    /* Allocate inflate state */
-    z_stream zstr;
-    zstr.zalloc = Z_NULL;
-    zstr.zfree = Z_NULL;
-    zstr.opaque = Z_NULL;
-    zstr.next_in = Z_NULL;
-    zstr.avail_in = 0;
+    QScopedPointer<ZipCodecStream> zstr(codec->createDecompressor());
+    if (zstr.isNull())
+        return UnZip::ZlibInit;
 
-    int zret;
-
-    // Use inflateInit2 with negative windowBits to get raw decompression
-    if ( (zret = inflateInit2_(&zstr, -MAX_WBITS, ZLIB_VERSION, sizeof(z_stream))) != Z_OK )
-        return UnZip::ZlibError;
+    ZipCodecStream::Result zret = ZipCodecStream::Ok;
 
     int szDecomp;
+    ZipStopwatch watch;
 
-    // Decompress until deflate stream ends or end of file
+    // Decompress until the compressed stream ends or end of file
     do {
         read = device->read(buffer1, cur < rep ? UNZIP_READ_BUFFER : rem);
+        watch.lap(stats.readTime);
         if (!read)
             break;
 
-        if (read < 0) {
-            (void)inflateEnd(&zstr);
+        if (read < 0)
             return UnZip::ReadFailed;
-        }
 
         if (isEncrypted)
             decryptBytes(*keys, buffer1, read);
+        else if (aes)
+            aes->decrypt(buffer1, read);
+
+        qint64 decompressed = 0;
 
         cur++;
         tot += read;
 
-        zstr.avail_in = (uInt) read;
-        zstr.next_in = (Bytef*) buffer1;
+        zstr->availIn = (quint32) read;
+        zstr->nextIn = buffer1;
 
-        // Run inflate() on input until output buffer not full
+        // Run the codec on input until output buffer not full
         do {
-            zstr.avail_out = UNZIP_READ_BUFFER;
-            zstr.next_out = (Bytef*) buffer2;;
+            zstr->availOut = UNZIP_READ_BUFFER;
+            zstr->nextOut = buffer2;
 
-            zret = inflate(&zstr, Z_NO_FLUSH);
+            zret = zstr->process(tot == szComp);
+            watch.lap(stats.compressTime);
 
             switch (zret) {
-            case Z_NEED_DICT:
-            case Z_DATA_ERROR:
-            case Z_MEM_ERROR:
-                inflateEnd(&zstr);
-                return UnZip::WriteFailed;
+            case ZipCodecStream::DataError:
+            case ZipCodecStream::MemoryError:
+                return UnZip::ZlibError;
             default:
                 ;
             }
 
-            szDecomp = UNZIP_READ_BUFFER - zstr.avail_out;
+            szDecomp = UNZIP_READ_BUFFER - zstr->availOut;
             if (!verify) {
-                if (outDev->write(buffer2, szDecomp) != szDecomp) {
-                    inflateEnd(&zstr);
-                    return UnZip::ZlibError;
-                }
+                if (outDev->write(buffer2, szDecomp) != szDecomp)
+                    return UnZip::WriteFailed;
+                watch.lap(stats.writeTime);
             }
 
-            myCRC = crc32(myCRC, (const Bytef*) buffer2, szDecomp);
+            myCRC = ZipCrc32::update(myCRC, buffer2, szDecomp);
+            watch.lap(stats.crcTime);
+            decompressed += szDecomp;
 
-        } while (zstr.avail_out == 0);
+        } while (zstr->availOut == 0);
 
-    } while (zret != Z_STREAM_END);
+        if (!progress(read, decompressed))
+            return UnZip::Canceled;
+        watch.restart();
+
+    } while (zret != ZipCodecStream::StreamEnd && tot < szComp);
 
-    inflateEnd(&zstr);
     return UnZip::Ok;
 }
 
@@ -879,6 +1409,15 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
     Q_ASSERT(device);
     Q_ASSERT(verify ? true : outDev != 0);
 
+    const ZipTraceTimer traceTimer(ZIP_TRACE_ENABLED(unzipLog));
+
+    if (isCanceled())
+        return UnZip::Canceled;
+
+    stats.entry = path;
+    stats.entrySize = entry.szUncomp;
+    stats.entryBytesIn = stats.entryBytesOut = 0;
+
     if (!entry.lhEntryChecked) {
         UnZip::ErrorCode ec = parseLocalHeaderRecord(path, entry);
         entry.lhEntryChecked = true;
@@ -892,11 +1431,23 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
     // Encryption keys
     quint32 keys[3];
     quint32 szComp = entry.szComp;
-    if (entry.isEncrypted()) {
+    ZipAesCipher aes;
+    if (entry.isAesEncrypted()) {
+        UnZip::ErrorCode e = testAesPassword(aes, path, entry);
+        if (e != UnZip::Ok) {
+            ZIP_WARNING(unzipLog) << "Unable to decrypt" << path;
+            return e;
+        }
+        // remove salt, password verification value and authentication code size
+        const quint32 aesSize = ZipAesCipher::saltSize(entry.aesStrength) + ZIP_AES_PWV_SIZE + ZIP_AES_AUTH_SIZE;
+        if (szComp < aesSize)
+            return UnZip::Corrupted;
+        szComp -= aesSize;
+    } else if (entry.isEncrypted()) {
         UnZip::ErrorCode e = testPassword(keys, path, entry);
         if (e != UnZip::Ok)
         {
-            qDebug() << QString("Unable to decrypt %1").arg(path);
+            ZIP_WARNING(unzipLog) << "Unable to decrypt" << path;
             return e;
         }//! Encryption header size
         szComp -= UNZIP_LOCAL_ENC_HEADER_SIZE; // remove encryption header size
@@ -905,57 +1456,485 @@ UnZip::ErrorCode UnzipPrivate::extractFile(const QString& path, const ZipEntryP&
     if (szComp == 0) {
         if (entry.crc != 0)
             return UnZip::Corrupted;
+        ++stats.entries;
+        if (observer)
+            observer->entryFinished(stats);
         return UnZip::Ok;
     }
 
-    quint32 myCRC = crc32(0L, Z_NULL, 0);
+    quint32 myCRC = 0;
     quint32* k = keys;
+    quint32** pkzipKeys = entry.isEncrypted() && !entry.isAesEncrypted() ? &k : 0;
+    ZipAesCipher* aesCipher = entry.isAesEncrypted() ? &aes : 0;
 
     UnZip::ErrorCode ec = UnZip::Ok;
-    if (entry.compMethod == 0) {
-        ec = extractStoredFile(szComp, entry.isEncrypted() ? &k : 0, myCRC, outDev, options);
-    } else if (entry.compMethod == 8) {
-        ec = inflateFile(szComp, entry.isEncrypted() ? &k : 0, myCRC, outDev, options);
+    if (entry.compMethod == ZIP_METHOD_STORED) {
+        ec = extractStoredFile(szComp, pkzipKeys, aesCipher, myCRC, outDev, options);
+    } else {
+        const ZipCodec* codec = ZipCodec::codecForMethod(entry.compMethod);
+        if (!codec)
+            return UnZip::ZlibInit;
+        ec = decompressFile(codec, szComp, pkzipKeys, aesCipher, myCRC, outDev, options);
     }
 
-    if (ec == UnZip::Ok && myCRC != entry.crc)
-        return UnZip::Corrupted;
+    // The authentication code follows the encrypted data
+    if (ec == UnZip::Ok && aesCipher) {
+        if (!device->seek(entry.dataOffset + entry.szComp - ZIP_AES_AUTH_SIZE))
+            return UnZip::SeekFailed;
+        if (device->read(buffer1, ZIP_AES_AUTH_SIZE) != ZIP_AES_AUTH_SIZE)
+            return UnZip::ReadFailed;
+        aes.authenticationCode(buffer2);
+        if (memcmp(buffer1, buffer2, ZIP_AES_AUTH_SIZE) != 0) {
+            ZIP_WARNING(unzipLog) << "AES authentication failed for" << path;
+            return UnZip::Corrupted;
+        }
+    }
 
-    return UnZip::Ok;
-}
+    // AE-2 entries have no CRC
+    if (ec == UnZip::Ok && entry.aesVersion != 2 && myCRC != entry.crc)
+        ec = UnZip::Corrupted;
 
-//! \internal Creates a new directory and all the needed parent directories.
-bool UnzipPrivate::createDirectory(const QString& path)
-{
-    QDir d(path);
-    if (!d.exists() && !d.mkpath(path)) {
-        qDebug() << QString("Unable to create directory: %1").arg(path);
-        return false;
+    if (ec == UnZip::Ok) {
+        ++stats.entries;
+        if (observer)
+            observer->entryFinished(stats);
     }
 
-    return true;
+    ZIP_TRACE(unzipLog) << (verify ? "verify" : "extract") << " entry=" << path
+        << " bytes=" << entry.szUncomp << " compressed=" << entry.szComp
+        << " us=" << traceTimer.usecs() << " method=" << entry.compMethod
+        << " result=" << int(ec);
+
+    return ec;
 }
 
-/*!
- \internal Reads an quint32 (4 bytes) from a byte array starting at given offset.
-*/
-quint32 UnzipPrivate::getULong(const unsigned char* data, quint32 offset) const
+//! \internal State shared by the search workers (see UnzipPrivate::search()).
+struct UnzipSearch
 {
-    quint32 res = (quint32) data[offset];
-    res |= (((quint32)data[offset+1]) << 8);
-    res |= (((quint32)data[offset+2]) << 16);
-    res |= (((quint32)data[offset+3]) << 24);
+    QString pattern;
+    QString filter;
+    UnZip::SearchOptions options;
+    QAtomicInt next;
+    // By entry position, to return the hits in the order of the entries
+    QMap<int,QList<UnZip::SearchHit> > hits;
+    QMap<int,UnZip::ErrorCode> errors;
+};
+
+#ifndef QT_NO_THREAD
+//! Searches entries of an archive through a private device until none is left.
+class UnzipSearchTask : public QRunnable
+{
+public:
+    UnzipSearchTask(UnzipPrivate* a, QIODevice* dev, UnzipSearch* s) :
+        archive(a), device(dev), search(s) {}
 
-    return res;
+    void run() { archive->searchEntries(device, search); }
+
+private:
+    UnzipPrivate* archive;
+    QIODevice* device;
+    UnzipSearch* search;
+};
+
+//! Verifies entries of an archive through a private device until none is left.
+class UnzipVerifyTask : public QRunnable
+{
+public:
+    UnzipVerifyTask(UnzipPrivate* a, QIODevice* dev, QAtomicInt* n,
+        QMap<QString,UnZip::ErrorCode>* e) :
+        archive(a), device(dev), next(n), errors(e) {}
+
+    void run() { archive->verifyEntries(device, next, errors); }
+
+private:
+    UnzipPrivate* archive;
+    QIODevice* device;
+    QAtomicInt* next;
+    QMap<QString,UnZip::ErrorCode>* errors;
+};
+#endif
+
+/*! \internal Returns up to \p threads devices reading the archive with a
+    file handle or a buffer of their own, or less than two if the archive
+    is open on a device that is neither a QFile nor a QBuffer.
+*/
+QList<QIODevice*> UnzipPrivate::workerDevices(int threads) const
+{
+    // Positional reads: every worker seeks its own file handle or buffer
+    QFile* f = qobject_cast<QFile*>(archiveDevice());
+    QBuffer* b = qobject_cast<QBuffer*>(archiveDevice());
+    QList<QIODevice*> devices;
+    while (threads > 1 && (f || b) && devices.size() < threads) {
+        QIODevice* dev = 0;
+        if (f) {
+            dev = new QFile(f->fileName());
+        } else {
+            QBuffer* buffer = new QBuffer;
+            buffer->setData(b->data());
+            dev = buffer;
+        }
+        if (!dev->open(QIODevice::ReadOnly)) {
+            delete dev;
+            break;
+        }
+        devices.append(dev);
+    }
+    return devices;
 }
 
-/*!
- \internal Reads an quint64 (8 bytes) from a byte array starting at given offset.
+/*! \internal Verifies all the entries with up to \p threads workers, each
+    reading the archive through its own device, and collects the failed
+    entries in \p errors. Archives open on a device that is neither a QFile
+    nor a QBuffer are verified on the calling thread.
 */
-quint64 UnzipPrivate::getULLong(const unsigned char* data, quint32 offset) const
+UnZip::ErrorCode UnzipPrivate::verifyArchive(int threads, QMap<QString,UnZip::ErrorCode>* errors)
 {
-    quint64 res = (quint64) data[offset];
-    res |= (((quint64)data[offset+1]) << 8);
+    const ZipTraceTimer traceTimer(ZIP_TRACE_ENABLED(unzipLog));
+
+    buildEntryTable();
+    const int count = headers ? entryTable.size() : index.count();
+
+    QMap<QString,UnZip::ErrorCode> failed;
+    QAtomicInt next(0);
+    bool done = false;
+
+#ifndef QT_NO_THREAD
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    threads = qMin(threads, count);
+
+    QList<QIODevice*> devices = workerDevices(threads);
+    if (devices.size() > 1) {
+        QThreadPool pool;
+        pool.setMaxThreadCount(devices.size());
+        for (int i = 0; i < devices.size(); ++i)
+            pool.start(new UnzipVerifyTask(this, devices.at(i), &next, &failed));
+        pool.waitForDone();
+        done = true;
+    }
+    qDeleteAll(devices);
+#else
+    Q_UNUSED(threads);
+#endif
+
+    if (!done) {
+        threads = 1;
+        verifyEntries(device, &next, &failed);
+    }
+
+    ZIP_TRACE(unzipLog) << "verify entries=" << count << " threads=" << threads
+        << " errors=" << failed.size() << " us=" << traceTimer.usecs();
+
+    if (errors)
+        *errors = failed;
+    if (isCanceled())
+        return UnZip::Canceled;
+    return failed.isEmpty() ? UnZip::Ok : failed.constBegin().value();
+}
+
+/*! \internal Verifies the entries from position \p next on, reading from
+    \p dev with a private worker object, until all the entries have been taken.
+    Errors are added to \p errors and do not stop the verification.
+*/
+void UnzipPrivate::verifyEntries(QIODevice* dev, QAtomicInt* next, QMap<QString,UnZip::ErrorCode>* errors)
+{
+    // Workers read through their own cache
+    QScopedPointer<ZipBlockCache> workerCache;
+    if (cacheBlockSize > 0 && dev != device) {
+        workerCache.reset(new ZipBlockCache(dev, cacheBlockSize, cacheBlocks));
+        workerCache->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        dev = workerCache.data();
+    }
+
+    // Buffers and keys must not be shared: use a private object
+    QScopedPointer<UnzipPrivate> worker(new UnzipPrivate);
+    worker->owner = this;
+    worker->device = dev;
+    worker->password = password;
+
+    const int count = headers ? entryTable.size() : index.count();
+    ZipEntryP buffer;
+
+    for (;;) {
+        const int i = next->fetchAndAddRelaxed(1);
+        if (i >= count || isCanceled())
+            break;
+
+        QString name;
+        const ZipEntryP* entry = &buffer;
+        if (headers) {
+            name = entryTable.at(i).key();
+            entry = entryTable.at(i).value();
+        } else {
+            name = index.name(i);
+            index.entry(i, buffer);
+        }
+
+        if (name.endsWith(QLatin1Char('/')))
+            continue;
+
+        worker->stats.reset();
+        const UnZip::ErrorCode ec = worker->extractFile(name, *entry, (QIODevice*) 0, UnZip::VerifyOnly);
+
+        QMutexLocker locker(&verifyMutex);
+        stats.merge(worker->stats);
+        switch (ec) {
+        case UnZip::Ok:
+            if (observer) {
+                observer->entryFinished(stats);
+                if (!observer->progress(stats))
+                    canceled.fetchAndStoreRelaxed(1);
+            }
+            break;
+        case UnZip::Canceled:
+        case UnZip::Skip:
+        case UnZip::SkipAll:
+            // Not an error of the entry (as in extractAll())
+            break;
+        default:
+            ZIP_WARNING(unzipLog) << "Unable to verify" << name << "error" << int(ec);
+            errors->insert(name, ec);
+        }
+    }
+
+    if (workerCache) {
+        QMutexLocker locker(&verifyMutex);
+        stats.cacheHits += workerCache->hits();
+        stats.cacheMisses += workerCache->misses();
+    }
+
+    // The device belongs to the caller
+    worker->device = 0;
+}
+
+/*! \internal Searches the entries matching the filter with up to \p threads
+    workers, like verifyArchive(), and collects the hits in \p search.
+*/
+UnZip::ErrorCode UnzipPrivate::search(UnzipSearch* search, int threads)
+{
+    const ZipTraceTimer traceTimer(ZIP_TRACE_ENABLED(unzipLog));
+
+    buildEntryTable();
+    const int count = headers ? entryTable.size() : index.count();
+    bool done = false;
+
+#ifndef QT_NO_THREAD
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    threads = qMin(threads, count);
+
+    QList<QIODevice*> devices = workerDevices(threads);
+    if (devices.size() > 1) {
+        QThreadPool pool;
+        pool.setMaxThreadCount(devices.size());
+        for (int i = 0; i < devices.size(); ++i)
+            pool.start(new UnzipSearchTask(this, devices.at(i), search));
+        pool.waitForDone();
+        done = true;
+    }
+    qDeleteAll(devices);
+#else
+    Q_UNUSED(threads);
+#endif
+
+    if (!done) {
+        threads = 1;
+        searchEntries(device, search);
+    }
+
+    ZIP_TRACE(unzipLog) << "search entries=" << count << " threads=" << threads
+        << " matching=" << search->hits.size() << " us=" << traceTimer.usecs();
+
+    if (isCanceled())
+        return UnZip::Canceled;
+    return search->errors.isEmpty() ? UnZip::Ok : search->errors.constBegin().value();
+}
+
+/*! \internal Decompresses the entries matching the filter from position
+    search->next on into a search sink, reading from \p dev with a private
+    worker object, until all the entries have been taken.
+*/
+void UnzipPrivate::searchEntries(QIODevice* dev, UnzipSearch* search)
+{
+    // Workers read through their own cache
+    QScopedPointer<ZipBlockCache> workerCache;
+    if (cacheBlockSize > 0 && dev != device) {
+        workerCache.reset(new ZipBlockCache(dev, cacheBlockSize, cacheBlocks));
+        workerCache->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        dev = workerCache.data();
+    }
+
+    // Buffers and keys must not be shared: use a private object
+    QScopedPointer<UnzipPrivate> worker(new UnzipPrivate);
+    worker->owner = this;
+    worker->device = dev;
+    worker->password = password;
+
+    ZipSearchSink sink(search->pattern, search->options);
+    const bool matchPath = search->filter.contains(QLatin1Char('/'));
+
+    const int count = headers ? entryTable.size() : index.count();
+    ZipEntryP buffer;
+
+    for (;;) {
+        const int i = search->next.fetchAndAddRelaxed(1);
+        if (i >= count || isCanceled())
+            break;
+
+        QString name;
+        const ZipEntryP* entry = &buffer;
+        if (headers) {
+            name = entryTable.at(i).key();
+            entry = entryTable.at(i).value();
+        } else {
+            name = index.name(i);
+            index.entry(i, buffer);
+        }
+
+        if (name.endsWith(QLatin1Char('/')))
+            continue;
+
+        // Same rules as Zip::setDeflateParameters()
+        if (!search->filter.isEmpty()) {
+            const QString fileName = matchPath ? name : name.mid(name.lastIndexOf(QLatin1Char('/')) + 1);
+            if (!ZipDirScanner::wildcardMatch(search->filter, fileName))
+                continue;
+        }
+
+        sink.start(name);
+        worker->stats.reset();
+        const UnZip::ErrorCode ec = worker->extractFile(name, *entry, &sink, UnZip::ExtractPaths);
+        if (ec == UnZip::Ok)
+            sink.finish();
+
+        QMutexLocker locker(&verifyMutex);
+        stats.merge(worker->stats);
+        switch (ec) {
+        case UnZip::Ok:
+            if (!sink.hits().isEmpty())
+                search->hits.insert(i, sink.hits());
+            if (observer) {
+                observer->entryFinished(stats);
+                if (!observer->progress(stats))
+                    canceled.fetchAndStoreRelaxed(1);
+            }
+            break;
+        case UnZip::Canceled:
+        case UnZip::Skip:
+        case UnZip::SkipAll:
+            // Not an error of the entry (as in extractAll())
+            break;
+        default:
+            ZIP_WARNING(unzipLog) << "Unable to search" << name << "error" << int(ec);
+            search->errors.insert(i, ec);
+        }
+    }
+
+    if (workerCache) {
+        QMutexLocker locker(&verifyMutex);
+        stats.cacheHits += workerCache->hits();
+        stats.cacheMisses += workerCache->misses();
+    }
+
+    // The device belongs to the caller
+    worker->device = 0;
+}
+
+/*! \internal Removes the entries of an archive opened from a device other
+    than a file from the entry cache: they can't be found again once it is closed.
+*/
+void UnzipPrivate::evictDeviceEntries()
+{
+    if (entryCache && cacheIdentity.startsWith(QLatin1String("device:")))
+        entryCache->removeByPrefix(cacheIdentity);
+}
+
+//! \internal True if \p entry can be kept in the entry cache.
+bool UnzipPrivate::isCacheable(const ZipEntryP& entry) const
+{
+    // Decrypted data is never kept in memory
+    return entryCache && !entry.isEncrypted() && entry.szUncomp <= entryCache->maxBytes();
+}
+
+/*! \internal Sets \p data to the contents of an entry, taken from the entry
+    cache if possible or decompressed and added to the cache.
+*/
+UnZip::ErrorCode UnzipPrivate::extractCached(const QString& path, const ZipEntryP& entry, QByteArray& data)
+{
+    data.clear();
+
+    const bool cacheable = isCacheable(entry);
+    QString key;
+    if (cacheable) {
+        if (cacheIdentity.isEmpty()) {
+            // Files are shared by UnZip objects; other devices only while they are open
+            QIODevice* dev = archiveDevice();
+            QFile* f = qobject_cast<QFile*>(dev);
+            if (f) {
+                const QFileInfo info(f->fileName());
+                const QDateTime modified = info.lastModified();
+                cacheIdentity = QString::fromLatin1("%1|%2|%3|%4|")
+                    .arg(info.absoluteFilePath()).arg(info.size())
+                    .arg(modified.toTime_t() * Q_INT64_C(1000) + modified.time().msec())
+                    .arg(cdOffset);
+            } else {
+                // Devices can be reused or reallocated at the same address:
+                // use a number that is never reused in this process
+                static QAtomicInt serial(0);
+                cacheIdentity = QString::fromLatin1("device:%1|")
+                    .arg(serial.fetchAndAddRelaxed(1) + 1);
+            }
+        }
+        key = cacheIdentity + path;
+        if (entryCache->find(key, &data))
+            return UnZip::Ok;
+    }
+
+    data.reserve(entry.szUncomp);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    const UnZip::ErrorCode ec = extractFile(path, entry, &buffer, UnZip::ExtractPaths);
+    buffer.close();
+
+    if (ec != UnZip::Ok)
+        data.clear();
+    else if (cacheable)
+        entryCache->insert(key, data);
+    return ec;
+}
+
+//! \internal Creates a new directory and all the needed parent directories.
+bool UnzipPrivate::createDirectory(const QString& path)
+{
+    QDir d(path);
+    if (!d.exists() && !d.mkpath(path)) {
+        ZIP_WARNING(unzipLog) << "Unable to create directory" << path;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ \internal Reads an quint32 (4 bytes) from a byte array starting at given offset.
+*/
+quint32 UnzipPrivate::getULong(const unsigned char* data, quint32 offset) const
+{
+    quint32 res = (quint32) data[offset];
+    res |= (((quint32)data[offset+1]) << 8);
+    res |= (((quint32)data[offset+2]) << 16);
+    res |= (((quint32)data[offset+3]) << 24);
+
+    return res;
+}
+
+/*!
+ \internal Reads an quint64 (8 bytes) from a byte array starting at given offset.
+*/
+quint64 UnzipPrivate::getULLong(const unsigned char* data, quint32 offset) const
+{
+    quint64 res = (quint64) data[offset];
+    res |= (((quint64)data[offset+1]) << 8);
     res |= (((quint64)data[offset+2]) << 16);
     res |= (((quint64)data[offset+3]) << 24);
     res |= (((quint64)data[offset+1]) << 32);
@@ -1053,6 +2032,61 @@ bool UnzipPrivate::testKeys(const ZipEntryP& header, quint32* keys)
     return (lastByte == c);
 }
 
+/*!
+ \internal Derives the AES keys for an entry and tests the password using the
+ password verification value that follows the salt.
+*/
+UnZip::ErrorCode UnzipPrivate::testAesPassword(ZipAesCipher& aes, const QString& file, const ZipEntryP& header)
+{
+    Q_UNUSED(file);
+    Q_ASSERT(device);
+
+    const int saltSize = ZipAesCipher::saltSize(header.aesStrength);
+    if (device->read(buffer1, saltSize + ZIP_AES_PWV_SIZE) != saltSize + ZIP_AES_PWV_SIZE)
+        return UnZip::Corrupted;
+
+    // Replace this code if you want to i.e. call some dialog and ask the user for a password
+    char verifier[ZIP_AES_PWV_SIZE];
+    if (!aes.init(password.toUtf8(), buffer1, header.aesStrength, verifier))
+        return UnZip::Corrupted;
+
+    if (memcmp(verifier, buffer1 + saltSize, ZIP_AES_PWV_SIZE) == 0)
+        return UnZip::Ok;
+
+    return UnZip::Skip;
+}
+
+/*!
+ \internal Looks for the WinZip AES extra field (header ID 0x9901) in an extra
+ field block and reads the actual compression method, the key strength and
+ the vendor version (AE-1 or AE-2).
+*/
+bool UnzipPrivate::parseAesExtraField(const unsigned char* data, quint16 size,
+    quint16& method, quint8& strength, quint16& version) const
+{
+    quint32 offset = 0;
+    while (offset + 4 <= size) {
+        const quint16 id = getUShort(data, offset);
+        const quint16 sz = getUShort(data, offset + 2);
+        offset += 4;
+        if (offset + sz > size)
+            break;
+
+        if (id == ZIP_AES_EXTRA_ID && sz >= ZIP_AES_EXTRA_SIZE - 4) {
+            version = getUShort(data, offset);
+            strength = data[offset + 4];
+            method = getUShort(data, offset + 5);
+            return (version == 1 || version == 2)
+                && data[offset + 2] == 'A' && data[offset + 3] == 'E'
+                && ZipAesCipher::saltSize(strength) != 0;
+        }
+
+        offset += sz;
+    }
+
+    return false;
+}
+
 /*!
  \internal Decrypts an array of bytes long \p read.
 */
@@ -1123,20 +2157,19 @@ UnZip::ErrorCode UnZip::openArchive(const QString& filename)
     closeArchive();
 
     // closeArchive will destroy the file
-    d->file = new QFile(filename);
+    QFile* file = new QFile(filename);
 
-    if (!d->file->exists()) {
-        delete d->file;
-        d->file = 0;
+    if (!file->exists()) {
+        delete file;
         return UnZip::FileNotFound;
     }
 
-    if (!d->file->open(QIODevice::ReadOnly)) {
-        delete d->file;
-        d->file = 0;
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
         return UnZip::OpenFailed;
     }
 
+    d->file = file;
     return d->openArchive(d->file);
 }
 
@@ -1150,13 +2183,37 @@ UnZip::ErrorCode UnZip::openArchive(QIODevice* device)
     closeArchive();
 
     if (!device) {
-        qDebug() << "Invalid device.";
+        ZIP_WARNING(unzipLog) << "Invalid device.";
         return UnZip::InvalidDevice;
     }
 
     return d->openArchive(device);
 }
 
+/*!
+ Opens a zip archive stored as \p filename in another open \p archive,
+ without extracting it (see openEntry()). Closes any previously opened archive.
+ \p archive must stay open unless it has been opened from a file or a QBuffer.
+*/
+UnZip::ErrorCode UnZip::openArchive(UnZip& archive, const QString& filename)
+{
+    closeArchive();
+
+    if (&archive == this) {
+        ZIP_WARNING(unzipLog) << "Invalid device.";
+        return UnZip::InvalidDevice;
+    }
+
+    UnZip::ErrorCode ec = UnZip::Ok;
+    QIODevice* dev = archive.d->openEntry(filename, ec);
+    if (!dev)
+        return ec;
+
+    // closeArchive will destroy the device
+    d->file = dev;
+    return d->openArchive(d->file);
+}
+
 /*!
  Closes the archive and releases all the used resources (like cached passwords).
 */
@@ -1193,6 +2250,8 @@ QString UnZip::formatError(UnZip::ErrorCode c) const
     case InvalidDevice: return QCoreApplication::translate("UnZip", "Invalid device."); break;
     case InvalidArchive: return QCoreApplication::translate("UnZip", "Invalid or incompatible zip archive."); break;
     case HeaderConsistencyError: return QCoreApplication::translate("UnZip", "Inconsistent headers. Archive might be corrupted."); break;
+    case Canceled: return QCoreApplication::translate("UnZip", "Operation canceled."); break;
+    case InvalidPattern: return QCoreApplication::translate("UnZip", "Invalid search pattern."); break;
     default: ;
     }
 
@@ -1204,7 +2263,9 @@ QString UnZip::formatError(UnZip::ErrorCode c) const
 */
 bool UnZip::contains(const QString& file) const
 {
-    return d->headers ? d->headers->contains(file) : false;
+    if (d->headers)
+        return d->headers->contains(file);
+    return d->index.find(file) >= 0;
 }
 
 /*!
@@ -1212,7 +2273,13 @@ bool UnZip::contains(const QString& file) const
 */
 QStringList UnZip::fileList() const
 {
-    return d->headers ? d->headers->keys() : QStringList();
+    if (d->headers)
+        return d->headers->keys();
+
+    QStringList list;
+    for (int i = 0; i < d->index.count(); ++i)
+        list.append(d->index.name(i));
+    return list;
 }
 
 /*!
@@ -1221,33 +2288,219 @@ QStringList UnZip::fileList() const
 QList<UnZip::ZipEntry> UnZip::entryList() const
 {
     QList<UnZip::ZipEntry> list;
-    if (!d->headers)
-        return list;
+    EntryView view;
+    view.d = d;
+
+    if (d->headers) {
+        for (QMap<QString,ZipEntryP*>::ConstIterator it = d->headers->constBegin();
+        it != d->headers->constEnd(); ++it) {
+            Q_ASSERT(it.value() != 0);
+            view.name = &it.key();
+            view.entry = it.value();
+            ++view.position;
+            list.append(view.toZipEntry());
+        }
+    } else {
+        for (view.position = 0; view.position < d->index.count(); ++view.position)
+            list.append(view.toZipEntry());
+    }
 
-    for (QMap<QString,ZipEntryP*>::ConstIterator it = d->headers->constBegin();
-    it != d->headers->constEnd(); ++it) {
-        const ZipEntryP* entry = it.value();
-        Q_ASSERT(entry != 0);
+    return list;
+}
 
-        ZipEntry z;
+/*!
+ Returns the number of (correctly parsed) entries of this archive.
+*/
+int UnZip::entryCount() const
+{
+    return d->headers ? d->headers->size() : d->index.count();
+}
 
-        z.filename = it.key();
-        if (!entry->comment.isEmpty())
-            z.comment = entry->comment;
-        z.compressedSize = entry->szComp;
-        z.uncompressedSize = entry->szUncomp;
-        z.crc32 = entry->crc;
-        z.lastModified = d->convertDateTime(entry->modDate, entry->modTime);
+/*!
+ Returns a view of the entry at position \p i (0 to entryCount() - 1,
+ sorted by name) or an invalid view. The first call builds a table of the
+ entries; later calls are constant time.
+*/
+UnZip::EntryView UnZip::entryAt(int i) const
+{
+    EntryView view;
+    if (i < 0 || i >= entryCount())
+        return view;
+
+    view.d = d;
+    view.position = i;
+    if (d->headers) {
+        d->buildEntryTable();
+        const QMap<QString,ZipEntryP*>::ConstIterator it = d->entryTable.at(i);
+        view.name = &it.key();
+        view.entry = it.value();
+    }
+    return view;
+}
 
-        z.compression = entry->compMethod == 0 ? NoCompression : entry->compMethod == 8 ? Deflated : UnknownCompression;
-        z.type = z.filename.endsWith("/") ? Directory : File;
+/*!
+ Returns a view of the entry with the given path and name or an invalid view.
+ Nothing is copied.
+*/
+UnZip::EntryView UnZip::entry(const QString& name) const
+{
+    EntryView view;
+    if (!d->headers) {
+        const int i = d->index.find(name);
+        if (i >= 0) {
+            view.d = d;
+            view.position = i;
+        }
+        return view;
+    }
 
-        z.encrypted = entry->isEncrypted();
+    // Binary search, as the position is needed too
+    const int lo = d->lowerBound(name);
+    if (lo < d->entryTable.size() && d->entryTable.at(lo).key() == name) {
+        view.d = d;
+        view.position = lo;
+        view.name = &d->entryTable.at(lo).key();
+        view.entry = d->entryTable.at(lo).value();
+    }
+    return view;
+}
 
-        list.append(z);
+/*!
+ Calls \p visitor for each entry, sorted by name, until it returns false.
+ This is the cheapest way to walk the archive: nothing is copied or allocated.
+*/
+void UnZip::visitEntries(EntryVisitor& visitor) const
+{
+    EntryView view;
+    view.d = d;
+
+    if (d->headers) {
+        for (QMap<QString,ZipEntryP*>::ConstIterator it = d->headers->constBegin();
+        it != d->headers->constEnd(); ++it) {
+            view.name = &it.key();
+            view.entry = it.value();
+            ++view.position;
+            if (!visitor.visit(view))
+                return;
+        }
+    } else {
+        for (view.position = 0; view.position < d->index.count(); ++view.position)
+            if (!visitor.visit(view))
+                return;
     }
+}
 
-    return list;
+/*!
+ Compares this archive with \p other (a newer version of the archive) and
+ sets \p result to the names of the entries added to \p other, removed from
+ it, modified and unchanged.
+
+ Only the central directory records are compared by default: an entry is
+ unchanged if the CRC, the sizes and the compression method are the same.
+ Nothing is read but the central directory (or the index, see
+ setIndexFile()), so the time depends on the number of entries, not on the
+ size of the archives.
+ With CompareContents the entries with the same CRC and uncompressed size
+ are decompressed and compared too, to rule out CRC collisions and to
+ report entries compressed again with another method or level as
+ unchanged. Encrypted entries are always compared by their records.
+*/
+UnZip::ErrorCode UnZip::compare(UnZip& other, Differences& result, CompareOptions options)
+{
+    result = Differences();
+    if (!d->device || !other.d->device)
+        return NoOpenArchive;
+
+    // Both entry lists are sorted by name
+    const int count = entryCount();
+    const int otherCount = other.entryCount();
+    int i = 0;
+    int j = 0;
+    EntryView entry = entryAt(i);
+    EntryView otherEntry = other.entryAt(j);
+    QString name = entry.isValid() ? entry.filename() : QString();
+    QString otherName = otherEntry.isValid() ? otherEntry.filename() : QString();
+
+    while (i < count || j < otherCount) {
+        const int order = i == count ? 1 : j == otherCount ? -1 : QString::compare(name, otherName);
+
+        if (order < 0) {
+            result.removed.append(name);
+        } else if (order > 0) {
+            result.added.append(otherName);
+        } else {
+            bool equal = entry.crc32() == otherEntry.crc32()
+                && entry.uncompressedSize() == otherEntry.uncompressedSize();
+            if (equal && (options & CompareContents)
+                && !entry.isEncrypted() && !otherEntry.isEncrypted()) {
+                const ErrorCode ec = d->compareContents(name, *other.d, equal);
+                if (ec != Ok)
+                    return ec;
+            } else if (equal) {
+                equal = entry.compressionMethod() == otherEntry.compressionMethod()
+                    && entry.compressedSize() == otherEntry.compressedSize();
+            }
+
+            if (equal)
+                result.unchanged.append(name);
+            else result.modified.append(name);
+        }
+
+        if (order <= 0 && ++i < count) {
+            entry = entryAt(i);
+            name = entry.filename();
+        }
+        if (order >= 0 && ++j < otherCount) {
+            otherEntry = other.entryAt(j);
+            otherName = otherEntry.filename();
+        }
+    }
+
+    return Ok;
+}
+
+/*!
+ Searches the entries matching the wildcard \p filter (e.g. "*.log"; all the
+ entries if it is empty) for \p pattern and sets \p hits to the matching
+ lines, in the order of the entries. Filters containing a '/' are matched
+ against the whole path, the others against the file name only.
+
+ Entries are decompressed in memory and scanned while they are
+ decompressed, so nothing is written to disk and the memory used doesn't
+ depend on the size of the entries. Like verifyArchive(int, QMap*), up to
+ \p threads threads (one per CPU core if \p threads is 0 or negative) each
+ search their own entries through their own file handle.
+ Literals are matched byte by byte on the UTF-8 encoded \p pattern, also
+ with SearchCaseInsensitive if the pattern is ASCII (the case of ASCII
+ letters is folded); regular expressions (SearchRegExp) and case
+ insensitive non-ASCII literals are matched line by line on the UTF-8
+ decoded text.
+ Lines longer than 64K are searched in pieces.
+
+ Returns Ok, Canceled, InvalidPattern or the error of the first entry that
+ couldn't be searched; the other entries are searched anyway.
+*/
+UnZip::ErrorCode UnZip::search(const QString& pattern, const QString& filter, QList<SearchHit>& hits,
+    SearchOptions options, int threads)
+{
+    hits.clear();
+    if (!d->device)
+        return NoOpenArchive;
+    if (!ZipSearchSink(pattern, options).isValid())
+        return InvalidPattern;
+    if (!d->hasEntries())
+        return Ok;
+
+    UnzipSearch search;
+    search.pattern = pattern;
+    search.filter = filter;
+    search.options = options;
+
+    const ErrorCode ec = d->search(&search, threads);
+    for (QMap<int,QList<SearchHit> >::ConstIterator it = search.hits.constBegin();
+    it != search.hits.constEnd(); ++it)
+        hits += it.value();
+    return ec;
 }
 
 /*!
@@ -1258,6 +2511,32 @@ UnZip::ErrorCode UnZip::verifyArchive()
     return extractAll(QDir(), VerifyOnly);
 }
 
+/*!
+ Verifies the CRC (or the authentication code) of every entry with up to
+ \p threads threads (one per CPU core if \p threads is 0 or negative).
+ Nothing is written. Unlike verifyArchive(), the verification goes on after
+ a failed entry: the error of every failed entry is stored in \p errors if
+ it is not null. Encrypted entries that can't be decrypted with the current
+ password are skipped.
+ Each thread reads the archive through its own file handle, so the scan is
+ bound by the storage rather than by a single decompressor. Archives opened
+ from a device other than a QFile or a QBuffer are verified by a single thread.
+ The progress observer is notified after each entry, from the worker threads
+ but never concurrently.
+ Returns Ok, Canceled or the error of the first failed entry.
+*/
+UnZip::ErrorCode UnZip::verifyArchive(int threads, QMap<QString,ErrorCode>* errors)
+{
+    if (errors)
+        errors->clear();
+    if (!d->device)
+        return NoOpenArchive;
+    if (!d->hasEntries())
+        return Ok;
+
+    return d->verifyArchive(threads, errors);
+}
+
 /*!
  Extracts the whole archive to a directory.
 */
@@ -1276,6 +2555,7 @@ UnZip::ErrorCode UnZip::extractAll(const QDir& dir, ExtractionOptions options)
     if (!d->device)
         return NoOpenArchive;
 
+    d->loadIndexedHeaders();
     if (!d->headers)
         return Ok;
 
@@ -1295,7 +2575,7 @@ UnZip::ErrorCode UnZip::extractAll(const QDir& dir, ExtractionOptions options)
         ec = d->extractFile(it.key(), *entry, dir, options);
         switch (ec) {
         case Corrupted:
-            qDebug() << "Corrupted entry" << it.key();
+            ZIP_WARNING(unzipLog) << "Corrupted entry" << it.key();
             break;
         case CreateDirFailed:
             break;
@@ -1335,15 +2615,13 @@ UnZip::ErrorCode UnZip::extractFile(const QString& filename, const QDir& dir, Ex
 {
     if (!d->device)
         return NoOpenArchive;
-    if (!d->headers)
+    if (!d->hasEntries())
         return FileNotFound;
 
-    QMap<QString,ZipEntryP*>::Iterator itr = d->headers->find(filename);
-    if (itr != d->headers->end()) {
-        ZipEntryP* entry = itr.value();
-        Q_ASSERT(entry != 0);
-        return d->extractFile(itr.key(), *entry, dir, options);
-    }
+    ZipEntryP buffer;
+    const ZipEntryP* entry = d->findEntry(filename, buffer);
+    if (entry)
+        return d->extractFile(filename, *entry, dir, options);
 
     return FileNotFound;
 }
@@ -1355,19 +2633,71 @@ UnZip::ErrorCode UnZip::extractFile(const QString& filename, QIODevice* outDev,
 {
     if (!d->device)
         return NoOpenArchive;
-    if (!d->headers)
+    if (!d->hasEntries())
         return FileNotFound;
     if (!outDev)
         return InvalidDevice;
 
-    QMap<QString,ZipEntryP*>::Iterator itr = d->headers->find(filename);
-    if (itr != d->headers->end()) {
-        ZipEntryP* entry = itr.value();
-        Q_ASSERT(entry != 0);
-        return d->extractFile(itr.key(), *entry, outDev, options);
+    ZipEntryP buffer;
+    const ZipEntryP* entry = d->findEntry(filename, buffer);
+    if (!entry)
+        return FileNotFound;
+
+    if (!(options & VerifyOnly) && d->isCacheable(*entry)) {
+        QByteArray data;
+        const ErrorCode ec = d->extractCached(filename, *entry, data);
+        if (ec != Ok)
+            return ec;
+        return outDev->write(data) == data.size() ? Ok : WriteFailed;
     }
 
-    return FileNotFound;
+    return d->extractFile(filename, *entry, outDev, options);
+}
+
+/*!
+ Returns a new read only, random access device reading the data of
+ \p filename or 0 on failure, setting \p error if it is not 0.
+ The device is owned by the caller. Nothing is extracted to disk: stored
+ entries are read straight from the archive (memory mapped if possible)
+ and compressed entries are decompressed while they are read, keeping a
+ seek index so that seeking back doesn't start over from the beginning.
+ This is what openArchive() needs to open an archive stored in another
+ archive.
+
+ Archives opened from a file or a QBuffer are read with a handle of their
+ own, so the device can be used from another thread and after the archive
+ has been closed; with other devices the archive must stay open and must
+ not be used at the same time.
+ Encrypted entries are not supported (WrongPassword is returned).
+*/
+QIODevice* UnZip::openEntry(const QString& filename, ErrorCode* error)
+{
+    ErrorCode ec = Ok;
+    QIODevice* dev = d->openEntry(filename, ec);
+    if (error)
+        *error = ec;
+    return dev;
+}
+
+/*!
+ Extracts a single file to \p data. If an entry cache is set (see
+ setEntryCache()) the data is shared with the cache: extracting the same
+ file again only costs a lookup.
+*/
+UnZip::ErrorCode UnZip::extractFileData(const QString& filename, QByteArray& data)
+{
+    data.clear();
+    if (!d->device)
+        return NoOpenArchive;
+    if (!d->hasEntries())
+        return FileNotFound;
+
+    ZipEntryP buffer;
+    const ZipEntryP* entry = d->findEntry(filename, buffer);
+    if (!entry)
+        return FileNotFound;
+
+    return d->extractCached(filename, *entry, data);
 }
 
 /*!
@@ -1378,7 +2708,7 @@ UnZip::ErrorCode UnZip::extractFiles(const QStringList& filenames, const QString
 {
     if (!d->device)
         return NoOpenArchive;
-    if (!d->headers)
+    if (!d->hasEntries())
         return Ok;
 
     QDir dir(dirname);
@@ -1403,7 +2733,7 @@ UnZip::ErrorCode UnZip::extractFiles(const QStringList& filenames, const QDir& d
 {
     if (!d->device)
         return NoOpenArchive;
-    if (!d->headers)
+    if (!d->hasEntries())
         return Ok;
 
     ErrorCode ec;
@@ -1427,4 +2757,130 @@ void UnZip::setPassword(const QString& pwd)
     d->password = pwd;
 }
 
+/*!
+ Sets the cache of decompressed entries used by extractFile() with a device
+ and by extractFileData(), or disables it if \p cache is 0 (default).
+ The cache is not owned and can be shared by several UnZip objects.
+ Encrypted entries are never cached.
+*/
+void UnZip::setEntryCache(ZipEntryCache* cache)
+{
+    d->evictDeviceEntries();
+    d->entryCache = cache;
+}
+
+/*!
+ Returns the cache set with setEntryCache().
+*/
+ZipEntryCache* UnZip::entryCache() const
+{
+    return d->entryCache;
+}
+
+/*!
+ Enables a read cache of up to \p maxBlocks blocks of \p blockSize bytes
+ for the next openArchive() calls, or disables it if \p blockSize is 0
+ (default). All the reads of the archive device go through the cache, which
+ keeps the most recently used blocks and reads ahead when blocks are read
+ sequentially. Use it for devices where each read is expensive (network
+ or object-store mounts): the small reads at scattered offsets done to parse
+ the central directory and the local headers become a few large reads.
+ Hits and misses are counted in statistics().
+ A block size of 64K or more and at least 64 blocks are recommended.
+*/
+void UnZip::setReadCache(int blockSize, int maxBlocks)
+{
+    d->cacheBlockSize = qMax(0, blockSize);
+    d->cacheBlocks = maxBlocks;
+}
+
+/*!
+ Returns the block size of the read cache or 0 if it is disabled.
+*/
+int UnZip::readCacheBlockSize() const
+{
+    return d->cacheBlockSize;
+}
+
+/*!
+ Returns the maximum number of blocks in the read cache.
+*/
+int UnZip::readCacheBlocks() const
+{
+    return d->cacheBlocks;
+}
+
+/*!
+ Sets the sidecar index file used by the next openArchive() calls, or an empty
+ string to disable it (default). The index holds the parsed central directory,
+ a hash table of the entry names and the data offsets. If it has been built for
+ the archive being opened (same size, modification time and central directory
+ checksum) it is memory mapped instead of parsing the central directory and
+ entries are only loaded when needed. Otherwise the central directory is parsed
+ and the index is written again.
+ Only archives opened from a file can be indexed.
+*/
+void UnZip::setIndexFile(const QString& path)
+{
+    d->indexPath = path;
+}
+
+/*!
+ Returns the sidecar index file set with setIndexFile().
+*/
+QString UnZip::indexFile() const
+{
+    return d->indexPath;
+}
+
+/*!
+ Returns true if the open archive has been loaded from its index file.
+*/
+bool UnZip::isIndexed() const
+{
+    return d->index.isOpen();
+}
+
+/*!
+ Sets the object notified after each chunk of data and each file extracted
+ (or verified) or 0 to remove it. The observer is not owned by this object.
+*/
+void UnZip::setProgressObserver(ZipProgressObserver* observer)
+{
+    d->observer = observer;
+}
+
+/*!
+ Returns the current progress observer or 0 if none has been set.
+*/
+ZipProgressObserver* UnZip::progressObserver() const
+{
+    return d->observer;
+}
+
+/*!
+ Returns the bytes processed and the time spent reading, decompressing (and
+ decrypting), writing and computing checksums since the archive has been opened.
+ Files that are only verified are accounted as extracted, with no write time.
+*/
+ZipStatistics UnZip::statistics() const
+{
+    ZipStatistics s = d->stats;
+    if (d->cache) {
+        s.cacheHits += d->cache->hits();
+        s.cacheMisses += d->cache->misses();
+    }
+    return s;
+}
+
+/*!
+ Cancels the extraction in progress and any following one until an archive
+ is opened: they fail with Canceled. Can be called from any thread.
+ A file being extracted to a directory is removed.
+*/
+void UnZip::cancel()
+{
+    d->canceled.fetchAndStoreRelaxed(1);
+}
+
 OSDAB_END_NAMESPACE
@@ -30,8 +30,10 @@
 
 #include "zipglobal.h"
 
+#include <QtCore/QByteArray>
 #include <QtCore/QDateTime>
 #include <QtCore/QMap>
+#include <QtCore/QStringList>
 #include <QtCore/QtGlobal>
 
 #include <zlib/zlib.h>
@@ -40,11 +42,12 @@ class QDir;
 class QFile;
 class QIODevice;
 class QString;
-class QStringList;
 
 OSDAB_BEGIN_NAMESPACE(Zip)
 
 class UnzipPrivate;
+class ZipEntryCache;
+class ZipEntryP;
 
 class OSDAB_ZIP_EXPORT UnZip
 {
@@ -67,6 +70,8 @@ public:
 		InvalidDevice,
 		InvalidArchive,
 		HeaderConsistencyError,
+		Canceled,
+		InvalidPattern,
 
 		Skip, SkipAll // internal use only
 	};
@@ -80,9 +85,24 @@ public:
 	};
 	Q_DECLARE_FLAGS(ExtractionOptions, ExtractionOption)
 
+	enum CompareOption
+	{
+		CompareMetadata = 0x0000,
+		CompareContents = 0x0001
+	};
+	Q_DECLARE_FLAGS(CompareOptions, CompareOption)
+
+	enum SearchOption
+	{
+		SearchLiteral = 0x0000,
+		SearchRegExp = 0x0001,
+		SearchCaseInsensitive = 0x0002
+	};
+	Q_DECLARE_FLAGS(SearchOptions, SearchOption)
+
 	enum CompressionMethod
 	{
-		NoCompression, Deflated, UnknownCompression
+		NoCompression, Deflated, Lzma, Zstd, UnknownCompression
 	};
 
 	enum FileType
@@ -109,6 +129,65 @@ public:
 		bool encrypted;
 	};
 
+	class OSDAB_ZIP_EXPORT EntryView
+	{
+	public:
+		EntryView();
+
+		bool isValid() const;
+		int index() const;
+
+		QString filename() const;
+		QString comment() const;
+
+		quint32 compressedSize() const;
+		quint32 uncompressedSize() const;
+		quint32 crc32() const;
+		quint16 compressionMethod() const;
+		quint16 dosDate() const;
+		quint16 dosTime() const;
+		QDateTime lastModified() const;
+
+		CompressionMethod compression() const;
+		FileType type() const;
+		bool isEncrypted() const;
+
+		ZipEntry toZipEntry() const;
+
+	private:
+		friend class UnZip;
+
+		const UnzipPrivate* d;
+		const QString* name;
+		const ZipEntryP* entry;
+		int position;
+	};
+
+	struct Differences
+	{
+		QStringList added;
+		QStringList removed;
+		QStringList modified;
+		QStringList unchanged;
+	};
+
+	struct SearchHit
+	{
+		SearchHit();
+
+		QString filename;
+		qint64 offset;
+		qint64 line;
+		QByteArray text;
+	};
+
+	class OSDAB_ZIP_EXPORT EntryVisitor
+	{
+	public:
+		virtual ~EntryVisitor();
+		virtual bool visit(const EntryView& entry) = 0;
+	};
+
 	UnZip();
 	virtual ~UnZip();
 
@@ -116,6 +195,7 @@ public:
 
 	ErrorCode openArchive(const QString& filename);
 	ErrorCode openArchive(QIODevice* device);
+	ErrorCode openArchive(UnZip& archive, const QString& filename);
 	void closeArchive();
 
 	QString archiveComment() const;
@@ -127,7 +207,18 @@ public:
 	QStringList fileList() const;
 	QList<ZipEntry> entryList() const;
 
+	int entryCount() const;
+	EntryView entryAt(int i) const;
+	EntryView entry(const QString& name) const;
+	void visitEntries(EntryVisitor& visitor) const;
+
+	ErrorCode compare(UnZip& other, Differences& result, CompareOptions options = CompareMetadata);
+
+	ErrorCode search(const QString& pattern, const QString& filter, QList<SearchHit>& hits,
+		SearchOptions options = SearchLiteral, int threads = 0);
+
     ErrorCode verifyArchive();
+    ErrorCode verifyArchive(int threads, QMap<QString,ErrorCode>* errors = 0);
 
 	ErrorCode extractAll(const QString& dirname, ExtractionOptions options = ExtractPaths);
 	ErrorCode extractAll(const QDir& dir, ExtractionOptions options = ExtractPaths);
@@ -135,17 +226,40 @@ public:
 	ErrorCode extractFile(const QString& filename, const QString& dirname, ExtractionOptions options = ExtractPaths);
 	ErrorCode extractFile(const QString& filename, const QDir& dir, ExtractionOptions options = ExtractPaths);
 	ErrorCode extractFile(const QString& filename, QIODevice* device, ExtractionOptions options = ExtractPaths);
+	ErrorCode extractFileData(const QString& filename, QByteArray& data);
+
+	QIODevice* openEntry(const QString& filename, ErrorCode* error = 0);
 
 	ErrorCode extractFiles(const QStringList& filenames, const QString& dirname, ExtractionOptions options = ExtractPaths);
 	ErrorCode extractFiles(const QStringList& filenames, const QDir& dir, ExtractionOptions options = ExtractPaths);
 
 	void setPassword(const QString& pwd);
 
+	void setEntryCache(ZipEntryCache* cache);
+	ZipEntryCache* entryCache() const;
+
+	void setReadCache(int blockSize, int maxBlocks = 64);
+	int readCacheBlockSize() const;
+	int readCacheBlocks() const;
+
+	void setIndexFile(const QString& path);
+	QString indexFile() const;
+	bool isIndexed() const;
+
+	void setProgressObserver(ZipProgressObserver* observer);
+	ZipProgressObserver* progressObserver() const;
+	ZipStatistics statistics() const;
+	void cancel();
+
 private:
+	friend class ZipEngineArchive;
+
 	UnzipPrivate* d;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(UnZip::ExtractionOptions)
+Q_DECLARE_OPERATORS_FOR_FLAGS(UnZip::CompareOptions)
+Q_DECLARE_OPERATORS_FOR_FLAGS(UnZip::SearchOptions)
 
 OSDAB_END_NAMESPACE
 
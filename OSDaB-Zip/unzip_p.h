@@ -41,8 +41,12 @@
 
 #include "unzip.h"
 #include "zipentry_p.h"
+#include "zipindex_p.h"
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QVector>
 #include <QtCore/QtGlobal>
 
 // zLib authors suggest using larger buffers (128K or 256K) for (de)compression (especially for inflate())
@@ -51,6 +55,11 @@
 
 OSDAB_BEGIN_NAMESPACE(Zip)
 
+class ZipAesCipher;
+class ZipBlockCache;
+class ZipCodec;
+struct UnzipSearch;
+
 class UnzipPrivate : public QObject
 {
     Q_OBJECT
@@ -66,13 +75,13 @@ public:
 	QMap<QString,ZipEntryP*>* headers;
 
 	QIODevice* device;
-    QFile* file;
+    // Device opened and owned by UnZip (archive file or entry of another archive)
+    QIODevice* file;
 
 	char buffer1[UNZIP_READ_BUFFER];
 	char buffer2[UNZIP_READ_BUFFER];
 
 	unsigned char* uBuffer;
-	const quint32* crcTable;
 
 	// Central Directory (CD) offset
 	quint32 cdOffset;
@@ -87,6 +96,34 @@ public:
 
 	QString comment;
 
+	// Decompressed entries (see UnZip::setEntryCache()), not owned
+	ZipEntryCache* entryCache;
+	// Identifies the open archive in entryCache
+	QString cacheIdentity;
+
+	// Read cache settings (see UnZip::setReadCache()); disabled if cacheBlockSize is 0
+	int cacheBlockSize;
+	int cacheBlocks;
+	// Wraps the archive device if the read cache is enabled
+	ZipBlockCache* cache;
+
+	// Sidecar index file (see UnZip::setIndexFile())
+	QString indexPath;
+	// Replaces headers until all the entries are needed
+	ZipIndex index;
+	// Entries of headers by position, built by UnZip::entryAt() and UnZip::entry()
+	QVector<QMap<QString,ZipEntryP*>::ConstIterator> entryTable;
+
+	ZipStatistics stats;
+	ZipProgressObserver* observer;
+	// Set by UnZip::cancel(), possibly from another thread, or by the observer
+	QAtomicInt canceled;
+
+	// Archive verified by this object if it is a parallel verification worker
+	UnzipPrivate* owner;
+	// Serializes the results of the verification and search workers
+	QMutex verifyMutex;
+
 	UnZip::ErrorCode openArchive(QIODevice* device);
 
 	UnZip::ErrorCode seekToCentralDirectory();
@@ -95,11 +132,37 @@ public:
 
 	void closeArchive();
 
+	QIODevice* archiveDevice() const;
+	QIODevice* openEntry(const QString& path, UnZip::ErrorCode& ec);
+
+	bool isCanceled();
+	bool progress(qint64 in, qint64 out);
+
+	QList<QIODevice*> workerDevices(int threads) const;
+	UnZip::ErrorCode verifyArchive(int threads, QMap<QString,UnZip::ErrorCode>* errors);
+	UnZip::ErrorCode compareContents(const QString& path, UnzipPrivate& other, bool& equal);
+	void verifyEntries(QIODevice* dev, QAtomicInt* next, QMap<QString,UnZip::ErrorCode>* errors);
+	UnZip::ErrorCode search(UnzipSearch* search, int threads);
+	void searchEntries(QIODevice* dev, UnzipSearch* search);
+
+	bool indexKey(ZipIndex::Key& key);
+	void loadIndexedHeaders();
+	const ZipEntryP* findEntry(const QString& path, ZipEntryP& buffer) const;
+	void buildEntryTable();
+	int lowerBound(const QString& name);
+	inline bool hasEntries() const { return headers || index.isOpen(); }
+
 	UnZip::ErrorCode extractFile(const QString& path, const ZipEntryP& entry, const QDir& dir, UnZip::ExtractionOptions options);
 	UnZip::ErrorCode extractFile(const QString& path, const ZipEntryP& entry, QIODevice* device, UnZip::ExtractionOptions options);
+	bool isCacheable(const ZipEntryP& entry) const;
+	void evictDeviceEntries();
+	UnZip::ErrorCode extractCached(const QString& path, const ZipEntryP& entry, QByteArray& data);
 
 	UnZip::ErrorCode testPassword(quint32* keys, const QString& file, const ZipEntryP& header);
 	bool testKeys(const ZipEntryP& header, quint32* keys);
+	UnZip::ErrorCode testAesPassword(ZipAesCipher& aes, const QString& file, const ZipEntryP& header);
+	bool parseAesExtraField(const unsigned char* data, quint16 size,
+		quint16& method, quint8& strength, quint16& version) const;
 
 	bool createDirectory(const QString& path);
 
@@ -118,10 +181,11 @@ private slots:
     void deviceDestroyed(QObject*);
 
 private:
-    UnZip::ErrorCode extractStoredFile(const quint32 szComp, quint32** keys,
-        quint32& myCRC, QIODevice* outDev, UnZip::ExtractionOptions options);
-    UnZip::ErrorCode inflateFile(const quint32 szComp, quint32** keys,
+    UnZip::ErrorCode extractStoredFile(const quint32 szComp, quint32** keys, ZipAesCipher* aes,
         quint32& myCRC, QIODevice* outDev, UnZip::ExtractionOptions options);
+    UnZip::ErrorCode decompressFile(const ZipCodec* codec, const quint32 szComp,
+        quint32** keys, ZipAesCipher* aes, quint32& myCRC, QIODevice* outDev,
+        UnZip::ExtractionOptions options);
     void do_closeArchive();
 };
 
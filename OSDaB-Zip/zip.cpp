@@ -27,11 +27,20 @@
 
 #include "zip.h"
 #include "zip_p.h"
+#include "unzip_p.h"
+#include "zipcodec_p.h"
+#include "zipcrc32_p.h"
 #include "zipentry_p.h"
+#include "zippipeline_p.h"
+#include "zipscanner_p.h"
+#include "ziptrace_p.h"
+#include "zipwritebuffer_p.h"
 
 // we only use this to seed the random number generator
+#include <cstring>
 #include <ctime>
 
+#include <QtCore/QBuffer>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
@@ -39,18 +48,24 @@
 #include <QtCore/QMap>
 #include <QtCore/QString>
 #include <QtCore/QStringList>
+#include <QtCore/QTemporaryFile>
 
-// You can remove this #include if you replace the qDebug() statements.
-#include <QtCore/QtDebug>
+
+#if defined(ZIP_ZERO_COPY) && defined(Q_OS_LINUX)
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define ZIP_KERNEL_COPY
+#endif
 
 
 /*! #define OSDAB_ZIP_NO_PNG_RLE to disable the use of Z_RLE compression strategy with
     PNG files (achieves slightly better compression levels according to the authors).
+    Only used when no deflate parameters have been set for the entry.
 */
 // #define OSDAB_ZIP_NO_PNG_RLE
 
-#define OSDAB_ZIP_NO_DEBUG
-
 //! Local header size (including signature, excluding variable length fields)
 #define ZIP_LOCAL_HEADER_SIZE 30
 //! Encryption header size
@@ -213,6 +228,9 @@
 	\value Zip::ReadFailed Reading of a file failed.
 	\value Zip::WriteFailed Writing of a file failed.
 	\value Zip::SeekFailed Seek failed.
+	\value Zip::UnsupportedMethod The compression method has not been compiled in.
+	\value Zip::Canceled The operation has been canceled (see cancel() and ZipProgressObserver).
+	\value Zip::RandomFailed No cryptographic random generator is available for the AES salt.
 */
 
 /*! \enum Zip::CompressionLevel Returns the result of a decompression operation.
@@ -227,10 +245,29 @@
 	\value Zip::Deflate1 Deflate compression level 8.
 	\value Zip::Deflate1 Deflate compression level 9 (maximum compression).
 	\value Zip::AutoCPU Adapt compression level to CPU speed (faster CPU => better compression).
+	Uses Deflate5 unless a throughput target is set (see setTargetThroughput()).
 	\value Zip::AutoMIME Adapt compression level to MIME type of the file being compressed.
 	\value Zip::AutoFull Use both CPU and MIME type detection.
 */
 
+/*! \enum Zip::CompressionMethod The method used for compressed (non stored) entries.
+	\value Zip::Deflated Deflate (PKZip 2.0 compatible, default).
+	\value Zip::Lzma LZMA, requires OSDAB_ZIP_LZMA.
+	\value Zip::Zstd Zstandard, requires OSDAB_ZIP_ZSTD.
+*/
+
+/*! \enum Zip::ReferenceCheck How files are compared with the entries of a reference archive.
+	\value Zip::CompareSizeAndTime Same name, size and modification time (default).
+	\value Zip::CompareContent Same name, size, modification time and CRC.
+	Slower, as unchanged files are read once to compute the CRC.
+*/
+
+/*! \enum Zip::EncryptionMethod The method used to encrypt entries when a password is set.
+	\value Zip::PkzipEncryption Traditional PKWARE encryption (weak, but supported by every tool, default).
+	\value Zip::Aes256Encryption WinZip AES-256 encryption (AE-2). Needs a tool supporting
+	the WinZip AES format (WinZip 9+, 7-Zip, Info-ZIP UnZip 6.1+ and others).
+*/
+
 namespace {
 
 struct ZippedDir {
@@ -261,6 +298,77 @@ void checkRootPath(QString& path)
     }
 }
 
+#ifdef ZIP_KERNEL_COPY
+/*!
+    Copies \p size bytes at offset \p inStart of \p inFd to the current position
+    of \p archive with copy_file_range() (which can share extents on btrfs and XFS)
+    or sendfile(). Returns false if the kernel can't copy between the two files
+    and nothing has been written; \p ec is set otherwise.
+*/
+bool kernelCopy(int inFd, qint64 inStart, QFile& archive, qint64 size,
+    qint64& written, Zip::ErrorCode& ec)
+{
+    if (!archive.flush()) {
+        ec = Zip::WriteFailed;
+        return true;
+    }
+
+    const int outFd = archive.handle();
+    const qint64 outStart = archive.pos();
+
+    qint64 inOff = inStart;
+    qint64 outOff = outStart;
+    off_t sendOff = (off_t) inStart;
+    written = 0;
+
+#ifdef __NR_copy_file_range
+    bool useSendfile = false;
+#else
+    bool useSendfile = true;
+    if (lseek(outFd, outStart, SEEK_SET) < 0)
+        return false;
+#endif
+
+    while (written < size) {
+        const size_t chunk = (size_t) qMin<qint64>(size - written, ZIP_MAP_CHUNK);
+        ssize_t n = -1;
+
+        if (!useSendfile) {
+#ifdef __NR_copy_file_range
+            n = syscall(__NR_copy_file_range, inFd, &inOff, outFd, &outOff, chunk, 0u);
+            if (n < 0 && written == 0 && (errno == ENOSYS || errno == EXDEV
+                || errno == EINVAL || errno == EOPNOTSUPP)) {
+                // Old kernel or different file systems: sendfile() writes at the current offset
+                if (lseek(outFd, outStart, SEEK_SET) < 0)
+                    return false;
+                useSendfile = true;
+                continue;
+            }
+#endif
+        } else {
+            n = sendfile(outFd, inFd, &sendOff, chunk);
+            if (n < 0 && written == 0 && (errno == ENOSYS || errno == EINVAL))
+                return false;
+        }
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            ec = n == 0 ? Zip::ReadFailed : Zip::WriteFailed;
+            break;
+        }
+
+        written += n;
+    }
+
+    // Keep the QFile position in sync with the file descriptor
+    if (!archive.seek(outStart + written) && ec == Zip::Ok)
+        ec = Zip::SeekFailed;
+
+    return true;
+}
+#endif // ZIP_KERNEL_COPY
+
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -277,19 +385,365 @@ ZipPrivate::ZipPrivate() :
     device(0),
     file(0),
     uBuffer(0),
-    crcTable(0),
     comment(),
-    password()
+    password(),
+    method(Zip::Deflated),
+    encryption(Zip::PkzipEncryption),
+    pipelined(false),
+    concurrent(false),
+    owner(0),
+    compressor(0),
+    compressorCodec(0),
+    compressorLevel(0),
+    reference(0),
+    referenceCheck(Zip::CompareSizeAndTime),
+    targetThroughput(0),
+    adaptiveLevel(ZIP_ADAPTIVE_START_LEVEL),
+    adaptiveBytes(0),
+    adaptiveNsecs(0),
+    activeWorkers(0),
+    observer(0),
+    canceled(0)
 {
 	// keep an unsigned pointer so we avoid to over bloat the code with casts
 	uBuffer = (unsigned char*) buffer1;
-    crcTable = get_crc_table();
+
+    for (int i = 0; i <= Zip::Deflate9; ++i) {
+        levelThroughput[i] = -1;
+        levelAge[i] = 0;
+    }
 }
 
 //! \internal
 ZipPrivate::~ZipPrivate()
 {
 	closeArchive();
+	clearReference();
+    clearWorkers();
+    delete compressor;
+}
+
+#ifdef ZIP_ADAPTIVE
+/*! \internal Throughput controller used by AutoCPU and AutoFull.
+    Accounts \p bytes compressed in \p nsecs of codec time at \p level and, once
+    enough data has been compressed at the current level, moves it one step down
+    if the measured throughput is below the target or one step up if the next
+    level is not known to be too slow. Store is the lowest level; stored entries
+    are accounted with 0 nsecs. The throughput of the other levels is forgotten
+    after ZIP_ADAPTIVE_MAX_AGE windows, so a level found too slow on some data
+    is tried again later.
+*/
+void ZipPrivate::updateAdaptiveLevel(Zip::CompressionLevel level, qint64 bytes, qint64 nsecs)
+{
+    // AutoFull may have used a lower level because of the MIME type
+    if (level != adaptiveLevel)
+        return;
+
+    adaptiveBytes += bytes;
+    adaptiveNsecs += nsecs;
+    if (adaptiveBytes < ZIP_ADAPTIVE_WINDOW)
+        return;
+
+    // Store doesn't run the compressor, so it never is too slow
+    const double mbps = adaptiveNsecs > 0
+        ? (adaptiveBytes / 1048576.0) / (adaptiveNsecs / 1e9)
+        : targetThroughput;
+    adaptiveBytes = 0;
+    adaptiveNsecs = 0;
+
+    // Smooth the measures: the same level is slower on some data than on other
+    double& known = levelThroughput[adaptiveLevel];
+    known = known < 0 ? mbps : (known + mbps) / 2;
+
+    // Old measures may not hold for the data being compressed now
+    for (int i = 0; i <= Zip::Deflate9; ++i) {
+        if (i == adaptiveLevel)
+            levelAge[i] = 0;
+        else if (levelThroughput[i] >= 0 && ++levelAge[i] >= ZIP_ADAPTIVE_MAX_AGE)
+            levelThroughput[i] = -1;
+    }
+
+    if (known < targetThroughput) {
+        if (adaptiveLevel > Zip::Store)
+            --adaptiveLevel;
+    } else if (adaptiveLevel < Zip::Deflate9) {
+        const double next = levelThroughput[adaptiveLevel + 1];
+        if (next < 0 || next >= targetThroughput)
+            ++adaptiveLevel;
+    }
+
+    ZIP_TRACE(zipLog) << "adaptive mbps=" << mbps << " target=" << targetThroughput
+        << " level=" << adaptiveLevel;
+}
+#endif
+
+//! \internal True if the archive operations have been canceled.
+bool ZipPrivate::isCanceled()
+{
+    // Concurrent entries are canceled with their archive
+    ZipPrivate* archive = owner ? owner : this;
+    return archive->canceled.fetchAndAddRelaxed(0) != 0;
+}
+
+/*! \internal Accounts \p in bytes read and \p out bytes written for the
+    current entry and reports them to the observer.
+    Returns false if the operation has been canceled.
+*/
+bool ZipPrivate::progress(qint64 in, qint64 out)
+{
+    stats.entryBytesIn += in;
+    stats.entryBytesOut += out;
+    stats.bytesIn += in;
+    stats.bytesOut += out;
+
+    if (isCanceled())
+        return false;
+    if (!observer || observer->progress(stats))
+        return true;
+
+    // The following entries must not be added either
+    canceled.fetchAndStoreRelaxed(1);
+    return false;
+}
+
+//! \internal Completes the statistics of the current entry and notifies the observer.
+void ZipPrivate::finishEntry()
+{
+    // Entries copied from the reference archive or the cache are not read
+    if (stats.entryBytesIn < stats.entrySize) {
+        stats.bytesIn += stats.entrySize - stats.entryBytesIn;
+        stats.entryBytesIn = stats.entrySize;
+    }
+
+    ++stats.entries;
+    if (observer)
+        observer->entryFinished(stats);
+}
+
+//! \internal Closes the reference archive, if any.
+void ZipPrivate::clearReference()
+{
+    if (reference) {
+        reference->closeArchive();
+        delete reference;
+        reference = 0;
+    }
+}
+
+/*! \internal Returns the entry of the reference archive that can be copied
+    instead of compressing the file at \p path again, or 0 if there is none.
+    \p h must already contain the size and modification time of the file.
+*/
+const ZipEntryP* ZipPrivate::findReferenceEntry(const QString& entryName,
+    const QString& path, const ZipEntryP* h)
+{
+    if (!reference || !reference->headers)
+        return 0;
+
+    const ZipEntryP* ref = reference->headers->value(entryName);
+    if (!ref || ref->isEncrypted() || ref->szUncomp != h->szUncomp
+        || ref->modTime[0] != h->modTime[0] || ref->modTime[1] != h->modTime[1]
+        || ref->modDate[0] != h->modDate[0] || ref->modDate[1] != h->modDate[1])
+        return 0;
+
+    // Locate the data (and make sure the local header is still there)
+    if (!ref->lhEntryChecked) {
+        if (reference->parseLocalHeaderRecord(entryName, *ref) != UnZip::Ok)
+            return 0;
+        ref->lhEntryChecked = true;
+    }
+
+    if (referenceCheck == Zip::CompareContent) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return 0;
+        quint32 crc = 0;
+        qint64 read;
+        while ((read = file.read(buffer2, ZIP_READ_BUFFER)) > 0)
+            crc = ZipCrc32::update(crc, buffer2, read);
+        if (read < 0 || crc != ref->crc)
+            return 0;
+    }
+
+    return ref;
+}
+
+//! \internal Copies the compressed data of \p ref from the reference archive.
+Zip::ErrorCode ZipPrivate::copyReferenceEntry(const ZipEntryP& ref, qint64& written)
+{
+    return copyData(*reference->file, ref.dataOffset, ref.szComp, written);
+}
+
+/*! \internal Copies \p size bytes at \p offset of \p src to the archive.
+    The kernel copies the data if both \p src and the archive are files.
+*/
+Zip::ErrorCode ZipPrivate::copyData(QIODevice& src, qint64 offset, qint64 size, qint64& written)
+{
+    written = 0;
+
+#ifdef ZIP_KERNEL_COPY
+    QFile* archive = qobject_cast<QFile*>(device);
+    QFile* srcFile = qobject_cast<QFile*>(&src);
+    if (archive && srcFile) {
+        ZipStopwatch watch;
+        Zip::ErrorCode ec = Zip::Ok;
+        if (kernelCopy(srcFile->handle(), offset, *archive, size, written, ec)) {
+            watch.lap(stats.writeTime);
+            if (ec == Zip::Ok && !concurrent && !progress(0, written))
+                ec = Zip::Canceled;
+            return ec;
+        }
+    }
+#endif
+
+    if (!src.seek(offset))
+        return Zip::SeekFailed;
+
+    ZipStopwatch watch;
+    while (written < size) {
+        const qint64 chunk = qMin<qint64>(size - written, ZIP_READ_BUFFER);
+        if (src.read(buffer2, chunk) != chunk)
+            return Zip::ReadFailed;
+        watch.lap(stats.readTime);
+        if (device->write(buffer2, chunk) != chunk)
+            return Zip::WriteFailed;
+        watch.lap(stats.writeTime);
+        written += chunk;
+
+        // In concurrent mode this appends entries accounted by the workers
+        if (!concurrent && !progress(0, chunk))
+            return Zip::Canceled;
+        watch.restart();
+    }
+
+    return Zip::Ok;
+}
+
+/*! \internal Returns the path of the blob cache file for content with SHA-1
+    \p digest compressed with \p codec, \p level and \p params.
+*/
+static QString cacheBlobPath(const QString& cacheDirectory, const uchar* digest,
+    const ZipCodec* codec, const Zip::CompressionLevel& level, const ZipCodecParameters& params)
+{
+    const QString hex = QString::fromLatin1(QByteArray((const char*) digest, 20).toHex());
+    return QString::fromLatin1("%1/%2/%3-%4-%5-%6-%7-%8").arg(cacheDirectory, hex.left(2), hex.mid(2))
+        .arg(codec->method()).arg((int) level)
+        .arg(params.strategy).arg(params.memLevel).arg(params.windowBits);
+}
+
+/*! \internal Compresses \p file through the blob cache: the compressed data is
+    copied from the cache if the same content has already been compressed with
+    the same method and level. Otherwise the file is compressed into the archive
+    and the cache at once, and the blob is published under the hash of the data
+    actually compressed.
+    Returns false if the cache can't be used and nothing has been written
+    to the archive (\p file might have been read); \p ec is set otherwise.
+*/
+bool ZipPrivate::compressCached(const QString& path, QFile& file, quint32& crc,
+    qint64& written, const Zip::CompressionLevel& level, const ZipCodec* codec,
+    const ZipCodecParameters& params, Zip::ErrorCode& ec)
+{
+    written = 0;
+    crc = 0;
+    ec = Zip::Ok;
+
+    // Content hash
+    ZipSha1 sha;
+    qint64 read;
+    while ((read = file.read(buffer1, ZIP_READ_BUFFER)) > 0)
+        sha.update((const uchar*) buffer1, read);
+    if (read < 0 || !file.seek(0))
+        return false;
+
+    uchar digest[20];
+    sha.final(digest);
+
+    const QString blobPath = cacheBlobPath(cacheDirectory, digest, codec, level, params);
+    const qint64 size = file.size();
+    QFile blob(blobPath);
+
+    if (!blob.exists()) {
+        // Compress into the archive and a temporary file, then publish it atomically
+        if (!QDir().mkpath(QFileInfo(blobPath).path()))
+            return false;
+
+        QTemporaryFile tmp(blobPath + QLatin1String(".XXXXXX"));
+        tmp.setAutoRemove(false);
+        if (!tmp.open())
+            return false;
+
+        memset(buffer2, 0, ZIP_CACHE_HEADER_SIZE);
+        if (tmp.write(buffer2, ZIP_CACHE_HEADER_SIZE) != ZIP_CACHE_HEADER_SIZE) {
+            tmp.close();
+            tmp.remove();
+            return false;
+        }
+
+        // From now on the entry is in the archive whatever happens to the blob
+        ZipCacheBlob cacheBlob(&tmp);
+        ec = compressFile(path, file, crc, written, level, codec, params, 0, 0, &cacheBlob);
+
+        bool ok = ec == Zip::Ok && cacheBlob.device;
+        if (ok) {
+            // The file might have changed since it has been hashed
+            cacheBlob.sha.final(digest);
+            writeCacheHeader(buffer2, crc, size, written);
+            ok = tmp.seek(0) && tmp.write(buffer2, ZIP_CACHE_HEADER_SIZE) == ZIP_CACHE_HEADER_SIZE;
+        }
+
+        tmp.close();
+        // Another process might have published the same blob in the meantime
+        if (!ok || !tmp.rename(cacheBlobPath(cacheDirectory, digest, codec, level, params)))
+            tmp.remove();
+        return true;
+    }
+
+    if (!blob.open(QIODevice::ReadOnly))
+        return false;
+
+    quint32 blobCrc;
+    qint64 blobSize;
+    qint64 blobCompressed;
+    if (blob.read(buffer2, ZIP_CACHE_HEADER_SIZE) != ZIP_CACHE_HEADER_SIZE
+        || !readCacheHeader(buffer2, blobCrc, blobSize, blobCompressed)
+        || blobSize != size || blobCompressed != blob.size() - ZIP_CACHE_HEADER_SIZE) {
+        ZIP_WARNING(zipLog) << "Invalid cache entry" << blobPath;
+        return false;
+    }
+
+    crc = blobCrc;
+    ec = copyData(blob, ZIP_CACHE_HEADER_SIZE, blobCompressed, written);
+    return true;
+}
+
+//! \internal Fills a blob cache file header.
+void ZipPrivate::writeCacheHeader(char* buffer, quint32 crc, qint64 size, qint64 compressed)
+{
+    memcpy(buffer, ZIP_CACHE_MAGIC, 4);
+    setULong(crc, buffer, 4);
+    setULong((quint32) (size & 0xFFFFFFFF), buffer, 8);
+    setULong((quint32) (size >> 32), buffer, 12);
+    setULong((quint32) (compressed & 0xFFFFFFFF), buffer, 16);
+    setULong((quint32) (compressed >> 32), buffer, 20);
+}
+
+//! \internal Parses a blob cache file header. Returns false if it is not valid.
+bool ZipPrivate::readCacheHeader(const char* buffer, quint32& crc, qint64& size, qint64& compressed)
+{
+    if (memcmp(buffer, ZIP_CACHE_MAGIC, 4) != 0)
+        return false;
+
+    const uchar* b = (const uchar*) buffer;
+    quint32 v[5];
+    for (int i = 0; i < 5; ++i) {
+        const uchar* p = b + 4 + i * 4;
+        v[i] = p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32) p[3] << 24);
+    }
+
+    crc = v[0];
+    size = (qint64) v[1] | ((qint64) v[2] << 32);
+    compressed = (qint64) v[3] | ((qint64) v[4] << 32);
+    return true;
 }
 
 //! \internal
@@ -301,6 +755,7 @@ Zip::ErrorCode ZipPrivate::createArchive(QIODevice* dev)
 		closeArchive();
 
 	device = dev;
+    output.setDevice(device);
     if (device != file)
         connect(device, SIGNAL(destroyed(QObject*)), this, SLOT(deviceDestroyed(QObject*)));
 
@@ -308,19 +763,21 @@ Zip::ErrorCode ZipPrivate::createArchive(QIODevice* dev)
 		if (!device->open(QIODevice::ReadOnly)) {
 			delete device;
 			device = 0;
-			qDebug() << "Unable to open device for writing.";
+			ZIP_WARNING(zipLog) << "Unable to open device for writing.";
 			return Zip::OpenFailed;
 		}
 	}
 
 	headers = new QMap<QString,ZipEntryP*>;
+    stats.reset();
+    canceled.fetchAndStoreRelaxed(0);
 	return Zip::Ok;
 }
 
 //! \internal
 void ZipPrivate::deviceDestroyed(QObject*)
 {
-    qDebug("Unexpected device destruction detected.");
+    ZIP_WARNING(zipLog) << "Unexpected device destruction detected.";
     do_closeArchive();
 }
 
@@ -329,11 +786,18 @@ void ZipPrivate::deviceDestroyed(QObject*)
 */
 bool ZipPrivate::containsEntry(const QFileInfo& info) const
 {
+    return containsEntry(info.absoluteFilePath(), info.size());
+}
+
+//! \internal Same as containsEntry(const QFileInfo&) but without querying the file system.
+bool ZipPrivate::containsEntry(const QString& absPath, qint64 sz) const
+{
+    QMutexLocker locker(concurrent ? &archiveMutex : 0);
+
     if (!headers || headers->isEmpty())
         return false;
 
-    const qint64 sz = info.size();
-    const QString path = info.absoluteFilePath().toLower();
+    const QString path = absPath.toLower();
 
     QMap<QString,ZipEntryP*>::ConstIterator b = headers->constBegin();
     const QMap<QString,ZipEntryP*>::ConstIterator e = headers->constEnd();
@@ -347,7 +811,9 @@ bool ZipPrivate::containsEntry(const QFileInfo& info) const
     return false;
 }
 
-//! \internal Actual implementation of the addDirectory* methods.
+/*! \internal Actual implementation of the addDirectory* methods.
+    The whole tree is scanned first (see ZipDirScanner), then the entries are written.
+*/
 Zip::ErrorCode ZipPrivate::addDirectory(const QString& path, const QString& root,
     Zip::CompressionOptions options, Zip::CompressionLevel level, int hierarchyLevel,
     int* addedFiles)
@@ -359,10 +825,19 @@ Zip::ErrorCode ZipPrivate::addDirectory(const QString& path, const QString& root
     if (!device)
         return Zip::NoOpenArchive;
 
-    QDir dir(path);
-    if (!dir.exists())
+    ZipDirScanner scanner(includePatterns, excludePatterns);
+    QScopedPointer<ZipScanDir> dir(scanner.scan(path));
+    if (dir.isNull())
         return Zip::FileNotFound;
 
+    return addScannedDirectory(*dir, root, options, level, hierarchyLevel, addedFiles);
+}
+
+//! \internal Adds a directory found by ZipDirScanner and, recursively, its contents.
+Zip::ErrorCode ZipPrivate::addScannedDirectory(const ZipScanDir& dir, const QString& root,
+    Zip::CompressionOptions options, Zip::CompressionLevel level, int hierarchyLevel,
+    int* addedFiles)
+{
     // Remove any trailing separator
     QString actualRoot = root.trimmed();
 
@@ -370,15 +845,12 @@ Zip::ErrorCode ZipPrivate::addDirectory(const QString& path, const QString& root
     // unix like separator
     ::checkRootPath(actualRoot);
 
-    // QDir::cleanPath() fixes some issues with QDir::dirName()
-    QFileInfo current(QDir::cleanPath(path));
-
     const bool path_absolute = options.testFlag(Zip::AbsolutePaths);
     const bool path_ignore = options.testFlag(Zip::IgnorePaths);
     const bool path_noroot = options.testFlag(Zip::IgnoreRoot);
 
     if (path_absolute && !path_ignore && !path_noroot) {
-        QString absolutePath = extractRoot(path, options);
+        QString absolutePath = extractRoot(dir.path, options);
         if (!absolutePath.isEmpty() && absolutePath != QLatin1String("/"))
             absolutePath.append(QLatin1String("/"));
         actualRoot.append(absolutePath);
@@ -386,7 +858,7 @@ Zip::ErrorCode ZipPrivate::addDirectory(const QString& path, const QString& root
 
     const bool skipDirName = !hierarchyLevel && path_noroot;
     if (!path_ignore && !skipDirName) {
-        actualRoot.append(QDir(current.absoluteFilePath()).dirName());
+        actualRoot.append(QDir(dir.path).dirName());
         actualRoot.append(QLatin1String("/"));
     }
 
@@ -396,50 +868,54 @@ Zip::ErrorCode ZipPrivate::addDirectory(const QString& path, const QString& root
     const bool skipBad = options & Zip::SkipBadFiles;
     const bool noDups = options & Zip::CheckForDuplicates;
 
-    const QDir::Filters dir_filter =
-            QDir::Files |
-            QDir::Dirs |
-            QDir::NoDotAndDotDot |
-            QDir::NoSymLinks;
-    const QDir::SortFlags dir_sort =
-            QDir::DirsFirst;
-    QFileInfoList list = dir.entryInfoList(dir_filter, dir_sort);
-
     Zip::ErrorCode ec = Zip::Ok;
     bool filesAdded = false;
+    bool stop = false;
 
     Zip::CompressionOptions recursionOptions;
     if (path_ignore)
         recursionOptions |= Zip::IgnorePaths;
     else recursionOptions |= Zip::RelativePaths;
 
-    for (int i = 0; i < list.size(); ++i) {
-        QFileInfo info = list.at(i);
-        const QString absPath = info.absoluteFilePath();
-        if (noDups && containsEntry(info))
+    // Directories first, as QDir::DirsFirst used to do
+    for (int i = 0; i < dir.dirs.size() && !stop; ++i) {
+        const ZipScanDir* sub = dir.dirs.at(i);
+        if (noDups && containsEntry(sub->path, sub->entry.size))
             continue;
-        if (info.isDir()) {
-            // Recursion
-            ec = addDirectory(absPath, actualRoot, recursionOptions,
-                level, hierarchyLevel + 1, addedFiles);
-        } else {
-            ec = createEntry(info, actualRoot, level);
-            if (ec == Zip::Ok) {
-                filesAdded = true;
-                if (addedFiles)
-                    ++(*addedFiles);
-            }
-        }
 
-        if (ec != Zip::Ok && !skipBad) {
-           break;
+        // Recursion
+        if (addedFiles)
+            ++(*addedFiles);
+        ec = addScannedDirectory(*sub, actualRoot, recursionOptions,
+            level, hierarchyLevel + 1, addedFiles);
+        stop = ec == Zip::Canceled || (ec != Zip::Ok && !skipBad);
+    }
+
+    QString filePath = dir.path;
+    if (!filePath.endsWith(QLatin1Char('/')))
+        filePath.append(QLatin1Char('/'));
+    const int dirPathLength = filePath.length();
+
+    for (int i = 0; i < dir.files.size() && !stop; ++i) {
+        const ZipScanEntry& file = dir.files.at(i);
+        filePath.truncate(dirPathLength);
+        filePath.append(file.name);
+        if (noDups && containsEntry(filePath, file.size))
+            continue;
+
+        ec = createEntry(filePath, file, false, actualRoot, level);
+        if (ec == Zip::Ok) {
+            filesAdded = true;
+            if (addedFiles)
+                ++(*addedFiles);
         }
+        stop = ec == Zip::Canceled || (ec != Zip::Ok && !skipBad);
     }
 
     // We need an explicit record for this dir
     // Non-empty directories don't need it because they have a path component in the filename
     if (!filesAdded && !path_ignore)
-        ec = createEntry(current, actualRoot, level);
+        ec = createEntry(dir.path, dir.entry, true, actualRoot, level);
 
     return ec;
 }
@@ -529,7 +1005,7 @@ Zip::ErrorCode ZipPrivate::addFiles(const QStringList& files, const QString& roo
             }
         }
 
-        if (ec != Zip::Ok && !skipBad) {
+        if (ec == Zip::Canceled || (ec != Zip::Ok && !skipBad)) {
            break;
         }
     }
@@ -550,20 +1026,45 @@ Zip::ErrorCode ZipPrivate::addFiles(const QStringList& files, const QString& roo
     return ec;
 }
 
-//! \internal \p file must be a file and not a directory.
-Zip::ErrorCode ZipPrivate::deflateFile(const QFileInfo& fileInfo,
-    quint32& crc, qint64& written, const Zip::CompressionLevel& level, quint32** keys)
+//! \internal \p path must be the absolute path of a file and not a directory.
+Zip::ErrorCode ZipPrivate::deflateFile(const QString& path,
+    quint32& crc, qint64& written, const Zip::CompressionLevel& level,
+    const ZipCodec* codec, const ZipCodecParameters& params,
+    quint32** keys, ZipAesCipher* aes)
 {
-    const QString path = fileInfo.absoluteFilePath();
     QFile file(path);
     if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << QString("An error occurred while opening %1").arg(path);
+        ZIP_WARNING(zipLog) << "An error occurred while opening" << path;
         return Zip::OpenFailed;
     }
 
+    // Unencrypted compressed entries may already be in the blob cache
+    if (level != Zip::Store && !keys && !aes && !cacheDirectory.isEmpty()) {
+        Zip::ErrorCode ec = Zip::Ok;
+        if (compressCached(path, file, crc, written, level, codec, params, ec)) {
+            file.close();
+            return ec;
+        }
+        if (!file.seek(0)) {
+            file.close();
+            return Zip::SeekFailed;
+        }
+    }
+
+#ifdef ZIP_ZERO_COPY
+    // Unencrypted stored entries don't need to go through buffer1
+    if (level == Zip::Store && !keys && !aes) {
+        Zip::ErrorCode ec = Zip::Ok;
+        if (storeFileZeroCopy(file, crc, written, ec)) {
+            file.close();
+            return ec;
+        }
+    }
+#endif
+
     const Zip::ErrorCode ec = (level == Zip::Store)
-        ? storeFile(path, file, crc, written, keys)
-        : compressFile(path, file, crc, written, level, keys);
+        ? storeFile(path, file, crc, written, keys, aes)
+        : compressFile(path, file, crc, written, level, codec, params, keys, aes);
 
     file.close();
     return ec;
@@ -571,7 +1072,7 @@ Zip::ErrorCode ZipPrivate::deflateFile(const QFileInfo& fileInfo,
 
 //! \internal
 Zip::ErrorCode ZipPrivate::storeFile(const QString& path, QIODevice& file,
-    quint32& crc, qint64& totalWritten, quint32** keys)
+    quint32& crc, qint64& totalWritten, quint32** keys, ZipAesCipher* aes)
 {
     Q_UNUSED(path);
 
@@ -581,38 +1082,172 @@ Zip::ErrorCode ZipPrivate::storeFile(const QString& path, QIODevice& file,
     const bool encrypt = keys != 0;
 
     totalWritten = 0;
-    crc = crc32(0L, Z_NULL, 0);
+    crc = 0;
 
+    ZipStopwatch watch;
     while ( (read = file.read(buffer1, ZIP_READ_BUFFER)) > 0 ) {
-        crc = crc32(crc, uBuffer, read);
+        watch.lap(stats.readTime);
+        crc = ZipCrc32::update(crc, buffer1, read);
+        watch.lap(stats.crcTime);
         if (encrypt)
             encryptBytes(*keys, buffer1, read);
+        else if (aes)
+            aes->encrypt(buffer1, read);
+        watch.lap(stats.compressTime);
         written = device->write(buffer1, read);
+        watch.lap(stats.writeTime);
         totalWritten += written;
         if (written != read) {
             return Zip::WriteFailed;
         }
+        if (!progress(read, written))
+            return Zip::Canceled;
+        watch.restart();
     }
 
     return Zip::Ok;
 }
 
-//! \internal
-int ZipPrivate::compressionStrategy(const QString& path, QIODevice& file) const
+#ifdef ZIP_ZERO_COPY
+/*!
+    \internal Stores \p file computing the CRC over a memory mapping of the
+    file. The data is then copied by the kernel if the archive is a local file
+    (Linux only) or written straight from the mapping.
+    Returns false if nothing has been written and storeFile() must be used.
+*/
+bool ZipPrivate::storeFileZeroCopy(QFile& file, quint32& crc, qint64& totalWritten, Zip::ErrorCode& ec)
 {
-    Q_UNUSED(file);
+    const qint64 size = file.size();
+    if (size < ZIP_ZERO_COPY_THRESHOLD)
+        return false;
+
+    totalWritten = 0;
+    crc = 0;
+    ec = Zip::Ok;
+
+#ifdef ZIP_KERNEL_COPY
+    // The mapping is only read by the CRC, the data is copied by the kernel
+    QFile* archive = qobject_cast<QFile*>(device);
+    if (archive) {
+        ZipStopwatch watch;
+        bool mapped = true;
+        for (qint64 off = 0; mapped && off < size; off += ZIP_MAP_CHUNK) {
+            const qint64 len = qMin<qint64>(ZIP_MAP_CHUNK, size - off);
+            uchar* m = file.map(off, len);
+            mapped = m != 0;
+            if (mapped) {
+                crc = ZipCrc32::update(crc, (const char*) m, len);
+                file.unmap(m);
+            }
+        }
+        watch.lap(stats.crcTime);
+        if (!mapped)
+            return false;
+        if (kernelCopy(file.handle(), 0, *archive, size, totalWritten, ec)) {
+            watch.lap(stats.writeTime);
+            if (ec == Zip::Ok && !progress(size, totalWritten))
+                ec = Zip::Canceled;
+            return true;
+        }
+        crc = 0;
+    }
+#endif
+
+    // Write straight from the mapping
+    ZipStopwatch watch;
+    for (qint64 off = 0; off < size; off += ZIP_MAP_CHUNK) {
+        const qint64 len = qMin<qint64>(ZIP_MAP_CHUNK, size - off);
+        uchar* m = file.map(off, len);
+        if (!m) {
+            if (off == 0)
+                return false;
+            ec = Zip::ReadFailed;
+            return true;
+        }
+        watch.lap(stats.readTime);
+
+        crc = ZipCrc32::update(crc, (const char*) m, len);
+        watch.lap(stats.crcTime);
+        const qint64 written = device->write((const char*) m, len);
+        file.unmap(m);
+        watch.lap(stats.writeTime);
+
+        totalWritten += written;
+        if (written != len) {
+            ec = Zip::WriteFailed;
+            return true;
+        }
+        if (!progress(len, written)) {
+            ec = Zip::Canceled;
+            return true;
+        }
+        watch.restart();
+    }
+
+    return true;
+}
+#endif // ZIP_ZERO_COPY
+
+/*! \internal Returns the parameters of the first deflate rule matching
+    \p entryName or the default parameters.
+*/
+Zip::DeflateParameters ZipPrivate::deflateParametersFor(const QString& entryName) const
+{
+    if (deflateRules.isEmpty())
+        return deflateParameters;
+
+    const int slash = entryName.lastIndexOf(QLatin1Char('/'));
+    const QString fileName = slash < 0 ? entryName : entryName.mid(slash + 1);
+
+    for (int i = 0; i < deflateRules.size(); ++i) {
+        const QString& pattern = deflateRules.at(i).first;
+        const bool matchPath = pattern.contains(QLatin1Char('/'));
+        if (ZipDirScanner::wildcardMatch(pattern, matchPath ? entryName : fileName))
+            return deflateRules.at(i).second;
+    }
+    return deflateParameters;
+}
+
+//! \internal Translates the deflate parameters of \p entryName for the codecs.
+ZipCodecParameters ZipPrivate::codecParameters(const QString& entryName) const
+{
+    const Zip::DeflateParameters p = deflateParametersFor(entryName);
+
+    ZipCodecParameters params;
+    switch (p.strategy) {
+    case Zip::FilteredStrategy: params.strategy = Z_FILTERED; break;
+    case Zip::HuffmanOnlyStrategy: params.strategy = Z_HUFFMAN_ONLY; break;
+    case Zip::RleStrategy: params.strategy = Z_RLE; break;
+    default: params.strategy = Z_DEFAULT_STRATEGY;
+    }
+    params.memLevel = qBound(1, p.memLevel, 9);
+    params.windowBits = qBound(9, p.windowBits, 15);
 
 #ifndef OSDAB_ZIP_NO_PNG_RLE
-    return Z_DEFAULT_STRATEGY;
+    if (p.strategy == Zip::DefaultStrategy
+        && entryName.endsWith(QLatin1String(".png"), Qt::CaseInsensitive))
+        params.strategy = Z_RLE;
 #endif
-    const bool isPng = path.endsWith(QLatin1String("png"), Qt::CaseInsensitive);
-    return isPng ? Z_RLE : Z_DEFAULT_STRATEGY;
+
+    return params;
 }
 
 //! \internal
 Zip::ErrorCode ZipPrivate::compressFile(const QString& path, QIODevice& file,
-    quint32& crc, qint64& totalWritten, const Zip::CompressionLevel& level, quint32** keys)
+    quint32& crc, qint64& totalWritten, const Zip::CompressionLevel& level,
+    const ZipCodec* codec, const ZipCodecParameters& params,
+    quint32** keys, ZipAesCipher* aes, ZipCacheBlob* blob)
 {
+    Q_ASSERT(codec);
+
+#ifdef ZIP_PIPELINE
+    // Devices are only used by one thread at a time, but sockets and
+    // other sequential devices don't like it: only files are pipelined.
+    if (pipelined && !blob && file.size() >= ZIP_PIPELINE_THRESHOLD
+        && qobject_cast<QFile*>(&file) && qobject_cast<QFile*>(device))
+        return compressFilePipelined(path, file, crc, totalWritten, level, codec, params, keys, aes);
+#endif
+
     qint64 read = 0;
     qint64 written = 0;
 
@@ -620,130 +1255,443 @@ Zip::ErrorCode ZipPrivate::compressFile(const QString& path, QIODevice& file,
     qint64 toRead = file.size();
 
     const bool encrypt = keys != 0;
-    const int strategy = compressionStrategy(path, file);
 
     totalWritten = 0;
-    crc = crc32(0L, Z_NULL, 0);
-
-    z_stream zstr;
-
-    // Initialize zalloc, zfree and opaque before calling the init function
-    zstr.zalloc = Z_NULL;
-    zstr.zfree = Z_NULL;
-    zstr.opaque = Z_NULL;
-
-    int zret;
-
-    // Use deflateInit2 with negative windowBits to get raw compression
-    if ((zret = deflateInit2_(
-            &zstr,
-            (int)level, // compression level
-            Z_DEFLATED, // method
-            -MAX_WBITS, // windowBits
-            8, // memLevel
-            strategy,
-            ZLIB_VERSION,
-            sizeof(z_stream)
-        )) != Z_OK ) {
-        qDebug() << "Could not initialize zlib for compression";
-        return Zip::ZlibError;
+    crc = 0;
+
+    ZipCodecStream* zstr = compressorFor(codec, (int)level, params);
+    if (!zstr) {
+        ZIP_WARNING(zipLog) << "Could not initialize the compressor";
+        return Zip::ZlibInit;
     }
 
+    ZipCodecStream::Result zret = ZipCodecStream::Ok;
+
     qint64 compressed;
-    int flush = Z_NO_FLUSH;
+    bool finish = false;
+    ZipStopwatch watch;
     do {
         read = file.read(buffer1, ZIP_READ_BUFFER);
+        watch.lap(stats.readTime);
         totRead += read;
         if (!read)
             break;
 
         if (read < 0) {
-            deflateEnd(&zstr);
-            qDebug() << QString("Error while reading %1").arg(path);
+            ZIP_WARNING(zipLog) << "Error while reading" << path;
             return Zip::ReadFailed;
         }
 
-        crc = crc32(crc, uBuffer, read);
+        crc = ZipCrc32::update(crc, buffer1, read);
+        if (blob)
+            blob->sha.update((const uchar*) buffer1, read);
+        watch.lap(stats.crcTime);
+        qint64 chunkWritten = 0;
 
-        zstr.next_in = (Bytef*) buffer1;
-        zstr.avail_in = (uInt)read;
+        zstr->nextIn = buffer1;
+        zstr->availIn = (quint32)read;
 
-        // Tell zlib if this is the last chunk we want to encode
-        // by setting the flush parameter to Z_FINISH
-        flush = (totRead == toRead) ? Z_FINISH : Z_NO_FLUSH;
+        // Tell the codec if this is the last chunk we want to encode
+        finish = totRead == toRead;
 
-        // Run deflate() on input until output buffer not full
+        // Run the codec on input until output buffer not full
         // finish compression if all of source has been read in
         do {
-            zstr.next_out = (Bytef*) buffer2;
-            zstr.avail_out = ZIP_READ_BUFFER;
+            zstr->nextOut = buffer2;
+            zstr->availOut = ZIP_READ_BUFFER;
 
-            zret = deflate(&zstr, flush);
-            // State not clobbered
-            Q_ASSERT(zret != Z_STREAM_ERROR);
+            zret = zstr->process(finish);
+            if (zret == ZipCodecStream::DataError || zret == ZipCodecStream::MemoryError) {
+                ZIP_WARNING(zipLog) << "Error while compressing" << path;
+                return Zip::ZlibError;
+            }
 
             // Write compressed data to file and empty buffer
-            compressed = ZIP_READ_BUFFER - zstr.avail_out;
+            compressed = ZIP_READ_BUFFER - zstr->availOut;
 
             if (encrypt)
                 encryptBytes(*keys, buffer2, compressed);
+            else if (aes)
+                aes->encrypt(buffer2, compressed);
+            watch.lap(stats.compressTime);
 
             written = device->write(buffer2, compressed);
+            watch.lap(stats.writeTime);
             totalWritten += written;
+            chunkWritten += written;
 
             if (written != compressed) {
-                deflateEnd(&zstr);
-                qDebug() << QString("Error while writing %1").arg(path);
+                ZIP_WARNING(zipLog) << "Error while writing" << path;
                 return Zip::WriteFailed;
             }
 
-        } while (zstr.avail_out == 0);
+            if (blob && blob->device && blob->device->write(buffer2, compressed) != compressed)
+                blob->device = 0;
+            watch.lap(stats.writeTime);
 
-        // All input will be used
-        Q_ASSERT(zstr.avail_in == 0);
+        } while (zstr->availOut == 0 || zstr->availIn != 0
+            || (finish && zret != ZipCodecStream::StreamEnd));
 
-    } while (flush != Z_FINISH);
+        if (!progress(read, chunkWritten))
+            return Zip::Canceled;
+        watch.restart();
+
+    } while (!finish);
 
     // Stream will be complete
-    Q_ASSERT(zret == Z_STREAM_END);
-    deflateEnd(&zstr);
+    Q_ASSERT(zret == ZipCodecStream::StreamEnd);
 
     return Zip::Ok;
 }
 
+#ifdef ZIP_PIPELINE
+/*! \internal Same as compressFile() but the file is read by a ZipReaderThread
+    and the compressed data is written by a ZipWriterThread, so that disk I/O
+    and compression overlap. CRC, compression and encryption still run in order
+    on the calling thread.
+*/
+Zip::ErrorCode ZipPrivate::compressFilePipelined(const QString& path, QIODevice& file,
+    quint32& crc, qint64& totalWritten, const Zip::CompressionLevel& level,
+    const ZipCodec* codec, const ZipCodecParameters& params,
+    quint32** keys, ZipAesCipher* aes)
+{
+    const qint64 toRead = file.size();
+
+    totalWritten = 0;
+    crc = 0;
+
+    ZipCodecStream* zstr = compressorFor(codec, (int)level, params);
+    if (!zstr) {
+        ZIP_WARNING(zipLog) << "Could not initialize the compressor";
+        return Zip::ZlibInit;
+    }
+
+    ZipRingBuffer input(ZIP_PIPELINE_SLOTS, ZIP_READ_BUFFER);
+    ZipRingBuffer output(ZIP_PIPELINE_SLOTS, ZIP_READ_BUFFER);
+    ZipReaderThread reader(&file, &input);
+    ZipWriterThread writer(device, &output);
+    reader.start();
+    writer.start();
+
+    Zip::ErrorCode ec = Zip::Ok;
+    ZipCodecStream::Result zret = ZipCodecStream::Ok;
+    qint64 totRead = 0;
+    bool finish = false;
+    // Waiting for the reader and the writer counts as reading and writing
+    ZipStopwatch watch;
+
+    while (ec == Zip::Ok && !finish) {
+        qint64 read = 0;
+        char* in = input.acquireRead(read);
+        watch.lap(stats.readTime);
+        if (!in || read < 0) {
+            ZIP_WARNING(zipLog) << "Error while reading" << path;
+            ec = Zip::ReadFailed;
+            break;
+        }
+        if (!read)
+            break;
+
+        totRead += read;
+        crc = ZipCrc32::update(crc, in, read);
+        watch.lap(stats.crcTime);
+
+        zstr->nextIn = in;
+        zstr->availIn = (quint32)read;
+        finish = totRead == toRead;
+        qint64 chunkWritten = 0;
+
+        do {
+            // Waits for the writer if it is lagging behind
+            char* out = output.acquireWrite();
+            watch.lap(stats.writeTime);
+            if (!out) {
+                ZIP_WARNING(zipLog) << "Error while writing" << path;
+                ec = Zip::WriteFailed;
+                break;
+            }
+
+            zstr->nextOut = out;
+            zstr->availOut = ZIP_READ_BUFFER;
+
+            zret = zstr->process(finish);
+            if (zret == ZipCodecStream::DataError || zret == ZipCodecStream::MemoryError) {
+                ZIP_WARNING(zipLog) << "Error while compressing" << path;
+                ec = Zip::ZlibError;
+                break;
+            }
+
+            const qint64 compressed = ZIP_READ_BUFFER - zstr->availOut;
+            if (compressed) {
+                if (keys)
+                    encryptBytes(*keys, out, compressed);
+                else if (aes)
+                    aes->encrypt(out, compressed);
+                output.commitWrite(compressed);
+                chunkWritten += compressed;
+            }
+            watch.lap(stats.compressTime);
+
+        } while (zstr->availOut == 0 || zstr->availIn != 0
+            || (finish && zret != ZipCodecStream::StreamEnd));
+
+        input.releaseRead();
+
+        if (ec == Zip::Ok && !progress(read, chunkWritten))
+            ec = Zip::Canceled;
+        watch.restart();
+    }
+
+    if (ec == Zip::Ok) {
+        // End of stream marker for the writer
+        char* out = output.acquireWrite();
+        if (out)
+            output.commitWrite(0);
+    } else {
+        output.abort();
+    }
+
+    // The reader might still be waiting for a free buffer
+    input.abort();
+    writer.wait();
+    reader.wait();
+    watch.lap(stats.writeTime);
+
+    totalWritten = writer.written();
+    if (ec == Zip::Ok && writer.failed()) {
+        ZIP_WARNING(zipLog) << "Error while writing" << path;
+        ec = Zip::WriteFailed;
+    }
+
+    return ec;
+}
+#endif
+
 //! \internal Writes a new entry in the zip file.
 Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& root,
     Zip::CompressionLevel level)
 {
-    const bool dirOnly = file.isDir();
+    ZipScanEntry info;
+    info.name = file.fileName();
+    info.size = file.size();
+    info.modified = file.lastModified().toTime_t();
+    return createEntry(file.absoluteFilePath(), info, file.isDir(), root, level);
+}
+
+/*! \internal Returns the compressor for \p codec, \p level and \p params.
+    The stream is owned by this object: the one of the previous entry is reset
+    and reused if it has the same settings.
+*/
+ZipCodecStream* ZipPrivate::compressorFor(const ZipCodec* codec, int level,
+    const ZipCodecParameters& params)
+{
+    if (compressor && compressorCodec == codec && compressorLevel == level
+        && compressorParams.strategy == params.strategy
+        && compressorParams.memLevel == params.memLevel
+        && compressorParams.windowBits == params.windowBits
+        && compressor->reset())
+        return compressor;
+
+    delete compressor;
+    compressor = codec->createCompressor(level, params);
+    compressorCodec = codec;
+    compressorLevel = level;
+    compressorParams = params;
+    return compressor;
+}
+
+/*! \internal Returns an idle private object for createEntryConcurrent() or a
+    new one. There are never more than the threads adding files at once.
+*/
+ZipPrivate* ZipPrivate::acquireWorker()
+{
+    QMutexLocker locker(&workerMutex);
+    if (!idleWorkers.isEmpty())
+        return idleWorkers.takeLast();
+    locker.unlock();
+    return new ZipPrivate;
+}
+
+//! \internal Keeps \p worker (buffers and compressor) for the following entries.
+void ZipPrivate::releaseWorker(ZipPrivate* worker)
+{
+    // The reference archive belongs to this object
+    worker->reference = 0;
+    worker->reset();
+
+    QMutexLocker locker(&workerMutex);
+    idleWorkers.append(worker);
+}
+
+//! \internal Deletes the idle private objects of the concurrent add calls.
+void ZipPrivate::clearWorkers()
+{
+    QMutexLocker locker(&workerMutex);
+    qDeleteAll(idleWorkers);
+    idleWorkers.clear();
+}
+
+/*! \internal Sets up this object to write a single entry of \p o's archive
+    to \p dev, with the same settings, for createEntryConcurrent().
+*/
+void ZipPrivate::initWorker(ZipPrivate* o, QIODevice* dev)
+{
+    owner = o;
+    device = dev;
+    output.setDevice(dev);
+    headers = new QMap<QString,ZipEntryP*>;
+    stats.reset();
+
+    password = o->password;
+    method = o->method;
+    encryption = o->encryption;
+    pipelined = o->pipelined;
+    reference = o->reference;
+    referenceCheck = o->referenceCheck;
+    cacheDirectory = o->cacheDirectory;
+    deflateParameters = o->deflateParameters;
+    deflateRules = o->deflateRules;
+
+    QMutexLocker locker(&o->archiveMutex);
+    targetThroughput = o->targetThroughput;
+    adaptiveLevel = o->adaptiveLevel;
+}
+
+/*! \internal Same as createEntry() but the entry is written by a private
+    ZipPrivate to a private buffer (a temporary file for large files) on the
+    calling thread. Only appending the buffer to the archive and adding the
+    entry to the central directory are serialized.
+    The private objects are reused, with their buffers and compressor, by the
+    following entries of any thread until the archive is closed.
+*/
+Zip::ErrorCode ZipPrivate::createEntryConcurrent(const QString& path, const ZipScanEntry& file,
+    bool dirOnly, const QString& root, Zip::CompressionLevel level)
+{
+    // Buffers, keys and codecs must not be shared: use a private object
+    ZipPrivate* worker = acquireWorker();
+
+    // The staging array of the worker keeps its capacity: only the first
+    // pos() bytes belong to this entry
+    QScopedPointer<QIODevice> out;
+    if (dirOnly || file.size <= ZIP_CONCURRENT_MEMORY_LIMIT)
+        out.reset(new QBuffer(&worker->staging));
+    else out.reset(new QTemporaryFile);
+    if (!out->open(QIODevice::ReadWrite)) {
+        releaseWorker(worker);
+        return Zip::OpenFailed;
+    }
+
+    worker->initWorker(this, out.data());
+
+    activeWorkers.fetchAndAddRelaxed(1);
+    Zip::ErrorCode ec = worker->createEntry(path, file, dirOnly, root, level);
+    activeWorkers.fetchAndAddRelaxed(-1);
+    if (ec == Zip::Ok && !worker->output.flush())
+        ec = Zip::WriteFailed;
+
+    if (ec == Zip::Ok) {
+        QMutexLocker locker(&archiveMutex);
+
+        // Closed by another thread?
+        if (!device || !headers)
+            ec = Zip::NoOpenArchive;
+        else if (!output.flush())
+            ec = Zip::WriteFailed;
+
+        const qint64 base = ec == Zip::Ok ? device->pos() : 0;
+        const qint64 size = out->pos();
+        qint64 written = 0;
+
+        if (ec == Zip::Ok) {
+            QTemporaryFile* tmp = qobject_cast<QTemporaryFile*>(out.data());
+            if (tmp) {
+                // copyData() might let the kernel read the file
+                ec = tmp->flush() ? copyData(*tmp, 0, size, written) : Zip::WriteFailed;
+            } else {
+                written = device->write(worker->staging.constData(), size);
+                if (written != size)
+                    ec = Zip::WriteFailed;
+            }
+        }
+
+        if (ec == Zip::Ok) {
+            QMap<QString,ZipEntryP*>::Iterator it = worker->headers->begin();
+            for (; it != worker->headers->end(); ++it) {
+                ZipEntryP* h = it.value();
+                h->lhOffset += base;
+                delete headers->value(it.key());
+                headers->insert(it.key(), h);
+            }
+            worker->headers->clear();
+
+            stats.merge(worker->stats);
+            if (observer)
+                observer->entryFinished(stats);
+        }
+    }
+
+    out.reset();
+    releaseWorker(worker);
+    return ec;
+}
+
+/*! \internal Writes a new entry in the zip file for the file (or directory if
+    \p dirOnly is true) at \p path, using the attributes in \p file instead of
+    querying the file system again.
+*/
+Zip::ErrorCode ZipPrivate::createEntry(const QString& path, const ZipScanEntry& file,
+    bool dirOnly, const QString& root, Zip::CompressionLevel level)
+{
+    if (concurrent)
+        return createEntryConcurrent(path, file, dirOnly, root, level);
+
+    const ZipTraceTimer traceTimer(ZIP_TRACE_ENABLED(zipLog));
 
     // entryName contains the path as it should be written
     // in the zip file records
     const QString entryName = dirOnly
         ? root
-        : root + file.fileName();
+        : root + file.name;
+
+    if (isCanceled())
+        return Zip::Canceled;
+
+    stats.entry = entryName;
+    stats.entrySize = dirOnly ? 0 : file.size;
+    stats.entryBytesIn = stats.entryBytesOut = 0;
+
+    // Same as QFileInfo::completeSuffix()
+    const int dot = file.name.indexOf(QLatin1Char('.'));
+    const QString suffix = dot < 0 ? QString() : file.name.mid(dot + 1).toLower();
+
+#ifdef ZIP_ADAPTIVE
+    // Level chosen by the throughput controller (AutoCPU and AutoFull)
+    bool adaptive = false;
+#endif
 
     // Directory entry
-    if (dirOnly || file.size() < ZIP_COMPRESSION_THRESHOLD) {
+    if (dirOnly || file.size < ZIP_COMPRESSION_THRESHOLD) {
 		level = Zip::Store;
     } else {
         switch (level) {
         case Zip::AutoCPU:
+#ifdef ZIP_ADAPTIVE
+            adaptive = targetThroughput > 0;
+            level = adaptive ? Zip::CompressionLevel(adaptiveLevel) : Zip::Deflate5;
+#else
             level = Zip::Deflate5;
-#ifndef OSDAB_ZIP_NO_DEBUG
-            qDebug("Compression level for '%s': %d", entryName.toLatin1().constData(), (int)level);
 #endif
             break;
         case Zip::AutoMIME:
-            level = detectCompressionByMime(file.completeSuffix().toLower());
-#ifndef OSDAB_ZIP_NO_DEBUG
-            qDebug("Compression level for '%s': %d", entryName.toLatin1().constData(), (int)level);
-#endif
+            level = detectCompressionByMime(suffix);
             break;
         case Zip::AutoFull:
-            level = detectCompressionByMime(file.completeSuffix().toLower());
-#ifndef OSDAB_ZIP_NO_DEBUG
-            qDebug("Compression level for '%s': %d", entryName.toLatin1().constData(), (int)level);
+            level = detectCompressionByMime(suffix);
+#ifdef ZIP_ADAPTIVE
+            // The MIME type gives an upper bound, the throughput target does the rest
+            adaptive = targetThroughput > 0 && level != Zip::Store;
+            if (adaptive)
+                level = Zip::CompressionLevel(qMin<int>(level, adaptiveLevel));
 #endif
             break;
         default: ;
@@ -754,16 +1702,24 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 
 	// create header and store it to write a central directory later
     QScopedPointer<ZipEntryP> h(new ZipEntryP);
-    h->absolutePath = file.absoluteFilePath().toLower();
-    h->fileSize = file.size();
+    h->absolutePath = path.toLower();
+    h->fileSize = file.size;
 
     // Set encryption bit and set the data descriptor bit
 	// so we can use mod time instead of crc for password check
 	bool encrypt = !dirOnly && !password.isEmpty();
-	if (encrypt)
+	const bool aes = encrypt && encryption == Zip::Aes256Encryption;
+	if (aes) {
+		// AES entries have their own password verifier and AE-2 entries no CRC
+		encrypt = false;
+		h->gpFlag[0] |= 1;
+		h->aesStrength = ZipAesCipher::Aes256;
+		h->aesVersion = 2;
+	} else if (encrypt) {
 		h->gpFlag[0] |= 9;
+	}
 
-    QDateTime dt = file.lastModified();
+    QDateTime dt = QDateTime::fromTime_t(file.modified);
     dt = OSDAB_ZIP_MANGLE(fromFileTimestamp)(dt);
 	QDate d = dt.date();
 	h->modDate[1] = ((d.year() - 1980) << 1) & 254;
@@ -777,9 +1733,31 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 	h->modTime[0] = ((t.minute() & 7) << 5) & 224;
 	h->modTime[0] |= t.second() / 2;
 
-	h->szUncomp = dirOnly ? 0 : file.size();
+	h->szUncomp = dirOnly ? 0 : file.size;
+
+    // Unchanged files are copied from the reference archive as they are
+    QMutexLocker referenceLocker(owner && reference ? &owner->referenceMutex : 0);
+    const ZipEntryP* ref = (dirOnly || encrypt || aes) ? 0
+        : findReferenceEntry(entryName, path, h.data());
+    if (!ref)
+        referenceLocker.unlock();
+
+    const ZipCodec* codec = 0;
+    if (ref) {
+        h->compMethod = ref->compMethod;
+        // Sizes and CRC go in the local header: no data descriptor
+        h->gpFlag[0] = ref->gpFlag[0] & ~8;
+        h->gpFlag[1] = ref->gpFlag[1];
+    } else {
+        h->compMethod = (level == Zip::Store) ? ZIP_METHOD_STORED : methodIdentifier(method);
 
-    h->compMethod = (level == Zip::Store) ? 0 : 0x0008;
+        codec = ZipCodec::codecForMethod(h->compMethod);
+        if (!codec || !(codec->capabilities() & ZipCodec::CanCompress)) {
+            ZIP_WARNING(zipLog) << "Unsupported compression method" << h->compMethod;
+            return Zip::UnsupportedMethod;
+        }
+        h->gpFlag[0] |= codec->gpFlag();
+    }
 
 	// **** Write local file header ****
 
@@ -788,7 +1766,7 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 	buffer1[2] = 0x3; buffer1[3] = 0x4;
 
 	// version needed to extract
-	buffer1[ZIP_LH_OFF_VERS] = ZIP_VERSION;
+	buffer1[ZIP_LH_OFF_VERS] = versionNeeded(h.data());
 	buffer1[ZIP_LH_OFF_VERS + 1] = 0;
 
 	// general purpose flag
@@ -796,8 +1774,9 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 	buffer1[ZIP_LH_OFF_GPFLAG + 1] = h->gpFlag[1];
 
 	// compression method
-	buffer1[ZIP_LH_OFF_CMET] = h->compMethod & 0xFF;
-	buffer1[ZIP_LH_OFF_CMET + 1] = (h->compMethod>>8) & 0xFF;
+	const quint16 hMethod = headerMethod(h.data());
+	buffer1[ZIP_LH_OFF_CMET] = hMethod & 0xFF;
+	buffer1[ZIP_LH_OFF_CMET + 1] = (hMethod>>8) & 0xFF;
 
 	// last mod file time
 	buffer1[ZIP_LH_OFF_MODT] = h->modTime[0];
@@ -807,15 +1786,24 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 	buffer1[ZIP_LH_OFF_MODD] = h->modDate[0];
 	buffer1[ZIP_LH_OFF_MODD + 1] = h->modDate[1];
 
-	// skip crc (4bytes) [14,15,16,17]
+	const int saltSize = ZipAesCipher::saltSize(h->aesStrength);
+	h->szComp = encrypt ? ZIP_LOCAL_ENC_HEADER_SIZE : 0;
+	if (aes)
+		h->szComp = saltSize + ZIP_AES_PWV_SIZE + ZIP_AES_AUTH_SIZE;
+
+	// Directories and copied entries don't need to seek back to update the
+	// header, so they can stay in the write buffer with the next entries
+	const bool sizesKnown = dirOnly || ref;
+	if (ref) {
+		h->crc = ref->crc;
+		h->szComp = ref->szComp;
+	}
 
-	// skip compressed size but include evtl. encryption header (4bytes: [18,19,20,21])
-	buffer1[ZIP_LH_OFF_CSIZE] =
-	buffer1[ZIP_LH_OFF_CSIZE + 1] =
-	buffer1[ZIP_LH_OFF_CSIZE + 2] =
-	buffer1[ZIP_LH_OFF_CSIZE + 3] = 0;
+	// crc (4bytes) [14,15,16,17], updated later if not known yet
+	setULong(sizesKnown ? h->crc : 0, buffer1, ZIP_LH_OFF_CRC);
 
-	h->szComp = encrypt ? ZIP_LOCAL_ENC_HEADER_SIZE : 0;
+	// compressed size including evtl. encryption header (4bytes: [18,19,20,21])
+	setULong(sizesKnown ? h->szComp : 0, buffer1, ZIP_LH_OFF_CSIZE);
 
 	// uncompressed size [22,23,24,25]
 	setULong(h->szUncomp, buffer1, ZIP_LH_OFF_USIZE);
@@ -828,21 +1816,30 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 	buffer1[ZIP_LH_OFF_NAMELEN + 1] = (sz >> 8) & 0xFF;
 
 	// extra field length
-	buffer1[ZIP_LH_OFF_XLEN] = buffer1[ZIP_LH_OFF_XLEN + 1] = 0;
+	buffer1[ZIP_LH_OFF_XLEN] = aes ? ZIP_AES_EXTRA_SIZE : 0;
+	buffer1[ZIP_LH_OFF_XLEN + 1] = 0;
 
 	// Store offset to write crc and compressed size
-	h->lhOffset = device->pos();
+	h->lhOffset = output.pos();
 	quint32 crcOffset = h->lhOffset + ZIP_LH_OFF_CRC;
 
-	if (device->write(buffer1, ZIP_LOCAL_HEADER_SIZE) != ZIP_LOCAL_HEADER_SIZE) {
+	if (!output.write(buffer1, ZIP_LOCAL_HEADER_SIZE)) {
         return Zip::WriteFailed;
 	}
 
 	// Write out filename
-	if (device->write(entryNameBytes) != sz) {
+	if (!output.write(entryNameBytes)) {
         return Zip::WriteFailed;
 	}
 
+	// Write out the AES extra field
+	if (aes) {
+		writeAesExtraField(h.data(), buffer1);
+		if (!output.write(buffer1, ZIP_AES_EXTRA_SIZE)) {
+			return Zip::WriteFailed;
+		}
+	}
+
 	// Encryption keys
 	quint32 keys[3] = { 0, 0, 0 };
 
@@ -880,42 +1877,94 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 		buffer1[11] ^= randByte;
 
 		// Write out encryption header
-		if (device->write(buffer1, ZIP_LOCAL_ENC_HEADER_SIZE) != ZIP_LOCAL_ENC_HEADER_SIZE) {
+		if (!output.write(buffer1, ZIP_LOCAL_ENC_HEADER_SIZE)) {
             return Zip::WriteFailed;
 		}
 	}
 
+	// AES salt and password verification value
+	ZipAesCipher aesCipher;
+
+	if (aes) {
+		if (!ZipAesCipher::randomSalt(buffer1, saltSize))
+			return Zip::RandomFailed;
+		aesCipher.init(password.toUtf8(), buffer1, h->aesStrength, buffer1 + saltSize);
+		if (!output.write(buffer1, saltSize + ZIP_AES_PWV_SIZE)) {
+			return Zip::WriteFailed;
+		}
+	}
+
+    // The entry data is written straight to the device
+    if (!dirOnly && !output.flush())
+        return Zip::WriteFailed;
+
     quint32 crc = 0;
     qint64 written = 0;
 
-    if (!dirOnly) {
+    if (ref) {
+        const Zip::ErrorCode ec = copyReferenceEntry(*ref, written);
+        crc = ref->crc;
+        referenceLocker.unlock();
+        if (ec != Zip::Ok)
+            return ec;
+    } else if (!dirOnly) {
+#ifdef ZIP_ADAPTIVE
+        // Only the codec time counts, not I/O or cache hits
+        const qint64 compressTime = stats.compressTime;
+#endif
         quint32* k = keys;
-        const Zip::ErrorCode ec = deflateFile(file, crc, written, level, encrypt ? &k : 0);
+        const Zip::ErrorCode ec = deflateFile(path, crc, written, level, codec,
+            codecParameters(entryName), encrypt ? &k : 0, aes ? &aesCipher : 0);
         if (ec != Zip::Ok)
             return ec;
         Q_ASSERT(!h.isNull());
+#ifdef ZIP_ADAPTIVE
+        const qint64 nsecs = stats.compressTime - compressTime;
+        // Entries copied from the blob cache didn't run the compressor
+        if (adaptive && (level == Zip::Store || nsecs > 0)) {
+            // Concurrent entries feed the controller of the archive; their
+            // compression overlaps, so the archive goes as fast as all of them
+            ZipPrivate* controller = owner ? owner : this;
+            const int workers = qMax(1, controller->activeWorkers.fetchAndAddRelaxed(0));
+            QMutexLocker locker(owner ? &owner->archiveMutex : 0);
+            controller->updateAdaptiveLevel(level, file.size,
+                level == Zip::Store ? 0 : nsecs / workers);
+        }
+#endif
 	}
 
-	// Store end of entry offset
-	quint32 current = device->pos();
+	if (!sizesKnown) {
+		// AE-2 entries don't store the CRC (the authentication code replaces it)
+		h->crc = h->aesVersion == 2 ? 0 : crc;
+		h->szComp += written;
 
-	// Update crc and compressed size in local header
-	if (!device->seek(crcOffset)) {
-        return Zip::SeekFailed;
-	}
+		// Store end of entry data offset (the AES authentication code is
+		// already accounted for in szComp and buffered below)
+		quint32 current = device->pos();
 
-	h->crc = dirOnly ? 0 : crc;
-	h->szComp += written;
+		// Update crc and compressed size in local header
+		if (!device->seek(crcOffset)) {
+			return Zip::SeekFailed;
+		}
 
-	setULong(h->crc, buffer1, 0);
-	setULong(h->szComp, buffer1, 4);
-	if ( device->write(buffer1, 8) != 8) {
-        return Zip::WriteFailed;
+		setULong(h->crc, buffer1, 0);
+		setULong(h->szComp, buffer1, 4);
+		if ( device->write(buffer1, 8) != 8) {
+			return Zip::WriteFailed;
+		}
+
+		// Seek to end of entry
+		if (!device->seek(current)) {
+			return Zip::SeekFailed;
+		}
 	}
 
-	// Seek to end of entry
-    if (!device->seek(current)) {
-		return Zip::SeekFailed;
+	// Write out the AES authentication code
+	if (aes) {
+		aesCipher.authenticationCode(buffer1);
+		if (!output.write(buffer1, ZIP_AES_AUTH_SIZE)) {
+			return Zip::WriteFailed;
+		}
 	}
 
 	if ((h->gpFlag[0] & 8) == 8) {
@@ -936,11 +1985,18 @@ Zip::ErrorCode ZipPrivate::createEntry(const QFileInfo& file, const QString& roo
 		// Uncompressed size
 		setULong(h->szUncomp, buffer1, ZIP_DD_OFF_USIZE);
 
-        if (device->write(buffer1, ZIP_DD_SIZE_WS) != ZIP_DD_SIZE_WS) {
+        if (!output.write(buffer1, ZIP_DD_SIZE_WS)) {
 			return Zip::WriteFailed;
 		}
 	}
 
+    finishEntry();
+
+    ZIP_TRACE(zipLog) << "add entry=" << entryName << " bytes=" << h->szUncomp
+        << " compressed=" << h->szComp << " us=" << traceTimer.usecs()
+        << " method=" << h->compMethod << " level=" << int(level)
+        << " reused=" << (ref != 0);
+
     headers->insert(entryName, h.take());
 	return Zip::Ok;
 }
@@ -981,7 +2037,7 @@ void ZipPrivate::initKeys(quint32* keys) const
 //! Updates a one-char-only CRC; it's the Info-Zip macro re-adapted.
 quint32 ZipPrivate::updateChecksum(const quint32& crc, const quint32& val) const
 {
-    return quint32(crcTable[quint32(crc^val) & 0xff] ^ crc_t(crc >> 8));
+    return ZipCrc32::updateByte(crc, val);
 }
 
 //! \internal Updates encryption keys.
@@ -1118,7 +2174,7 @@ Zip::ErrorCode ZipPrivate::do_closeArchive()
 		return Zip::Ok;
 
 	quint32 szCentralDir = 0;
-    quint32 offCentralDir = device->pos();
+    quint32 offCentralDir = output.pos();
 	Zip::ErrorCode c = Zip::Ok;
 
     if (headers && device) {
@@ -1133,11 +2189,14 @@ Zip::ErrorCode ZipPrivate::do_closeArchive()
     if (c == Zip::Ok)
         c = writeCentralDir(offCentralDir, szCentralDir);
 
+    if (c == Zip::Ok && !output.flush())
+        c = Zip::WriteFailed;
+
     if (c != Zip::Ok) {
         if (file) {
             file->close();
             if (!file->remove()) {
-                qDebug() << "Failed to delete corrupt archive.";
+                ZIP_WARNING(zipLog) << "Failed to delete corrupt archive.";
             }
         }
     }
@@ -1162,7 +2221,7 @@ Zip::ErrorCode ZipPrivate::writeEntry(const QString& fileName, const ZipEntryP*
 	buffer1[ZIP_CD_OFF_MADEBY] = buffer1[ZIP_CD_OFF_MADEBY + 1] = 0;
 
 	// version needed to extract
-	buffer1[ZIP_CD_OFF_VERSION] = ZIP_VERSION;
+	buffer1[ZIP_CD_OFF_VERSION] = versionNeeded(h);
 	buffer1[ZIP_CD_OFF_VERSION + 1] = 0;
 
 	// general purpose flag
@@ -1170,8 +2229,9 @@ Zip::ErrorCode ZipPrivate::writeEntry(const QString& fileName, const ZipEntryP*
 	buffer1[ZIP_CD_OFF_GPFLAG + 1] = h->gpFlag[1];
 
 	// compression method
-	buffer1[ZIP_CD_OFF_CMET] = h->compMethod & 0xFF;
-	buffer1[ZIP_CD_OFF_CMET + 1] = (h->compMethod >> 8) & 0xFF;
+	const quint16 hMethod = headerMethod(h);
+	buffer1[ZIP_CD_OFF_CMET] = hMethod & 0xFF;
+	buffer1[ZIP_CD_OFF_CMET + 1] = (hMethod >> 8) & 0xFF;
 
 	// last mod file time
 	buffer1[ZIP_CD_OFF_MODT] = h->modTime[0];
@@ -1197,7 +2257,9 @@ Zip::ErrorCode ZipPrivate::writeEntry(const QString& fileName, const ZipEntryP*
 	buffer1[ZIP_CD_OFF_NAMELEN + 1] = (sz >> 8) & 0xFF;
 
 	// extra field length
-	buffer1[ZIP_CD_OFF_XLEN] = buffer1[ZIP_CD_OFF_XLEN + 1] = 0;
+	const unsigned int szExtra = h->isAesEncrypted() ? ZIP_AES_EXTRA_SIZE : 0;
+	buffer1[ZIP_CD_OFF_XLEN] = szExtra & 0xFF;
+	buffer1[ZIP_CD_OFF_XLEN + 1] = 0;
 
 	// file comment length
 	buffer1[ZIP_CD_OFF_COMMLEN] = buffer1[ZIP_CD_OFF_COMMLEN + 1] = 0;
@@ -1217,16 +2279,24 @@ Zip::ErrorCode ZipPrivate::writeEntry(const QString& fileName, const ZipEntryP*
 	// relative offset of local header [42->45]
 	setULong(h->lhOffset, buffer1, ZIP_CD_OFF_LHOFF);
 
-	if (device->write(buffer1, ZIP_CD_SIZE) != ZIP_CD_SIZE) {
+	if (!output.write(buffer1, ZIP_CD_SIZE)) {
 		return Zip::WriteFailed;
 	}
 
 	// Write out filename
-	if ((unsigned int)device->write(fileNameBytes) != sz) {
+	if (!output.write(fileNameBytes)) {
 		return Zip::WriteFailed;
 	}
 
-	szCentralDir += (ZIP_CD_SIZE + sz);
+	// Write out the AES extra field
+	if (szExtra) {
+		writeAesExtraField(h, buffer1);
+		if (!output.write(buffer1, szExtra)) {
+			return Zip::WriteFailed;
+		}
+	}
+
+	szCentralDir += (ZIP_CD_SIZE + sz + szExtra);
 
     return Zip::Ok;
 }
@@ -1276,12 +2346,12 @@ Zip::ErrorCode ZipPrivate::writeCentralDir(quint32 offCentralDir, quint32 szCent
 		buffer1[ZIP_EOCD_OFF_COMMLEN + 1] = (commentLength >> 8) & 0xFF;
 	}
 
-	if (device->write(buffer1, ZIP_EOCD_SIZE) != ZIP_EOCD_SIZE) {
+	if (!output.write(buffer1, ZIP_EOCD_SIZE)) {
 		return Zip::WriteFailed;
 	}
 
 	if (commentLength != 0) {
-		if ((unsigned int)device->write(commentBytes) != commentLength) {
+		if (!output.write(commentBytes)) {
 			return Zip::WriteFailed;
 		}
 	}
@@ -1289,6 +2359,53 @@ Zip::ErrorCode ZipPrivate::writeCentralDir(quint32 offCentralDir, quint32 szCent
     return Zip::Ok;
 }
 
+//! \internal Returns the method identifier written in the local and central headers.
+quint16 ZipPrivate::methodIdentifier(Zip::CompressionMethod m)
+{
+    switch (m) {
+    case Zip::Lzma: return ZIP_METHOD_LZMA;
+    case Zip::Zstd: return ZIP_METHOD_ZSTD;
+    default: ;
+    }
+    return ZIP_METHOD_DEFLATED;
+}
+
+//! \internal Returns the method written in the headers (99 for AES encrypted entries).
+quint16 ZipPrivate::headerMethod(const ZipEntryP* h)
+{
+    return h->isAesEncrypted() ? ZIP_METHOD_AES : h->compMethod;
+}
+
+//! \internal Returns the "version needed to extract" for an entry.
+quint8 ZipPrivate::versionNeeded(const ZipEntryP* h)
+{
+    const ZipCodec* codec = ZipCodec::codecForMethod(h->compMethod);
+    quint8 v = codec ? qMax<quint8>(ZIP_VERSION, codec->versionNeeded()) : ZIP_VERSION;
+    if (h->isAesEncrypted())
+        v = qMax<quint8>(v, ZIP_AES_VERSION);
+    return v;
+}
+
+/*!
+    \internal Writes the WinZip AES extra field (ZIP_AES_EXTRA_SIZE bytes):
+    header ID, data size, vendor version, vendor ID ("AE"), key strength and
+    the actual compression method.
+*/
+void ZipPrivate::writeAesExtraField(const ZipEntryP* h, char* buffer)
+{
+    buffer[0] = ZIP_AES_EXTRA_ID & 0xFF;
+    buffer[1] = (ZIP_AES_EXTRA_ID >> 8) & 0xFF;
+    buffer[2] = ZIP_AES_EXTRA_SIZE - 4;
+    buffer[3] = 0;
+    buffer[4] = h->aesVersion & 0xFF;
+    buffer[5] = (h->aesVersion >> 8) & 0xFF;
+    buffer[6] = 'A';
+    buffer[7] = 'E';
+    buffer[8] = h->aesStrength;
+    buffer[9] = h->compMethod & 0xFF;
+    buffer[10] = (h->compMethod >> 8) & 0xFF;
+}
+
 //! \internal
 void ZipPrivate::reset()
 {
@@ -1301,10 +2418,14 @@ void ZipPrivate::reset()
 	}
 
 	device = 0;
+    output.setDevice(0);
 
     if (file)
         delete file;
     file = 0;
+
+    // Workers are only reused within an archive
+    clearWorkers();
 }
 
 //! \internal Returns the path of the parent directory
@@ -1373,6 +2494,310 @@ QString Zip::password() const
 	return d->password;
 }
 
+/*!
+	Sets the encryption method to be used for the next files being added
+	when a password is set. AES passwords are encoded as UTF-8.
+	Files added before calling this method will use the previously set method.
+	Closing the archive won't reset the method!
+*/
+void Zip::setEncryptionMethod(EncryptionMethod method)
+{
+	d->encryption = method;
+}
+
+//! Returns the currently used encryption method.
+Zip::EncryptionMethod Zip::encryptionMethod() const
+{
+	return d->encryption;
+}
+
+/*!
+	Sets the compression method to be used for the next files being added.
+	Files added before calling this method will use the previously set method.
+	Stored entries (Zip::Store or small files) are not affected.
+	Closing the archive won't reset the method!
+*/
+void Zip::setCompressionMethod(CompressionMethod method)
+{
+	d->method = method;
+}
+
+//! Returns the currently used compression method.
+Zip::CompressionMethod Zip::compressionMethod() const
+{
+	return d->method;
+}
+
+/*!
+	Returns true if \p method has been compiled in and can be used to add files.
+*/
+bool Zip::isCompressionMethodSupported(CompressionMethod method)
+{
+	const ZipCodec* codec = ZipCodec::codecForMethod(ZipPrivate::methodIdentifier(method));
+	return codec && (codec->capabilities() & ZipCodec::CanCompress);
+}
+
+/*!
+	Sets the wildcard patterns (e.g. "*.cpp") a file must match to be added by
+	addDirectory() and similar methods. All files are added if \p patterns is
+	empty (default). Patterns containing a '/' are matched against the path
+	relative to the directory being added, the others against the file name.
+	'*' also matches '/'. Directories with no matching files are not added.
+*/
+void Zip::setIncludePatterns(const QStringList& patterns)
+{
+	d->includePatterns = patterns;
+}
+
+//! Returns the patterns set with setIncludePatterns().
+QStringList Zip::includePatterns() const
+{
+	return d->includePatterns;
+}
+
+/*!
+	Sets the wildcard patterns (e.g. "*.o" or "build") of the files and
+	directories that addDirectory() and similar methods will skip.
+	Excluded directories are not scanned at all. Patterns are matched like
+	the include patterns (see setIncludePatterns()).
+*/
+void Zip::setExcludePatterns(const QStringList& patterns)
+{
+	d->excludePatterns = patterns;
+}
+
+//! Returns the patterns set with setExcludePatterns().
+QStringList Zip::excludePatterns() const
+{
+	return d->excludePatterns;
+}
+
+/*!
+	Uses \p file, usually a previous version of the archive being created, as
+	a reference: files whose name (in the archive), size and modification time
+	(and CRC if \p check is Zip::CompareContent) match an unencrypted entry of
+	the reference archive are not compressed again. Their compressed data is
+	copied as it is instead, regardless of the current compression level and
+	method. Encrypted entries are never reused.
+	\p file must not be the archive being created.
+	The reference archive stays open until clearReferenceArchive() is called or
+	this object is destroyed; closing the archive won't reset it.
+*/
+Zip::ErrorCode Zip::setReferenceArchive(const QString& file, ReferenceCheck check)
+{
+	d->clearReference();
+
+	QFile* f = new QFile(file);
+	if (!f->exists()) {
+		delete f;
+		return Zip::FileNotFound;
+	}
+	if (!f->open(QIODevice::ReadOnly)) {
+		delete f;
+		return Zip::OpenFailed;
+	}
+
+	// The UnzipPrivate takes ownership of the file
+	d->reference = new UnzipPrivate;
+	d->reference->file = f;
+	const UnZip::ErrorCode ec = d->reference->openArchive(f);
+	if (ec != UnZip::Ok && ec != UnZip::PartiallyCorrupted) {
+		d->clearReference();
+		return Zip::ReadFailed;
+	}
+
+	d->referenceCheck = check;
+	return Zip::Ok;
+}
+
+//! Stops using the reference archive set with setReferenceArchive() and closes it.
+void Zip::clearReferenceArchive()
+{
+	d->clearReference();
+}
+
+/*!
+	Sets the directory of the compressed data cache; an empty string (default)
+	disables the cache.
+	The compressed data of unencrypted entries is stored in the cache, keyed by
+	the SHA-1 hash of the file content, the compression method, the compression
+	level and the zlib strategy. Files with the same content are then copied
+	from the cache instead of being compressed again, by this or any other
+	process (or build) sharing the same directory.
+	The cache is never cleaned up: remove old files as needed.
+*/
+void Zip::setCacheDirectory(const QString& dir)
+{
+	d->cacheDirectory = dir.isEmpty() ? QString() : QDir::cleanPath(dir);
+}
+
+//! Returns the directory of the compressed data cache or an empty string.
+QString Zip::cacheDirectory() const
+{
+	return d->cacheDirectory;
+}
+
+/*!
+	Sets the throughput target in MB/s (of uncompressed data) used by the
+	Zip::AutoCPU and Zip::AutoFull compression levels. 0 (default) disables it
+	and AutoCPU always uses Deflate5.
+	With a target, the time spent compressing each entry is measured (I/O and
+	entries copied from the cache don't count; with concurrent add calls the
+	time is divided by the number of entries being compressed at once); every
+	few megabytes the level is lowered (down to Zip::Store) if
+	the measured throughput is below the target, or raised if the next level
+	is not known to be too slow (what was measured at a level is forgotten
+	after a while, so it is tried again). AutoFull never uses a higher level
+	than the one suggested by the file extension.
+	The level changes between entries: a single entry always uses one level.
+	Requires Qt 4.8 or later (QElapsedTimer), it is ignored otherwise.
+*/
+void Zip::setTargetThroughput(double mbPerSecond)
+{
+	d->targetThroughput = qMax(0.0, mbPerSecond);
+	d->adaptiveLevel = ZIP_ADAPTIVE_START_LEVEL;
+	d->adaptiveBytes = 0;
+	d->adaptiveNsecs = 0;
+	for (int i = 0; i <= Deflate9; ++i) {
+		d->levelThroughput[i] = -1;
+		d->levelAge[i] = 0;
+	}
+}
+
+//! Returns the throughput target (MB/s) or 0 if the adaptive level is disabled.
+double Zip::targetThroughput() const
+{
+	return d->targetThroughput;
+}
+
+/*!
+	Sets the deflate parameters used by the entries not matching any of the
+	patterns set with setDeflateParameters(const QString&, const DeflateParameters&).
+	Without parameters (default), PNG files use Zip::RleStrategy unless
+	OSDAB_ZIP_NO_PNG_RLE is defined.
+	Only used by the deflate compression method; memLevel is bound to 1..9
+	and windowBits to 9..15.
+*/
+void Zip::setDeflateParameters(const DeflateParameters& params)
+{
+	d->deflateParameters = params;
+}
+
+/*!
+	Sets the deflate parameters of the entries matching the wildcard
+	\p pattern (e.g. "*.bmp" or "logs/raw-*.csv"), replacing the parameters
+	previously set for the same pattern. Patterns containing a '/' are matched
+	against the entry name (the path in the archive), the others against the
+	file name; an entry name without wildcards selects a single entry.
+	Patterns are tried in the order they have been first set: the first
+	matching one is used.
+*/
+void Zip::setDeflateParameters(const QString& pattern, const DeflateParameters& params)
+{
+	for (int i = 0; i < d->deflateRules.size(); ++i) {
+		if (d->deflateRules.at(i).first == pattern) {
+			d->deflateRules[i].second = params;
+			return;
+		}
+	}
+	d->deflateRules.append(qMakePair(pattern, params));
+}
+
+//! Removes all the deflate parameters and patterns.
+void Zip::clearDeflateParameters()
+{
+	d->deflateParameters = DeflateParameters();
+	d->deflateRules.clear();
+}
+
+//! Returns the deflate parameters that would be used for an entry named \p entryName.
+Zip::DeflateParameters Zip::deflateParameters(const QString& entryName) const
+{
+	return d->deflateParametersFor(entryName);
+}
+
+/*!
+	Enables or disables concurrent mode (disabled by default).
+	In concurrent mode the add methods (addFile(), addFiles(), addDirectory()
+	and so on) can be called by several threads at the same time on the
+	same archive: each call compresses its files on the calling thread, into a
+	private memory buffer (or a temporary file for files larger than 16M).
+	Only appending the compressed entries to the archive is serialized.
+	The other methods, including the setters and closeArchive(), must not be
+	called while add methods are running. The order of the entries in the
+	archive depends on thread scheduling.
+*/
+void Zip::setConcurrent(bool enabled)
+{
+	d->concurrent = enabled;
+}
+
+//! Returns true if concurrent mode is enabled (see setConcurrent()).
+bool Zip::isConcurrent() const
+{
+	return d->concurrent;
+}
+
+/*!
+	Sets the object notified after each chunk of data and each entry added to
+	the archive or 0 to remove it. The observer is not owned by this object.
+	In concurrent mode the observer is only notified when an entry is
+	appended to the archive (possibly by several threads, one at a time).
+*/
+void Zip::setProgressObserver(ZipProgressObserver* observer)
+{
+	d->observer = observer;
+}
+
+//! Returns the current progress observer or 0 if none has been set.
+ZipProgressObserver* Zip::progressObserver() const
+{
+	return d->observer;
+}
+
+/*!
+	Returns the bytes processed and the time spent reading, compressing,
+	writing and computing checksums since the archive has been created.
+	Only the data of the entries is accounted, headers are not.
+	Entries copied from a reference archive or from the cache directory
+	account their uncompressed size as read.
+*/
+ZipStatistics Zip::statistics() const
+{
+	QMutexLocker locker(d->concurrent ? &d->archiveMutex : 0);
+	return d->stats;
+}
+
+/*!
+	Cancels the add operations in progress and any following one until a new
+	archive is created: they fail with Canceled. Can be called from any thread.
+	The entries already added are written to the central directory when the
+	archive is closed.
+*/
+void Zip::cancel()
+{
+	d->canceled.fetchAndStoreRelaxed(1);
+}
+
+/*!
+	Enables or disables pipelined compression (disabled by default).
+	When enabled, large files are read and the compressed data is written by
+	two additional threads while the calling thread compresses, so that disk
+	(or network file system) latency and compression overlap.
+	Only used when the archive has been created on a file (not on a generic
+	QIODevice). Has no effect if Qt has been built without thread support.
+*/
+void Zip::setPipelined(bool enabled)
+{
+	d->pipelined = enabled;
+}
+
+//! Returns true if pipelined compression is enabled.
+bool Zip::isPipelined() const
+{
+	return d->pipelined;
+}
+
 /*!
 	Attempts to create a new Zip archive. If \p overwrite is true and the file
 	already exist it will be overwritten.
@@ -1415,7 +2840,7 @@ Zip::ErrorCode Zip::createArchive(const QString& filename, bool overwrite)
 Zip::ErrorCode Zip::createArchive(QIODevice* device)
 {
 	if (!device) {
-		qDebug() << "Invalid device.";
+		ZIP_WARNING(zipLog) << "Invalid device.";
 		return Zip::OpenFailed;
 	}
 
@@ -1610,6 +3035,9 @@ QString Zip::formatError(Zip::ErrorCode c) const
 	case ReadFailed: return QCoreApplication::translate("Zip", "File read error."); break;
 	case WriteFailed: return QCoreApplication::translate("Zip", "File write error."); break;
 	case SeekFailed: return QCoreApplication::translate("Zip", "File seek error."); break;
+	case UnsupportedMethod: return QCoreApplication::translate("Zip", "Unsupported compression method."); break;
+	case Canceled: return QCoreApplication::translate("Zip", "Operation canceled."); break;
+	case RandomFailed: return QCoreApplication::translate("Zip", "No secure random generator available."); break;
 	default: ;
 	}
 
@@ -60,7 +60,10 @@ public:
 		ReadFailed,
 		WriteFailed,
         SeekFailed,
-        InternalError
+        InternalError,
+        UnsupportedMethod,
+        Canceled,
+        RandomFailed
 	};
 
 	enum CompressionLevel
@@ -71,6 +74,50 @@ public:
 		AutoCPU, AutoMIME, AutoFull
 	};
 
+    enum CompressionMethod
+    {
+        Deflated,
+        Lzma,
+        Zstd
+    };
+
+    enum ReferenceCheck
+    {
+        CompareSizeAndTime,
+        CompareContent
+    };
+
+    enum DeflateStrategy
+    {
+        DefaultStrategy,
+        //! Favors Huffman coding over string matching (small values with some noise)
+        FilteredStrategy,
+        //! No string matching at all: fastest, for noisy or random-ish data
+        HuffmanOnlyStrategy,
+        //! Only matches runs of the same byte: fast, good on bitmaps and PNG data
+        RleStrategy
+    };
+
+    //! Tuning of the deflate compressor.
+    struct DeflateParameters
+    {
+        DeflateParameters() : strategy(DefaultStrategy), memLevel(8), windowBits(15) {}
+        DeflateParameters(DeflateStrategy s, int mem = 8, int window = 15) :
+            strategy(s), memLevel(mem), windowBits(window) {}
+
+        DeflateStrategy strategy;
+        //! Memory used for the internal compression state, 1 to 9
+        int memLevel;
+        //! Base two logarithm of the window size, 9 to 15
+        int windowBits;
+    };
+
+    enum EncryptionMethod
+    {
+        PkzipEncryption,
+        Aes256Encryption
+    };
+
 	enum CompressionOption
 	{
         /*! Does not preserve absolute paths in the zip file when adding a
@@ -107,6 +154,44 @@ public:
 	void clearPassword();
 	QString password() const;
 
+    void setEncryptionMethod(EncryptionMethod method);
+    EncryptionMethod encryptionMethod() const;
+
+    void setCompressionMethod(CompressionMethod method);
+    CompressionMethod compressionMethod() const;
+    static bool isCompressionMethodSupported(CompressionMethod method);
+
+    ErrorCode setReferenceArchive(const QString& file,
+        ReferenceCheck check = CompareSizeAndTime);
+    void clearReferenceArchive();
+
+    void setCacheDirectory(const QString& dir);
+    QString cacheDirectory() const;
+
+    void setIncludePatterns(const QStringList& patterns);
+    QStringList includePatterns() const;
+    void setExcludePatterns(const QStringList& patterns);
+    QStringList excludePatterns() const;
+
+    void setTargetThroughput(double mbPerSecond);
+    double targetThroughput() const;
+
+    void setDeflateParameters(const DeflateParameters& params);
+    void setDeflateParameters(const QString& pattern, const DeflateParameters& params);
+    void clearDeflateParameters();
+    DeflateParameters deflateParameters(const QString& entryName) const;
+
+    void setPipelined(bool enabled);
+    bool isPipelined() const;
+
+    void setConcurrent(bool enabled);
+    bool isConcurrent() const;
+
+    void setProgressObserver(ZipProgressObserver* observer);
+    ZipProgressObserver* progressObserver() const;
+    ZipStatistics statistics() const;
+    void cancel();
+
 	ErrorCode createArchive(const QString& file, bool overwrite = true);
 	ErrorCode createArchive(QIODevice* device);
 
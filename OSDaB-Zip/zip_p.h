@@ -40,30 +40,92 @@
 #define OSDAB_ZIP_P__H
 
 #include "zip.h"
+#include "zipaes_p.h"
+#include "zipcodec_p.h"
+#include "zipcrc32_p.h"
 #include "zipentry_p.h"
+#include "zipscanner_p.h"
+#include "zipwritebuffer_p.h"
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QFileInfo>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QPair>
+#include <QtCore/QStringList>
 #include <QtCore/QtGlobal>
 
-#include <zlib/zconf.h>
-
 /*!
 	zLib authors suggest using larger buffers (128K or 256K) for (de)compression (especially for inflate())
 	we use a 256K buffer here - if you want to use this code on a pre-iceage mainframe please change it ;)
 */
 #define ZIP_READ_BUFFER (256*1024)
 
+/*! #define OSDAB_ZIP_NO_ZERO_COPY to always copy stored entries through the read buffer.
+    Otherwise unencrypted stored files are memory mapped to compute the CRC and,
+    on Linux, copied into local archive files by the kernel (copy_file_range()
+    or sendfile()); elsewhere they are written straight from the mapping.
+*/
+// #define OSDAB_ZIP_NO_ZERO_COPY
+
+#if !defined(OSDAB_ZIP_NO_ZERO_COPY) && QT_VERSION >= 0x040400
+#define ZIP_ZERO_COPY
+#endif
+
+//! Files smaller than this are not worth mapping
+#define ZIP_ZERO_COPY_THRESHOLD (64*1024)
+//! Size of the file regions mapped (or copied by the kernel) at once
+#define ZIP_MAP_CHUNK (64*1024*1024)
+
+#ifndef QT_NO_THREAD
+#define ZIP_PIPELINE
+#endif
+
+//! Files smaller than this are compressed without the reader and writer threads
+#define ZIP_PIPELINE_THRESHOLD (4*ZIP_READ_BUFFER)
+//! Number of ZIP_READ_BUFFER sized buffers queued between the pipeline stages
+#define ZIP_PIPELINE_SLOTS 4
+
+#if QT_VERSION >= 0x040800
+#define ZIP_ADAPTIVE
+#endif
+
+//! Data compressed before the throughput controller reconsiders the level
+#define ZIP_ADAPTIVE_WINDOW (8*1024*1024)
+//! First level used by the throughput controller (zlib's default)
+#define ZIP_ADAPTIVE_START_LEVEL 6
+//! Windows after which the throughput measured at a level is forgotten
+#define ZIP_ADAPTIVE_MAX_AGE 16
+
+//! Concurrent add calls compress entries up to this size in memory, larger ones in a temporary file
+#define ZIP_CONCURRENT_MEMORY_LIMIT (16*1024*1024)
+
+//! Blob cache files start with ZIP_CACHE_MAGIC, the CRC, the uncompressed and the compressed size
+#define ZIP_CACHE_MAGIC "OZC1"
+#define ZIP_CACHE_HEADER_SIZE 24
+
 OSDAB_BEGIN_NAMESPACE(Zip)
 
+class UnzipPrivate;
+
+/*! \internal Blob cache file written while an entry is compressed into the archive.
+    The content hash is computed in the same pass. device is reset to 0 if a
+    write fails, in which case the blob is discarded.
+*/
+struct ZipCacheBlob
+{
+    ZipCacheBlob(QIODevice* device) : device(device) {}
+
+    QIODevice* device;
+    ZipSha1 sha;
+};
+
 class ZipPrivate : public QObject
 {
     Q_OBJECT
 
 public:
-    // uLongf from zconf.h
-    typedef uLongf crc_t;
-
 	ZipPrivate();
 	virtual ~ZipPrivate();
 
@@ -71,35 +133,114 @@ public:
 
 	QIODevice* device;
     QFile* file;
+    // Headers and central directory records go through here
+    ZipWriteBuffer output;
 
 	char buffer1[ZIP_READ_BUFFER];
 	char buffer2[ZIP_READ_BUFFER];
 
 	unsigned char* uBuffer;
 
-    const crc_t* crcTable;
-
 	QString comment;
 	QString password;
 
+    Zip::CompressionMethod method;
+    Zip::EncryptionMethod encryption;
+    bool pipelined;
+    bool concurrent;
+
+    // Set on the private objects used by concurrent add calls
+    ZipPrivate* owner;
+    // Serializes the appends to device and headers in concurrent mode
+    mutable QMutex archiveMutex;
+    // Serializes the reads of the reference archive in concurrent mode
+    QMutex referenceMutex;
+    // Private objects of the concurrent add calls, kept for the following entries
+    QList<ZipPrivate*> idleWorkers;
+    QMutex workerMutex;
+    // Small concurrent entries are compressed in here (workers only)
+    QByteArray staging;
+
+    // Compressor of the last entry, reset and reused if the settings match
+    ZipCodecStream* compressor;
+    const ZipCodec* compressorCodec;
+    int compressorLevel;
+    ZipCodecParameters compressorParams;
+
+    QStringList includePatterns;
+    QStringList excludePatterns;
+
+    UnzipPrivate* reference;
+    Zip::ReferenceCheck referenceCheck;
+
+    QString cacheDirectory;
+
+    Zip::DeflateParameters deflateParameters;
+    // (pattern, parameters) rules, the first matching one is used
+    QList<QPair<QString, Zip::DeflateParameters> > deflateRules;
+
+    double targetThroughput;
+    int adaptiveLevel;
+    qint64 adaptiveBytes;
+    qint64 adaptiveNsecs;
+    // Concurrent entries being compressed, their compression times overlap
+    QAtomicInt activeWorkers;
+    // Smoothed throughput (MB/s) measured at each level, -1 if unknown
+    double levelThroughput[Zip::Deflate9 + 1];
+    // Windows since each level was last measured
+    int levelAge[Zip::Deflate9 + 1];
+
+    ZipStatistics stats;
+    ZipProgressObserver* observer;
+    // Set by Zip::cancel(), possibly from another thread, or by the observer
+    QAtomicInt canceled;
+
 	Zip::ErrorCode createArchive(QIODevice* device);
 	Zip::ErrorCode closeArchive();
 	void reset();
 
 	bool zLibInit();
 
+    void clearReference();
+    Zip::DeflateParameters deflateParametersFor(const QString& entryName) const;
+    void updateAdaptiveLevel(Zip::CompressionLevel level, qint64 bytes, qint64 nsecs);
+    bool isCanceled();
+    bool progress(qint64 in, qint64 out);
+    void finishEntry();
+    const ZipEntryP* findReferenceEntry(const QString& entryName,
+        const QString& path, const ZipEntryP* h);
+    Zip::ErrorCode copyReferenceEntry(const ZipEntryP& ref, qint64& written);
+    Zip::ErrorCode copyData(QIODevice& src, qint64 offset, qint64 size, qint64& written);
+
     bool containsEntry(const QFileInfo& info) const;
+    bool containsEntry(const QString& absPath, qint64 size) const;
 
     Zip::ErrorCode addDirectory(const QString& path, const QString& root,
         Zip::CompressionOptions options, Zip::CompressionLevel level,
         int hierarchyLevel, int* addedFiles = 0);
+    Zip::ErrorCode addScannedDirectory(const ZipScanDir& dir, const QString& root,
+        Zip::CompressionOptions options, Zip::CompressionLevel level,
+        int hierarchyLevel, int* addedFiles);
     Zip::ErrorCode addFiles(const QStringList& paths, const QString& root,
         Zip::CompressionOptions options, Zip::CompressionLevel level,
         int* addedFiles);
 
     Zip::ErrorCode createEntry(const QFileInfo& file, const QString& root,
         Zip::CompressionLevel level);
+    Zip::ErrorCode createEntry(const QString& path, const ZipScanEntry& file,
+        bool dirOnly, const QString& root, Zip::CompressionLevel level);
+    Zip::ErrorCode createEntryConcurrent(const QString& path, const ZipScanEntry& file,
+        bool dirOnly, const QString& root, Zip::CompressionLevel level);
+    void initWorker(ZipPrivate* owner, QIODevice* dev);
+    ZipPrivate* acquireWorker();
+    void releaseWorker(ZipPrivate* worker);
+    void clearWorkers();
+    ZipCodecStream* compressorFor(const ZipCodec* codec, int level, const ZipCodecParameters& params);
 	Zip::CompressionLevel detectCompressionByMime(const QString& ext);
+    static quint16 headerMethod(const ZipEntryP* h);
+    static quint8 versionNeeded(const ZipEntryP* h);
+    void writeAesExtraField(const ZipEntryP* h, char* buffer);
+    static quint16 methodIdentifier(Zip::CompressionMethod m);
 
     inline quint32 updateChecksum(const quint32& crc, const quint32& val) const;
 
@@ -116,13 +257,31 @@ private slots:
     void deviceDestroyed(QObject*);
 
 private:
-    int compressionStrategy(const QString& path, QIODevice& file) const;
-    Zip::ErrorCode deflateFile(const QFileInfo& fileInfo,
-        quint32& crc, qint64& written, const Zip::CompressionLevel& level, quint32** keys);
+    ZipCodecParameters codecParameters(const QString& entryName) const;
+    Zip::ErrorCode deflateFile(const QString& path,
+        quint32& crc, qint64& written, const Zip::CompressionLevel& level,
+        const ZipCodec* codec, const ZipCodecParameters& params,
+        quint32** keys, ZipAesCipher* aes);
     Zip::ErrorCode storeFile(const QString& path, QIODevice& file,
-        quint32& crc, qint64& written, quint32** keys);
+        quint32& crc, qint64& written, quint32** keys, ZipAesCipher* aes);
+#ifdef ZIP_ZERO_COPY
+    bool storeFileZeroCopy(QFile& file, quint32& crc, qint64& written, Zip::ErrorCode& ec);
+#endif
     Zip::ErrorCode compressFile(const QString& path, QIODevice& file,
-        quint32& crc, qint64& written, const Zip::CompressionLevel& level, quint32** keys);
+        quint32& crc, qint64& written, const Zip::CompressionLevel& level,
+        const ZipCodec* codec, const ZipCodecParameters& params,
+        quint32** keys, ZipAesCipher* aes, ZipCacheBlob* blob = 0);
+    bool compressCached(const QString& path, QFile& file, quint32& crc,
+        qint64& written, const Zip::CompressionLevel& level, const ZipCodec* codec,
+        const ZipCodecParameters& params, Zip::ErrorCode& ec);
+    void writeCacheHeader(char* buffer, quint32 crc, qint64 size, qint64 compressed);
+    static bool readCacheHeader(const char* buffer, quint32& crc, qint64& size, qint64& compressed);
+#ifdef ZIP_PIPELINE
+    Zip::ErrorCode compressFilePipelined(const QString& path, QIODevice& file,
+        quint32& crc, qint64& written, const Zip::CompressionLevel& level,
+        const ZipCodec* codec, const ZipCodecParameters& params,
+        quint32** keys, ZipAesCipher* aes);
+#endif
     Zip::ErrorCode do_closeArchive();
     Zip::ErrorCode writeEntry(const QString& fileName, const ZipEntryP* h, quint32& szCentralDir);
     Zip::ErrorCode writeCentralDir(quint32 offCentralDir, quint32 szCentralDir);
@@ -0,0 +1,774 @@
+/****************************************************************************
+** Filename: zipaes.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** WinZip AES encryption (AE-1 and AE-2) for the Zip and UnZip classes.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zipaes_p.h"
+
+#include <QtCore/QFile>
+
+#include <string.h>
+
+#if QT_VERSION >= 0x050A00
+#include <QtCore/QRandomGenerator>
+#elif defined(Q_OS_WIN)
+#include <QtCore/qt_windows.h>
+// RtlGenRandom() is exported as SystemFunction036 without a calling convention
+#define SystemFunction036 NTAPI SystemFunction036
+#include <ntsecapi.h>
+#undef SystemFunction036
+#elif defined(Q_OS_LINUX) && defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 25))
+#define ZIP_AES_GETRANDOM
+#include <errno.h>
+#include <sys/random.h>
+#endif
+
+#if !defined(OSDAB_ZIP_NO_AESNI) \
+    && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) \
+    && (defined(__GNUC__) || defined(_MSC_VER))
+#define ZIP_AES_AESNI
+#endif
+
+#ifdef ZIP_AES_AESNI
+// The SHA extensions speed up the HMAC-SHA1 authentication
+#define ZIP_AES_SHANI
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ZIP_AES_TARGET_AESNI
+#define ZIP_AES_TARGET_SHANI
+#else
+#include <cpuid.h>
+#define ZIP_AES_TARGET_AESNI __attribute__((target("aes,sse2")))
+#define ZIP_AES_TARGET_SHANI __attribute__((target("sha,sse4.1")))
+#endif
+#endif
+
+//! PBKDF2 iteration count mandated by the WinZip AES specification
+#define ZIP_AES_PBKDF2_ITERATIONS 1000
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+namespace {
+
+/*!
+    \internal Encrypts \p blocks 16 byte blocks of keystream with the counter
+    starting at \p counter and XORs them into \p data.
+*/
+typedef void (*CtrFunction)(const uchar* roundKeys, const quint32* roundKeyWords,
+    int rounds, quint64 counter, uchar* data, quint64 blocks);
+
+//! \internal Updates the SHA-1 state \p h with \p blocks 64 byte blocks.
+typedef void (*Sha1Function)(quint32* h, const uchar* data, quint64 blocks);
+
+inline quint32 readUBLong(const uchar* p)
+{
+    return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | quint32(p[3]);
+}
+
+inline void writeUBLong(quint32 v, uchar* p)
+{
+    p[0] = uchar(v >> 24);
+    p[1] = uchar(v >> 16);
+    p[2] = uchar(v >> 8);
+    p[3] = uchar(v);
+}
+
+//! WinZip counter blocks are little endian and the high 64 bits are always 0 in practice.
+inline void counterBlock(quint64 counter, uchar* block)
+{
+    for (int i = 0; i < 8; ++i) {
+        block[i] = uchar(counter >> (8 * i));
+        block[i + 8] = 0;
+    }
+}
+
+/************************************************************************
+ Portable (table based) AES
+*************************************************************************/
+
+struct AesTables
+{
+    uchar sbox[256];
+    quint32 te[4][256];
+
+    AesTables();
+};
+
+//! \internal Multiplication by x in GF(2^8).
+inline uchar xtime(uchar x)
+{
+    return uchar((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+inline uchar rotl8(uchar x, int n)
+{
+    return uchar((x << n) | (x >> (8 - n)));
+}
+
+AesTables::AesTables()
+{
+    // Builds the S-box walking GF(2^8) with generator 3 and its inverse
+    uchar p = 1;
+    uchar q = 1;
+    do {
+        p = uchar(p ^ (p << 1) ^ ((p & 0x80) ? 0x1b : 0));
+
+        q ^= q << 1;
+        q ^= q << 2;
+        q ^= q << 4;
+        if (q & 0x80)
+            q ^= 0x09;
+
+        sbox[p] = uchar(q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4) ^ 0x63);
+    } while (p != 1);
+    sbox[0] = 0x63;
+
+    for (int i = 0; i < 256; ++i) {
+        const uchar s = sbox[i];
+        const uchar s2 = xtime(s);
+        const uchar s3 = uchar(s2 ^ s);
+        const quint32 t = (quint32(s2) << 24) | (quint32(s) << 16) | (quint32(s) << 8) | quint32(s3);
+        te[0][i] = t;
+        te[1][i] = (t >> 8) | (t << 24);
+        te[2][i] = (t >> 16) | (t << 16);
+        te[3][i] = (t >> 24) | (t << 8);
+    }
+}
+
+//! \internal Tables are built on first use.
+const AesTables& tables()
+{
+    static const AesTables t;
+    return t;
+}
+
+//! \internal Encrypts a single block with the T-tables.
+void encryptBlock(const quint32* rk, int rounds, const uchar* in, uchar* out)
+{
+    const AesTables& t = tables();
+    const quint32 (*te)[256] = t.te;
+    const uchar* sbox = t.sbox;
+
+    quint32 s0 = readUBLong(in) ^ rk[0];
+    quint32 s1 = readUBLong(in + 4) ^ rk[1];
+    quint32 s2 = readUBLong(in + 8) ^ rk[2];
+    quint32 s3 = readUBLong(in + 12) ^ rk[3];
+    quint32 t0, t1, t2, t3;
+
+    for (int r = 1; r < rounds; ++r) {
+        rk += 4;
+        t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xff] ^ te[2][(s2 >> 8) & 0xff] ^ te[3][s3 & 0xff] ^ rk[0];
+        t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xff] ^ te[2][(s3 >> 8) & 0xff] ^ te[3][s0 & 0xff] ^ rk[1];
+        t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xff] ^ te[2][(s0 >> 8) & 0xff] ^ te[3][s1 & 0xff] ^ rk[2];
+        t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xff] ^ te[2][(s1 >> 8) & 0xff] ^ te[3][s2 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    // Last round: no MixColumns
+    rk += 4;
+    t0 = (quint32(sbox[s0 >> 24]) << 24) ^ (quint32(sbox[(s1 >> 16) & 0xff]) << 16)
+        ^ (quint32(sbox[(s2 >> 8) & 0xff]) << 8) ^ quint32(sbox[s3 & 0xff]) ^ rk[0];
+    t1 = (quint32(sbox[s1 >> 24]) << 24) ^ (quint32(sbox[(s2 >> 16) & 0xff]) << 16)
+        ^ (quint32(sbox[(s3 >> 8) & 0xff]) << 8) ^ quint32(sbox[s0 & 0xff]) ^ rk[1];
+    t2 = (quint32(sbox[s2 >> 24]) << 24) ^ (quint32(sbox[(s3 >> 16) & 0xff]) << 16)
+        ^ (quint32(sbox[(s0 >> 8) & 0xff]) << 8) ^ quint32(sbox[s1 & 0xff]) ^ rk[2];
+    t3 = (quint32(sbox[s3 >> 24]) << 24) ^ (quint32(sbox[(s0 >> 16) & 0xff]) << 16)
+        ^ (quint32(sbox[(s1 >> 8) & 0xff]) << 8) ^ quint32(sbox[s2 & 0xff]) ^ rk[3];
+
+    writeUBLong(t0, out);
+    writeUBLong(t1, out + 4);
+    writeUBLong(t2, out + 8);
+    writeUBLong(t3, out + 12);
+}
+
+void ctrPortable(const uchar* roundKeys, const quint32* roundKeyWords,
+    int rounds, quint64 counter, uchar* data, quint64 blocks)
+{
+    Q_UNUSED(roundKeys);
+
+    uchar block[16];
+    while (blocks--) {
+        counterBlock(counter++, block);
+        encryptBlock(roundKeyWords, rounds, block, block);
+        for (int i = 0; i < 16; ++i)
+            data[i] ^= block[i];
+        data += 16;
+    }
+}
+
+/************************************************************************
+ AES-NI
+*************************************************************************/
+
+#ifdef ZIP_AES_AESNI
+
+/*!
+    \internal CTR keystream with AES-NI. Eight independent counter blocks
+    are encrypted at a time to hide the latency of the AESENC instruction.
+*/
+ZIP_AES_TARGET_AESNI
+void ctrAesni(const uchar* roundKeys, const quint32* roundKeyWords,
+    int rounds, quint64 counter, uchar* data, quint64 blocks)
+{
+    Q_UNUSED(roundKeyWords);
+
+    __m128i k[15];
+    for (int r = 0; r <= rounds; ++r)
+        k[r] = _mm_loadu_si128((const __m128i*) (roundKeys + 16 * r));
+
+    while (blocks >= 8) {
+        __m128i b[8];
+        for (int i = 0; i < 8; ++i)
+            b[i] = _mm_xor_si128(_mm_set_epi64x(0, (qint64) (counter + i)), k[0]);
+
+        for (int r = 1; r < rounds; ++r) {
+            for (int i = 0; i < 8; ++i)
+                b[i] = _mm_aesenc_si128(b[i], k[r]);
+        }
+
+        for (int i = 0; i < 8; ++i) {
+            b[i] = _mm_aesenclast_si128(b[i], k[rounds]);
+            __m128i* p = (__m128i*) (data + 16 * i);
+            _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), b[i]));
+        }
+
+        counter += 8;
+        data += 128;
+        blocks -= 8;
+    }
+
+    while (blocks--) {
+        __m128i b = _mm_xor_si128(_mm_set_epi64x(0, (qint64) counter++), k[0]);
+        for (int r = 1; r < rounds; ++r)
+            b = _mm_aesenc_si128(b, k[r]);
+        b = _mm_aesenclast_si128(b, k[rounds]);
+        _mm_storeu_si128((__m128i*) data, _mm_xor_si128(_mm_loadu_si128((const __m128i*) data), b));
+        data += 16;
+    }
+}
+
+//! \internal Returns true if the CPU supports AES-NI
+bool hasAesni()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) && (info[3] & (1 << 26));
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif // ZIP_AES_AESNI
+
+/************************************************************************
+ SHA-1
+*************************************************************************/
+
+#define ZIP_SHA1_ROL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+//! \internal Portable SHA-1 compression of \p blocks 64 byte blocks.
+void sha1Portable(quint32* h, const uchar* p, quint64 blocks)
+{
+    while (blocks--) {
+        quint32 w[80];
+        for (int i = 0; i < 16; ++i)
+            w[i] = readUBLong(p + 4 * i);
+        for (int i = 16; i < 80; ++i)
+            w[i] = ZIP_SHA1_ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        quint32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        quint32 t;
+
+        // One loop per round function keeps the compression free of branches
+        for (int i = 0; i < 20; ++i) {
+            t = ZIP_SHA1_ROL(a, 5) + ((b & c) | (~b & d)) + e + 0x5a827999 + w[i];
+            e = d; d = c; c = ZIP_SHA1_ROL(b, 30); b = a; a = t;
+        }
+        for (int i = 20; i < 40; ++i) {
+            t = ZIP_SHA1_ROL(a, 5) + (b ^ c ^ d) + e + 0x6ed9eba1 + w[i];
+            e = d; d = c; c = ZIP_SHA1_ROL(b, 30); b = a; a = t;
+        }
+        for (int i = 40; i < 60; ++i) {
+            t = ZIP_SHA1_ROL(a, 5) + ((b & c) | (b & d) | (c & d)) + e + 0x8f1bbcdc + w[i];
+            e = d; d = c; c = ZIP_SHA1_ROL(b, 30); b = a; a = t;
+        }
+        for (int i = 60; i < 80; ++i) {
+            t = ZIP_SHA1_ROL(a, 5) + (b ^ c ^ d) + e + 0xca62c1d6 + w[i];
+            e = d; d = c; c = ZIP_SHA1_ROL(b, 30); b = a; a = t;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        p += 64;
+    }
+}
+
+#undef ZIP_SHA1_ROL
+
+#ifdef ZIP_AES_SHANI
+
+#define ZIP_SHA1_LOAD(i) _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (p + 16 * (i))), mask)
+
+// Four rounds with the message words in m[i % 4]. The expanded message words
+// for the following rounds are computed as described in Intel's "New
+// Instructions Supporting the Secure Hash Algorithm on Intel Architecture Processors".
+#define ZIP_SHA1_ROUNDS(i, eCur, eNext, f) \
+    eCur = _mm_sha1nexte_epu32(eCur, m[(i) % 4]); \
+    eNext = abcd; \
+    abcd = _mm_sha1rnds4_epu32(abcd, eCur, f); \
+    if ((i) >= 3 && (i) <= 18) m[((i) + 1) % 4] = _mm_sha1msg2_epu32(m[((i) + 1) % 4], m[(i) % 4]); \
+    if ((i) >= 2 && (i) <= 17) m[((i) + 2) % 4] = _mm_xor_si128(m[((i) + 2) % 4], m[(i) % 4]); \
+    if ((i) >= 1 && (i) <= 16) m[((i) + 3) % 4] = _mm_sha1msg1_epu32(m[((i) + 3) % 4], m[(i) % 4])
+
+//! \internal SHA-1 compression with the SHA extensions.
+ZIP_AES_TARGET_SHANI
+void sha1Shani(quint32* h, const uchar* p, quint64 blocks)
+{
+    const __m128i mask = _mm_set_epi64x(Q_INT64_C(0x0001020304050607), Q_INT64_C(0x08090a0b0c0d0e0f));
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) h), 0x1b);
+    __m128i e0 = _mm_set_epi32((int) h[4], 0, 0, 0);
+    __m128i e1;
+    __m128i m[4];
+
+    while (blocks--) {
+        const __m128i abcdSave = abcd;
+        const __m128i e0Save = e0;
+
+        m[0] = ZIP_SHA1_LOAD(0);
+        m[1] = ZIP_SHA1_LOAD(1);
+        m[2] = ZIP_SHA1_LOAD(2);
+        m[3] = ZIP_SHA1_LOAD(3);
+
+        // Rounds 0-3
+        e0 = _mm_add_epi32(e0, m[0]);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        ZIP_SHA1_ROUNDS(1, e1, e0, 0);
+        ZIP_SHA1_ROUNDS(2, e0, e1, 0);
+        ZIP_SHA1_ROUNDS(3, e1, e0, 0);
+        ZIP_SHA1_ROUNDS(4, e0, e1, 0);
+        ZIP_SHA1_ROUNDS(5, e1, e0, 1);
+        ZIP_SHA1_ROUNDS(6, e0, e1, 1);
+        ZIP_SHA1_ROUNDS(7, e1, e0, 1);
+        ZIP_SHA1_ROUNDS(8, e0, e1, 1);
+        ZIP_SHA1_ROUNDS(9, e1, e0, 1);
+        ZIP_SHA1_ROUNDS(10, e0, e1, 2);
+        ZIP_SHA1_ROUNDS(11, e1, e0, 2);
+        ZIP_SHA1_ROUNDS(12, e0, e1, 2);
+        ZIP_SHA1_ROUNDS(13, e1, e0, 2);
+        ZIP_SHA1_ROUNDS(14, e0, e1, 2);
+        ZIP_SHA1_ROUNDS(15, e1, e0, 3);
+        ZIP_SHA1_ROUNDS(16, e0, e1, 3);
+        ZIP_SHA1_ROUNDS(17, e1, e0, 3);
+        ZIP_SHA1_ROUNDS(18, e0, e1, 3);
+        ZIP_SHA1_ROUNDS(19, e1, e0, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+
+        p += 64;
+    }
+
+    _mm_storeu_si128((__m128i*) h, _mm_shuffle_epi32(abcd, 0x1b));
+    h[4] = (quint32) _mm_extract_epi32(e0, 3);
+}
+
+#undef ZIP_SHA1_ROUNDS
+#undef ZIP_SHA1_LOAD
+
+//! \internal Returns true if the CPU supports the SHA extensions and SSE 4.1
+bool hasShani()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuidex(info, 7, 0);
+    const bool sha = info[1] & (1 << 29);
+    __cpuid(info, 1);
+    return sha && (info[2] & (1 << 19));
+#else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & (1 << 29)))
+        return false;
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+#endif // ZIP_AES_SHANI
+
+/************************************************************************
+ Dispatch
+*************************************************************************/
+
+struct AesEngine
+{
+    CtrFunction function;
+    Sha1Function sha1;
+    const char* name;
+
+    AesEngine();
+};
+
+AesEngine::AesEngine() : function(ctrPortable), sha1(sha1Portable), name("portable")
+{
+#ifdef ZIP_AES_AESNI
+    if (hasAesni()) {
+        function = ctrAesni;
+        name = "aes-ni";
+    }
+#endif
+#ifdef ZIP_AES_SHANI
+    if (hasShani()) {
+        sha1 = sha1Shani;
+        name = function == ctrAesni ? "aes-ni+sha-ni" : "sha-ni";
+    }
+#endif
+}
+
+//! \internal The implementation is selected on first use.
+const AesEngine& engine()
+{
+    static const AesEngine e;
+    return e;
+}
+
+/************************************************************************
+ HMAC-SHA1 and PBKDF2
+*************************************************************************/
+
+//! \internal Initializes the inner and outer HMAC-SHA1 digests for \p key.
+void hmacInit(const uchar* key, int keyLen, ZipSha1& inner, ZipSha1& outer)
+{
+    uchar k[64];
+    memset(k, 0, sizeof(k));
+
+    if (keyLen > 64) {
+        ZipSha1 h;
+        h.update(key, keyLen);
+        h.final(k);
+    } else {
+        memcpy(k, key, keyLen);
+    }
+
+    uchar pad[64];
+    for (int i = 0; i < 64; ++i)
+        pad[i] = k[i] ^ 0x36;
+    inner.reset();
+    inner.update(pad, 64);
+
+    for (int i = 0; i < 64; ++i)
+        pad[i] = k[i] ^ 0x5c;
+    outer.reset();
+    outer.update(pad, 64);
+}
+
+//! \internal Completes an HMAC-SHA1 started with hmacInit().
+void hmacFinal(ZipSha1& inner, ZipSha1& outer, uchar mac[20])
+{
+    uchar digest[20];
+    inner.final(digest);
+    outer.update(digest, 20);
+    outer.final(mac);
+}
+
+//! \internal PBKDF2-HMAC-SHA1 (RFC 2898)
+void pbkdf2(const QByteArray& password, const uchar* salt, int saltLen,
+    int iterations, uchar* out, int outLen)
+{
+    ZipSha1 inner, outer;
+    hmacInit((const uchar*) password.constData(), password.size(), inner, outer);
+
+    quint32 blockIndex = 1;
+    while (outLen > 0) {
+        uchar index[4];
+        writeUBLong(blockIndex++, index);
+
+        uchar u[20];
+        ZipSha1 i = inner;
+        ZipSha1 o = outer;
+        i.update(salt, saltLen);
+        i.update(index, 4);
+        hmacFinal(i, o, u);
+
+        uchar t[20];
+        memcpy(t, u, 20);
+        for (int n = 1; n < iterations; ++n) {
+            i = inner;
+            o = outer;
+            i.update(u, 20);
+            hmacFinal(i, o, u);
+            for (int j = 0; j < 20; ++j)
+                t[j] ^= u[j];
+        }
+
+        const int sz = qMin(outLen, 20);
+        memcpy(out, t, sz);
+        out += sz;
+        outLen -= sz;
+    }
+}
+
+} // namespace
+
+
+/************************************************************************
+ ZipSha1
+*************************************************************************/
+
+void ZipSha1::reset()
+{
+    h[0] = 0x67452301;
+    h[1] = 0xefcdab89;
+    h[2] = 0x98badcfe;
+    h[3] = 0x10325476;
+    h[4] = 0xc3d2e1f0;
+    used = 0;
+    length = 0;
+}
+
+void ZipSha1::update(const uchar* data, quint64 len)
+{
+    length += len;
+
+    if (used) {
+        const quint32 sz = (quint32) qMin<quint64>(64 - used, len);
+        memcpy(block + used, data, sz);
+        used += sz;
+        data += sz;
+        len -= sz;
+        if (used < 64)
+            return;
+        engine().sha1(h, block, 1);
+        used = 0;
+    }
+
+    if (len >= 64) {
+        const quint64 blocks = len / 64;
+        engine().sha1(h, data, blocks);
+        data += blocks * 64;
+        len -= blocks * 64;
+    }
+
+    if (len) {
+        memcpy(block, data, (size_t) len);
+        used = (quint32) len;
+    }
+}
+
+void ZipSha1::final(uchar digest[20])
+{
+    const quint64 bits = length * 8;
+
+    block[used++] = 0x80;
+    if (used > 56) {
+        memset(block + used, 0, 64 - used);
+        engine().sha1(h, block, 1);
+        used = 0;
+    }
+    memset(block + used, 0, 56 - used);
+    writeUBLong(quint32(bits >> 32), block + 56);
+    writeUBLong(quint32(bits), block + 60);
+    engine().sha1(h, block, 1);
+
+    for (int i = 0; i < 5; ++i)
+        writeUBLong(h[i], digest + 4 * i);
+
+    reset();
+}
+
+
+/************************************************************************
+ ZipAesCipher
+*************************************************************************/
+
+ZipAesCipher::ZipAesCipher() : rounds(0), counter(1), keystreamPos(16)
+{
+    memset(roundKeys, 0, sizeof(roundKeys));
+    memset(roundKeyWords, 0, sizeof(roundKeyWords));
+    memset(keystream, 0, sizeof(keystream));
+}
+
+int ZipAesCipher::saltSize(int strength)
+{
+    switch (strength) {
+    case Aes128: return 8;
+    case Aes192: return 12;
+    case Aes256: return 16;
+    default: ;
+    }
+    return 0;
+}
+
+bool ZipAesCipher::randomSalt(char* salt, int size)
+{
+    // A salt must never repeat for a password: only the system CSPRNG is used
+#if QT_VERSION >= 0x050A00
+    for (int i = 0; i < size; i += 4) {
+        const quint32 r = QRandomGenerator::system()->generate();
+        memcpy(salt + i, &r, qMin(4, size - i));
+    }
+    return true;
+#elif defined(Q_OS_WIN)
+    return RtlGenRandom(salt, (ULONG) size) != FALSE;
+#else
+#ifdef ZIP_AES_GETRANDOM
+    int done = 0;
+    while (done < size) {
+        const ssize_t n = getrandom(salt + done, size - done, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += (int) n;
+    }
+    if (done == size)
+        return true;
+#endif
+    QFile f(QLatin1String("/dev/urandom"));
+    return f.open(QIODevice::ReadOnly | QIODevice::Unbuffered) && f.read(salt, size) == size;
+#endif
+}
+
+bool ZipAesCipher::init(const QByteArray& password, const char* salt, int strength, char* verifier)
+{
+    const int sltSize = saltSize(strength);
+    if (!sltSize)
+        return false;
+
+    // Key size is twice the salt size: 16, 24 or 32 bytes
+    const int keySize = sltSize * 2;
+    uchar derived[2 * 32 + ZIP_AES_PWV_SIZE];
+    pbkdf2(password, (const uchar*) salt, sltSize, ZIP_AES_PBKDF2_ITERATIONS,
+        derived, 2 * keySize + ZIP_AES_PWV_SIZE);
+
+    // AES key expansion (FIPS 197, section 5.2)
+    const int nk = keySize / 4;
+    rounds = nk + 6;
+    memcpy(roundKeys, derived, keySize);
+
+    const uchar* sbox = tables().sbox;
+    uchar rcon = 1;
+    for (int i = nk; i < 4 * (rounds + 1); ++i) {
+        uchar t[4];
+        memcpy(t, roundKeys + 4 * (i - 1), 4);
+        if (i % nk == 0) {
+            const uchar t0 = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[t0];
+            rcon = xtime(rcon);
+        } else if (nk > 6 && i % nk == 4) {
+            for (int j = 0; j < 4; ++j)
+                t[j] = sbox[t[j]];
+        }
+        for (int j = 0; j < 4; ++j)
+            roundKeys[4 * i + j] = roundKeys[4 * (i - nk) + j] ^ t[j];
+    }
+
+    for (int i = 0; i < 4 * (rounds + 1); ++i)
+        roundKeyWords[i] = readUBLong(roundKeys + 4 * i);
+
+    hmacInit(derived + keySize, keySize, hmacInner, hmacOuter);
+
+    memcpy(verifier, derived + 2 * keySize, ZIP_AES_PWV_SIZE);
+
+    counter = 1;
+    keystreamPos = 16;
+
+    memset(derived, 0, sizeof(derived));
+    return true;
+}
+
+//! \internal XORs \p len bytes of keystream into \p data.
+void ZipAesCipher::crypt(uchar* data, quint64 len)
+{
+    // Left over keystream from the previous call
+    while (len && keystreamPos < 16) {
+        *data++ ^= keystream[keystreamPos++];
+        --len;
+    }
+
+    const quint64 blocks = len / 16;
+    if (blocks) {
+        engine().function(roundKeys, roundKeyWords, rounds, counter, data, blocks);
+        counter += blocks;
+        data += blocks * 16;
+        len -= blocks * 16;
+    }
+
+    if (len) {
+        counterBlock(counter++, keystream);
+        encryptBlock(roundKeyWords, rounds, keystream, keystream);
+        keystreamPos = 0;
+        while (len--)
+            *data++ ^= keystream[keystreamPos++];
+    }
+}
+
+void ZipAesCipher::encrypt(char* data, qint64 len)
+{
+    if (len <= 0)
+        return;
+    crypt((uchar*) data, (quint64) len);
+    hmacInner.update((const uchar*) data, (quint64) len);
+}
+
+void ZipAesCipher::decrypt(char* data, qint64 len)
+{
+    if (len <= 0)
+        return;
+    hmacInner.update((const uchar*) data, (quint64) len);
+    crypt((uchar*) data, (quint64) len);
+}
+
+void ZipAesCipher::authenticationCode(char* code)
+{
+    uchar mac[20];
+    hmacFinal(hmacInner, hmacOuter, mac);
+    memcpy(code, mac, ZIP_AES_AUTH_SIZE);
+}
+
+const char* ZipAesCipher::implementation()
+{
+    return engine().name;
+}
+
+OSDAB_END_NAMESPACE
@@ -0,0 +1,145 @@
+/****************************************************************************
+** Filename: zipaes_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** WinZip AES encryption (AE-1 and AE-2) for the Zip and UnZip classes.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPAES_P__H
+#define OSDAB_ZIPAES_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtGlobal>
+
+/*! #define OSDAB_ZIP_NO_AESNI to disable the AES-NI and SHA-NI implementations
+    on x86 CPUs and always use the portable (table based) AES and SHA-1.
+*/
+// #define OSDAB_ZIP_NO_AESNI
+
+// WinZip AES format (see http://www.winzip.com/aes_info.htm)
+#define ZIP_METHOD_AES 99
+#define ZIP_AES_VERSION 51
+#define ZIP_AES_EXTRA_ID 0x9901
+//! Size of the AES extra field, including the 4 bytes field header
+#define ZIP_AES_EXTRA_SIZE 11
+//! Password verification value size
+#define ZIP_AES_PWV_SIZE 2
+//! Authentication code size
+#define ZIP_AES_AUTH_SIZE 10
+#define ZIP_AES_MAX_SALT_SIZE 16
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+//! SHA-1 (FIPS 180-4) message digest, used by HMAC-SHA1 and PBKDF2.
+class ZipSha1
+{
+public:
+    ZipSha1() { reset(); }
+
+    void reset();
+    void update(const uchar* data, quint64 len);
+    void final(uchar digest[20]);
+
+private:
+    quint32 h[5];
+    uchar block[64];
+    quint32 used;
+    quint64 length;
+};
+
+/*!
+    AES in WinZip's CTR mode with HMAC-SHA1 authentication.
+    Keys are derived from the password with PBKDF2-HMAC-SHA1 (1000 iterations).
+    The CTR keystream uses AES-NI and HMAC-SHA1 the SHA extensions when the
+    CPU supports them (selected once at run time).
+*/
+class ZipAesCipher
+{
+public:
+    //! Key strength as stored in the AES extra field.
+    enum Strength
+    {
+        Aes128 = 1,
+        Aes192 = 2,
+        Aes256 = 3
+    };
+
+    ZipAesCipher();
+
+    //! Returns the salt size for \p strength or 0 if \p strength is not valid.
+    static int saltSize(int strength);
+    /*! Fills \p salt with \p size bytes from the system cryptographic random
+        generator. Returns false if none is available.
+    */
+    static bool randomSalt(char* salt, int size);
+
+    /*! Derives the keys from \p password and \p salt and stores the password
+        verification value (ZIP_AES_PWV_SIZE bytes) in \p verifier.
+        Returns false if \p strength is not valid.
+    */
+    bool init(const QByteArray& password, const char* salt, int strength, char* verifier);
+
+    //! Encrypts \p len bytes in place and adds the result to the authentication code.
+    void encrypt(char* data, qint64 len);
+    //! Adds \p len encrypted bytes to the authentication code and decrypts them in place.
+    void decrypt(char* data, qint64 len);
+
+    //! Writes the authentication code (ZIP_AES_AUTH_SIZE bytes) of the data processed so far.
+    void authenticationCode(char* code);
+
+    //! Name of the selected AES implementation (for diagnostics only).
+    static const char* implementation();
+
+private:
+    void crypt(uchar* data, quint64 len);
+
+    uchar roundKeys[15 * 16];
+    quint32 roundKeyWords[15 * 4];
+    int rounds;
+
+    quint64 counter;
+    uchar keystream[16];
+    int keystreamPos;
+
+    ZipSha1 hmacInner;
+    ZipSha1 hmacOuter;
+
+    Q_DISABLE_COPY(ZipAesCipher)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPAES_P__H
@@ -0,0 +1,140 @@
+/****************************************************************************
+** Filename: zipblockcache.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Read-ahead block cache used by the UnZip class on slow devices.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zipblockcache_p.h"
+
+#include <string.h>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+ZipBlockCache::ZipBlockCache(QIODevice* source, int size, int maxBlocks) :
+    dev(source),
+    blocks(qMax(2, maxBlocks)),
+    length(source->size()),
+    offset(0),
+    blockSize(qMax(512, size)),
+    lastBlock(-2),
+    readAhead(1),
+    hitCount(0),
+    missCount(0),
+    fetchCount(0)
+{
+    Q_ASSERT(dev);
+}
+
+bool ZipBlockCache::isSequential() const
+{
+    return false;
+}
+
+qint64 ZipBlockCache::size() const
+{
+    return length;
+}
+
+bool ZipBlockCache::seek(qint64 pos)
+{
+    if (pos < 0 || pos > length || !QIODevice::seek(pos))
+        return false;
+    offset = pos;
+    return true;
+}
+
+qint64 ZipBlockCache::readData(char* data, qint64 maxlen)
+{
+    maxlen = qMin(maxlen, length - offset);
+
+    qint64 done = 0;
+    while (done < maxlen) {
+        const qint64 block = offset / blockSize;
+        const QByteArray* buffer = blocks.object(block);
+        if (buffer) {
+            ++hitCount;
+        } else {
+            ++missCount;
+            buffer = fetch(block);
+            if (!buffer)
+                return done ? done : -1;
+        }
+        lastBlock = block;
+
+        const int start = int(offset - block * blockSize);
+        const qint64 n = qMin<qint64>(buffer->size() - start, maxlen - done);
+        if (n <= 0)
+            break;
+
+        memcpy(data + done, buffer->constData() + start, n);
+        done += n;
+        offset += n;
+    }
+
+    return done;
+}
+
+qint64 ZipBlockCache::writeData(const char* data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
+
+//! Reads \p block and the following blocks if reads are sequential. Returns \p block or 0.
+const QByteArray* ZipBlockCache::fetch(qint64 block)
+{
+    // The cache must hold the whole run
+    if (block == lastBlock + 1)
+        readAhead = qMin(readAhead * 2, blocks.maxCost() / 2);
+    else readAhead = 1;
+
+    const qint64 start = block * blockSize;
+    int count = 1;
+    while (count < readAhead && start + qint64(count) * blockSize < length
+        && !blocks.contains(block + count))
+        ++count;
+
+    const qint64 len = qMin<qint64>(qint64(count) * blockSize, length - start);
+    if (len <= 0 || !dev->seek(start))
+        return 0;
+
+    QByteArray run;
+    run.resize(int(len));
+    const qint64 read = dev->read(run.data(), len);
+    ++fetchCount;
+    if (read <= 0)
+        return 0;
+
+    // The requested block is inserted last, as the most recently used one
+    for (int i = int((read - 1) / blockSize); i >= 0; --i) {
+        const qint64 begin = qint64(i) * blockSize;
+        blocks.insert(block + i, new QByteArray(run.constData() + begin,
+            int(qMin<qint64>(blockSize, read - begin))));
+    }
+
+    return blocks.object(block);
+}
+
+OSDAB_END_NAMESPACE
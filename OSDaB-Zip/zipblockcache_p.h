@@ -0,0 +1,103 @@
+/****************************************************************************
+** Filename: zipblockcache_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Read-ahead block cache used by the UnZip class on slow devices.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPBLOCKCACHE_P__H
+#define OSDAB_ZIPBLOCKCACHE_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCache>
+#include <QtCore/QIODevice>
+#include <QtCore/QtGlobal>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/*!
+    Read only, random access device reading another device in fixed size
+    blocks and keeping the most recently used blocks in memory. Misses that
+    follow the previous block are read ahead in a single request, doubling
+    the number of blocks up to half of the cache, so small reads at scattered
+    offsets and sequential reads both turn into a few large reads of the
+    source device.
+    The source device is not owned and must stay open.
+*/
+class ZipBlockCache : public QIODevice
+{
+public:
+    ZipBlockCache(QIODevice* source, int blockSize, int maxBlocks);
+
+    inline QIODevice* source() const { return dev; }
+
+    bool isSequential() const;
+    qint64 size() const;
+    bool seek(qint64 pos);
+
+    //! Block lookups served from memory.
+    inline qint64 hits() const { return hitCount; }
+    //! Block lookups that needed a read of the source device.
+    inline qint64 misses() const { return missCount; }
+    //! Reads of the source device.
+    inline qint64 fetches() const { return fetchCount; }
+
+protected:
+    qint64 readData(char* data, qint64 maxlen);
+    qint64 writeData(const char* data, qint64 len);
+
+private:
+    const QByteArray* fetch(qint64 block);
+
+    QIODevice* dev;
+    QCache<qint64, QByteArray> blocks;
+    qint64 length;
+    qint64 offset;
+    int blockSize;
+    // Block read by the previous readData() call
+    qint64 lastBlock;
+    int readAhead;
+
+    qint64 hitCount;
+    qint64 missCount;
+    qint64 fetchCount;
+
+    Q_DISABLE_COPY(ZipBlockCache)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPBLOCKCACHE_P__H
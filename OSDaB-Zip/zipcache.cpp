@@ -0,0 +1,183 @@
+/****************************************************************************
+** Filename: zipcache.cpp
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Memory cache of decompressed entries shared by UnZip objects.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+
+#include "zipcache.h"
+
+#include <QtCore/QCache>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QString>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+//! \internal
+class ZipEntryCachePrivate
+{
+public:
+    ZipEntryCachePrivate() : hits(0), misses(0) {}
+
+    mutable QMutex mutex;
+    // The cost of an entry is its size in bytes
+    QCache<QString, QByteArray> entries;
+    qint64 hits;
+    qint64 misses;
+};
+
+/*! \class ZipEntryCache zipcache.h
+
+ Keeps the decompressed data of recently extracted entries in memory, up to
+ a byte budget, evicting the least recently used entries first. Attach it to
+ one or more UnZip objects with UnZip::setEntryCache(): entries extracted to
+ a device or to a QByteArray are then decompressed only once. Cached data is
+ implicitly shared, so a hit costs no copy.
+ Keys are built by UnZip from the archive identity (path, size, modification
+ time and central directory offset for files, a number unique to the open
+ archive for other devices) and the entry name. The entries of archives
+ opened from devices other than files are removed when they are closed.
+ The cache is thread-safe and can be shared by UnZip objects used by
+ different threads.
+*/
+
+/*!
+ Creates a cache for up to \p maxBytes bytes of data (32MB by default).
+*/
+ZipEntryCache::ZipEntryCache(qint64 maxBytes) :
+    d(new ZipEntryCachePrivate)
+{
+    setMaxBytes(maxBytes);
+}
+
+ZipEntryCache::~ZipEntryCache()
+{
+    delete d;
+}
+
+/*!
+ Sets the byte budget (at most 2GB), evicting entries if needed.
+*/
+void ZipEntryCache::setMaxBytes(qint64 bytes)
+{
+    QMutexLocker locker(&d->mutex);
+    d->entries.setMaxCost(int(qBound<qint64>(0, bytes, 0x7fffffff)));
+}
+
+qint64 ZipEntryCache::maxBytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->entries.maxCost();
+}
+
+//! Returns the size of the cached data.
+qint64 ZipEntryCache::bytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->entries.totalCost();
+}
+
+//! Returns the number of cached entries.
+int ZipEntryCache::count() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->entries.count();
+}
+
+//! Removes all the entries and resets the counters.
+void ZipEntryCache::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->entries.clear();
+    d->hits = d->misses = 0;
+}
+
+qint64 ZipEntryCache::hits() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->hits;
+}
+
+qint64 ZipEntryCache::misses() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->misses;
+}
+
+//! Returns hits divided by lookups, 0 if nothing has been looked up yet.
+double ZipEntryCache::hitRatio() const
+{
+    QMutexLocker locker(&d->mutex);
+    const qint64 lookups = d->hits + d->misses;
+    return lookups > 0 ? double(d->hits) / lookups : 0;
+}
+
+/*!
+ Sets \p data to a shared copy of the cached data for \p key and marks it as
+ the most recently used entry. Returns false if \p key is not cached.
+*/
+bool ZipEntryCache::find(const QString& key, QByteArray* data)
+{
+    Q_ASSERT(data);
+
+    QMutexLocker locker(&d->mutex);
+    const QByteArray* cached = d->entries.object(key);
+    if (!cached) {
+        ++d->misses;
+        return false;
+    }
+
+    ++d->hits;
+    *data = *cached;
+    return true;
+}
+
+/*!
+ Caches \p data for \p key. Data larger than the budget is not cached.
+*/
+void ZipEntryCache::insert(const QString& key, const QByteArray& data)
+{
+    QMutexLocker locker(&d->mutex);
+    if (data.size() <= d->entries.maxCost())
+        d->entries.insert(key, new QByteArray(data), data.size());
+}
+
+/*!
+ Removes the entries whose key starts with \p prefix and returns their number.
+*/
+int ZipEntryCache::removeByPrefix(const QString& prefix)
+{
+    QMutexLocker locker(&d->mutex);
+    int removed = 0;
+    const QList<QString> keys = d->entries.keys();
+    for (int i = 0; i < keys.size(); ++i) {
+        if (keys.at(i).startsWith(prefix) && d->entries.remove(keys.at(i)))
+            ++removed;
+    }
+    return removed;
+}
+
+OSDAB_END_NAMESPACE
@@ -0,0 +1,71 @@
+/****************************************************************************
+** Filename: zipcache.h
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Memory cache of decompressed entries shared by UnZip objects.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+
+#ifndef OSDAB_ZIPCACHE__H
+#define OSDAB_ZIPCACHE__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtGlobal>
+
+class QString;
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+class ZipEntryCachePrivate;
+
+class OSDAB_ZIP_EXPORT ZipEntryCache
+{
+public:
+    explicit ZipEntryCache(qint64 maxBytes = 32 * 1024 * 1024);
+    ~ZipEntryCache();
+
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+    qint64 bytes() const;
+    int count() const;
+    void clear();
+
+    qint64 hits() const;
+    qint64 misses() const;
+    double hitRatio() const;
+
+    bool find(const QString& key, QByteArray* data);
+    void insert(const QString& key, const QByteArray& data);
+    int removeByPrefix(const QString& prefix);
+
+private:
+    ZipEntryCachePrivate* d;
+
+    Q_DISABLE_COPY(ZipEntryCache)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPCACHE__H
@@ -0,0 +1,647 @@
+/****************************************************************************
+** Filename: zipcodec.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Compression method (codec) abstraction for the Zip and UnZip classes.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zipcodec_p.h"
+
+#include <string.h>
+
+#ifdef OSDAB_ZIP_ZLIB_NG
+#include <zlib-ng.h>
+#else
+#include <zlib/zlib.h>
+#endif
+
+#ifdef OSDAB_ZIP_LIBDEFLATE
+#include <QtCore/QThreadStorage>
+#include <libdeflate.h>
+#endif
+
+#ifdef OSDAB_ZIP_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef OSDAB_ZIP_LZMA
+#include <stdlib.h>
+#include <lzma.h>
+#endif
+
+//! PKZip version needed to extract stored and deflated entries (2.0)
+#define ZIP_CODEC_VERSION_DEFLATE 0x14
+//! PKZip version needed to extract LZMA and Zstandard entries (6.3)
+#define ZIP_CODEC_VERSION_63 0x3F
+
+// zlib and zlib-ng (native API) only differ in the z_ prefix
+#ifdef OSDAB_ZIP_ZLIB_NG
+typedef zng_stream zip_z_stream;
+#define ZIP_Z(f) zng_##f
+#else
+typedef z_stream zip_z_stream;
+#define ZIP_Z(f) f
+#endif
+
+//! LZMA properties header: 2 bytes version, 2 bytes props size, 5 bytes props
+#define ZIP_LZMA_PROPS_SIZE 5
+#define ZIP_LZMA_HEADER_SIZE (4 + ZIP_LZMA_PROPS_SIZE)
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+namespace {
+
+/************************************************************************
+ Store
+*************************************************************************/
+
+class StoreStream : public ZipCodecStream
+{
+public:
+    Result process(bool finish)
+    {
+        const quint32 n = qMin(availIn, availOut);
+        memcpy(nextOut, nextIn, n);
+        nextIn += n;
+        availIn -= n;
+        nextOut += n;
+        availOut -= n;
+        return (finish && availIn == 0) ? StreamEnd : Ok;
+    }
+
+    ZipCodecStream* clone() const { return new StoreStream; }
+
+    bool reset() { return true; }
+};
+
+class StoreCodec : public ZipCodec
+{
+public:
+    quint16 method() const { return ZIP_METHOD_STORED; }
+    quint8 versionNeeded() const { return ZIP_CODEC_VERSION_DEFLATE; }
+    Capabilities capabilities() const { return CanCompress | CanDecompress; }
+
+    ZipCodecStream* createCompressor(int, const ZipCodecParameters&) const { return new StoreStream; }
+    ZipCodecStream* createDecompressor() const { return new StoreStream; }
+};
+
+
+/************************************************************************
+ Deflate
+*************************************************************************/
+
+#ifdef OSDAB_ZIP_LIBDEFLATE
+/*!
+    libdeflate compressors (one per level) and decompressor of the calling thread.
+    They are allocated on first use and reused for every entry, as allocating
+    them costs more than (de)compressing a small entry.
+*/
+class LibdeflateContext
+{
+public:
+    LibdeflateContext() : d(0)
+    {
+        memset(c, 0, sizeof(c));
+    }
+
+    ~LibdeflateContext()
+    {
+        for (int i = 0; i < MaxLevel + 1; ++i)
+            if (c[i])
+                libdeflate_free_compressor(c[i]);
+        if (d)
+            libdeflate_free_decompressor(d);
+    }
+
+    static LibdeflateContext* current()
+    {
+        static QThreadStorage<LibdeflateContext*> storage;
+        if (!storage.hasLocalData())
+            storage.setLocalData(new LibdeflateContext);
+        return storage.localData();
+    }
+
+    libdeflate_compressor* compressor(int level)
+    {
+        if (level < 0 || level > MaxLevel)
+            return 0;
+        if (!c[level])
+            c[level] = libdeflate_alloc_compressor(level);
+        return c[level];
+    }
+
+    libdeflate_decompressor* decompressor()
+    {
+        if (!d)
+            d = libdeflate_alloc_decompressor();
+        return d;
+    }
+
+private:
+    enum { MaxLevel = 12 };
+    libdeflate_compressor* c[MaxLevel + 1];
+    libdeflate_decompressor* d;
+};
+#endif
+
+class DeflateStream : public ZipCodecStream
+{
+public:
+    DeflateStream(bool compress) : compress(compress), initialized(false), level(0)
+#ifdef OSDAB_ZIP_LIBDEFLATE
+        , oneShot(true), firstCall(true)
+#endif
+    {
+        // Initialize zalloc, zfree and opaque before calling the init function
+        zstr.zalloc = Z_NULL;
+        zstr.zfree = Z_NULL;
+        zstr.opaque = Z_NULL;
+        zstr.next_in = Z_NULL;
+        zstr.avail_in = 0;
+    }
+
+    ~DeflateStream()
+    {
+        if (!initialized)
+            return;
+        if (compress)
+            ZIP_Z(deflateEnd)(&zstr);
+        else ZIP_Z(inflateEnd)(&zstr);
+    }
+
+    bool init(int level, const ZipCodecParameters& params)
+    {
+        this->level = level;
+#ifdef OSDAB_ZIP_LIBDEFLATE
+        // libdeflate has no strategies and always uses a 32K window
+        oneShot = firstCall = params.isDefault();
+#endif
+
+        // Use negative windowBits to get raw (de)compression
+        const int zret = compress
+            ? ZIP_Z(deflateInit2)(&zstr, level, Z_DEFLATED, -params.windowBits,
+                params.memLevel, params.strategy)
+            : ZIP_Z(inflateInit2)(&zstr, -MAX_WBITS);
+        initialized = zret == Z_OK;
+        return initialized;
+    }
+
+    Result process(bool finish)
+    {
+#ifdef OSDAB_ZIP_LIBDEFLATE
+        // The whole entry is available: try the faster one-shot functions
+        // and fall back to the streaming code if the output doesn't fit.
+        if (firstCall) {
+            firstCall = false;
+            if (finish && processAll())
+                return StreamEnd;
+        }
+#endif
+
+        zstr.next_in = (unsigned char*) nextIn;
+        zstr.avail_in = (unsigned int) availIn;
+        zstr.next_out = (unsigned char*) nextOut;
+        zstr.avail_out = (unsigned int) availOut;
+
+        const int zret = compress
+            ? ZIP_Z(deflate)(&zstr, finish ? Z_FINISH : Z_NO_FLUSH)
+            : ZIP_Z(inflate)(&zstr, Z_NO_FLUSH);
+
+        nextIn = (const char*) zstr.next_in;
+        availIn = zstr.avail_in;
+        nextOut = (char*) zstr.next_out;
+        availOut = zstr.avail_out;
+
+        switch (zret) {
+        case Z_OK:
+        case Z_BUF_ERROR:
+            return Ok;
+        case Z_STREAM_END:
+            return StreamEnd;
+        case Z_MEM_ERROR:
+            return MemoryError;
+        default:
+            return DataError;
+        }
+    }
+
+    ZipCodecStream* clone() const
+    {
+        // Only decompressors are copied: the state is the bit buffer and the 32K window
+        if (compress || !initialized)
+            return 0;
+
+        DeflateStream* s = new DeflateStream(false);
+        if (ZIP_Z(inflateCopy)(&s->zstr, const_cast<zip_z_stream*>(&zstr)) != Z_OK) {
+            delete s;
+            return 0;
+        }
+        s->initialized = true;
+#ifdef OSDAB_ZIP_LIBDEFLATE
+        // The copy is in the middle of the stream
+        s->firstCall = false;
+#endif
+        return s;
+    }
+
+    bool reset()
+    {
+        if (!initialized)
+            return false;
+#ifdef OSDAB_ZIP_LIBDEFLATE
+        firstCall = oneShot;
+#endif
+        const int zret = compress ? ZIP_Z(deflateReset)(&zstr) : ZIP_Z(inflateReset)(&zstr);
+        return zret == Z_OK;
+    }
+
+private:
+#ifdef OSDAB_ZIP_LIBDEFLATE
+    bool processAll()
+    {
+        size_t inUsed = availIn;
+        size_t outUsed = 0;
+
+        if (compress) {
+            libdeflate_compressor* c = LibdeflateContext::current()->compressor(level);
+            if (!c)
+                return false;
+            outUsed = libdeflate_deflate_compress(c, nextIn, availIn, nextOut, availOut);
+            if (!outUsed)
+                return false;
+        } else {
+            libdeflate_decompressor* d = LibdeflateContext::current()->decompressor();
+            if (!d)
+                return false;
+            const libdeflate_result res = libdeflate_deflate_decompress_ex(d,
+                nextIn, availIn, nextOut, availOut, &inUsed, &outUsed);
+            if (res != LIBDEFLATE_SUCCESS)
+                return false;
+        }
+
+        nextIn += inUsed;
+        availIn -= (quint32) inUsed;
+        nextOut += outUsed;
+        availOut -= (quint32) outUsed;
+        return true;
+    }
+#endif
+
+    const bool compress;
+    bool initialized;
+    int level;
+#ifdef OSDAB_ZIP_LIBDEFLATE
+    // False if the parameters can't be honoured by libdeflate
+    bool oneShot;
+    bool firstCall;
+#endif
+    zip_z_stream zstr;
+};
+
+class DeflateCodec : public ZipCodec
+{
+public:
+    quint16 method() const { return ZIP_METHOD_DEFLATED; }
+    quint8 versionNeeded() const { return ZIP_CODEC_VERSION_DEFLATE; }
+    Capabilities capabilities() const { return CanCompress | CanDecompress; }
+
+    ZipCodecStream* createCompressor(int level, const ZipCodecParameters& params) const
+    {
+        DeflateStream* s = new DeflateStream(true);
+        if (!s->init(level, params)) {
+            delete s;
+            return 0;
+        }
+        return s;
+    }
+
+    ZipCodecStream* createDecompressor() const
+    {
+        DeflateStream* s = new DeflateStream(false);
+        if (!s->init(0, ZipCodecParameters())) {
+            delete s;
+            return 0;
+        }
+        return s;
+    }
+};
+
+
+/************************************************************************
+ Zstandard
+*************************************************************************/
+
+#ifdef OSDAB_ZIP_ZSTD
+class ZstdStream : public ZipCodecStream
+{
+public:
+    ZstdStream() : cctx(0), dctx(0) {}
+
+    ~ZstdStream()
+    {
+        if (cctx)
+            ZSTD_freeCCtx(cctx);
+        if (dctx)
+            ZSTD_freeDCtx(dctx);
+    }
+
+    bool initCompressor(int level)
+    {
+        // Map the 1-9 Zip levels onto the (much wider) zstd range
+        static const int levels[9] = { 1, 2, 3, 5, 7, 9, 12, 15, 19 };
+        cctx = ZSTD_createCCtx();
+        if (!cctx)
+            return false;
+        const int zl = levels[qBound(1, level, 9) - 1];
+        return !ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, zl));
+    }
+
+    bool initDecompressor()
+    {
+        dctx = ZSTD_createDCtx();
+        return dctx != 0;
+    }
+
+    Result process(bool finish)
+    {
+        ZSTD_inBuffer in = { nextIn, availIn, 0 };
+        ZSTD_outBuffer out = { nextOut, availOut, 0 };
+
+        const size_t ret = cctx
+            ? ZSTD_compressStream2(cctx, &out, &in, finish ? ZSTD_e_end : ZSTD_e_continue)
+            : ZSTD_decompressStream(dctx, &out, &in);
+
+        nextIn += in.pos;
+        availIn -= (quint32) in.pos;
+        nextOut += out.pos;
+        availOut -= (quint32) out.pos;
+
+        if (ZSTD_isError(ret))
+            return DataError;
+        if (ret == 0 && (dctx || finish))
+            return StreamEnd;
+        return Ok;
+    }
+
+private:
+    ZSTD_CCtx* cctx;
+    ZSTD_DCtx* dctx;
+};
+
+class ZstdCodec : public ZipCodec
+{
+public:
+    quint16 method() const { return ZIP_METHOD_ZSTD; }
+    quint8 versionNeeded() const { return ZIP_CODEC_VERSION_63; }
+    Capabilities capabilities() const { return CanCompress | CanDecompress; }
+
+    ZipCodecStream* createCompressor(int level, const ZipCodecParameters&) const
+    {
+        ZstdStream* s = new ZstdStream;
+        if (!s->initCompressor(level)) {
+            delete s;
+            return 0;
+        }
+        return s;
+    }
+
+    ZipCodecStream* createDecompressor() const
+    {
+        ZstdStream* s = new ZstdStream;
+        if (!s->initDecompressor()) {
+            delete s;
+            return 0;
+        }
+        return s;
+    }
+};
+#endif // OSDAB_ZIP_ZSTD
+
+
+/************************************************************************
+ LZMA
+*************************************************************************/
+
+#ifdef OSDAB_ZIP_LZMA
+/*!
+    LZMA entries start with a small header: LZMA SDK version (2 bytes),
+    properties size (2 bytes) and the properties themselves, followed by
+    the raw LZMA1 stream. liblzma always writes an end of stream marker
+    for raw LZMA1 streams, hence the general purpose flag bit 1.
+*/
+class LzmaStream : public ZipCodecStream
+{
+public:
+    LzmaStream() : compress(false), headerPos(0), headerSize(0), initialized(false)
+    {
+        lzma_stream init = LZMA_STREAM_INIT;
+        strm = init;
+        memset(header, 0, sizeof(header));
+    }
+
+    ~LzmaStream()
+    {
+        if (initialized)
+            lzma_end(&strm);
+    }
+
+    bool initCompressor(int level)
+    {
+        compress = true;
+
+        lzma_options_lzma opt;
+        if (lzma_lzma_preset(&opt, (quint32) qBound(1, level, 9)))
+            return false;
+
+        lzma_filter filters[2];
+        filters[0].id = LZMA_FILTER_LZMA1;
+        filters[0].options = &opt;
+        filters[1].id = LZMA_VLI_UNKNOWN;
+        filters[1].options = 0;
+
+        quint32 propsSize = 0;
+        if (lzma_properties_size(&propsSize, &filters[0]) != LZMA_OK
+            || propsSize != ZIP_LZMA_PROPS_SIZE)
+            return false;
+
+        header[0] = LZMA_VERSION_MAJOR;
+        header[1] = LZMA_VERSION_MINOR;
+        header[2] = ZIP_LZMA_PROPS_SIZE;
+        header[3] = 0;
+        if (lzma_properties_encode(&filters[0], header + 4) != LZMA_OK)
+            return false;
+        headerSize = ZIP_LZMA_HEADER_SIZE;
+
+        initialized = lzma_raw_encoder(&strm, filters) == LZMA_OK;
+        return initialized;
+    }
+
+    bool initDecompressor()
+    {
+        compress = false;
+        headerSize = ZIP_LZMA_HEADER_SIZE;
+        return true;
+    }
+
+    Result process(bool finish)
+    {
+        if (compress) {
+            // Emit the properties header first
+            while (headerPos < headerSize && availOut) {
+                *nextOut++ = header[headerPos++];
+                --availOut;
+            }
+            if (headerPos < headerSize)
+                return Ok;
+        } else if (!initialized) {
+            // Collect the properties header (it might be split across reads)
+            while (headerPos < headerSize && availIn) {
+                header[headerPos++] = *nextIn++;
+                --availIn;
+            }
+            if (headerPos < headerSize)
+                return Ok;
+            if (!initDecoder())
+                return DataError;
+        }
+
+        strm.next_in = (const uint8_t*) nextIn;
+        strm.avail_in = availIn;
+        strm.next_out = (uint8_t*) nextOut;
+        strm.avail_out = availOut;
+
+        const lzma_ret ret = lzma_code(&strm, (compress && finish) ? LZMA_FINISH : LZMA_RUN);
+
+        nextIn = (const char*) strm.next_in;
+        availIn = (quint32) strm.avail_in;
+        nextOut = (char*) strm.next_out;
+        availOut = (quint32) strm.avail_out;
+
+        switch (ret) {
+        case LZMA_OK:
+        case LZMA_BUF_ERROR:
+            return Ok;
+        case LZMA_STREAM_END:
+            return StreamEnd;
+        case LZMA_MEM_ERROR:
+        case LZMA_MEMLIMIT_ERROR:
+            return MemoryError;
+        default:
+            return DataError;
+        }
+    }
+
+private:
+    bool initDecoder()
+    {
+        const quint16 propsSize = header[2] | (header[3] << 8);
+        if (propsSize != ZIP_LZMA_PROPS_SIZE)
+            return false;
+
+        lzma_filter filters[2];
+        filters[0].id = LZMA_FILTER_LZMA1;
+        filters[0].options = 0;
+        filters[1].id = LZMA_VLI_UNKNOWN;
+        filters[1].options = 0;
+
+        if (lzma_properties_decode(&filters[0], 0, header + 4, propsSize) != LZMA_OK)
+            return false;
+
+        initialized = lzma_raw_decoder(&strm, filters) == LZMA_OK;
+        free(filters[0].options);
+        return initialized;
+    }
+
+    bool compress;
+    quint8 header[ZIP_LZMA_HEADER_SIZE];
+    int headerPos;
+    int headerSize;
+    bool initialized;
+    lzma_stream strm;
+};
+
+class LzmaCodec : public ZipCodec
+{
+public:
+    quint16 method() const { return ZIP_METHOD_LZMA; }
+    quint8 versionNeeded() const { return ZIP_CODEC_VERSION_63; }
+    Capabilities capabilities() const { return CanCompress | CanDecompress; }
+    quint8 gpFlag() const { return 0x02; }
+
+    ZipCodecStream* createCompressor(int level, const ZipCodecParameters&) const
+    {
+        LzmaStream* s = new LzmaStream;
+        if (!s->initCompressor(level)) {
+            delete s;
+            return 0;
+        }
+        return s;
+    }
+
+    ZipCodecStream* createDecompressor() const
+    {
+        LzmaStream* s = new LzmaStream;
+        s->initDecompressor();
+        return s;
+    }
+};
+#endif // OSDAB_ZIP_LZMA
+
+StoreCodec storeCodec;
+DeflateCodec deflateCodec;
+#ifdef OSDAB_ZIP_ZSTD
+ZstdCodec zstdCodec;
+#endif
+#ifdef OSDAB_ZIP_LZMA
+LzmaCodec lzmaCodec;
+#endif
+
+} // namespace
+
+
+/************************************************************************
+ ZipCodec
+*************************************************************************/
+
+/*!
+    Returns the codec handling compression method \p method or 0 if the
+    method is not supported (or support has not been compiled in).
+*/
+const ZipCodec* ZipCodec::codecForMethod(quint16 method)
+{
+    switch (method) {
+    case ZIP_METHOD_STORED: return &storeCodec;
+    case ZIP_METHOD_DEFLATED: return &deflateCodec;
+#ifdef OSDAB_ZIP_ZSTD
+    case ZIP_METHOD_ZSTD: return &zstdCodec;
+#endif
+#ifdef OSDAB_ZIP_LZMA
+    case ZIP_METHOD_LZMA: return &lzmaCodec;
+#endif
+    default: ;
+    }
+
+    return 0;
+}
+
+OSDAB_END_NAMESPACE
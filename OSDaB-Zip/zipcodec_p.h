@@ -0,0 +1,166 @@
+/****************************************************************************
+** Filename: zipcodec_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Compression method (codec) abstraction for the Zip and UnZip classes.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPCODEC_P__H
+#define OSDAB_ZIPCODEC_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QtGlobal>
+
+/*! #define OSDAB_ZIP_ZSTD to enable the Zstandard codec (method 93, needs libzstd)
+    and OSDAB_ZIP_LZMA to enable the LZMA codec (method 14, needs liblzma).
+*/
+// #define OSDAB_ZIP_ZSTD
+// #define OSDAB_ZIP_LZMA
+
+/*! #define OSDAB_ZIP_ZLIB_NG to use the native zlib-ng API (needs libz-ng) instead
+    of zlib for deflate and OSDAB_ZIP_LIBDEFLATE to use libdeflate (needs
+    libdeflate) when a whole entry fits in the read buffer. Both libraries
+    select the best implementation for the current CPU at run time.
+*/
+// #define OSDAB_ZIP_ZLIB_NG
+// #define OSDAB_ZIP_LIBDEFLATE
+
+// Compression method identifiers (see the PKWARE APPNOTE, section 4.4.5)
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+#define ZIP_METHOD_LZMA 14
+#define ZIP_METHOD_ZSTD 93
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+//! Encoder tuning. Uses the zlib semantics and is ignored by codecs other than deflate.
+struct ZipCodecParameters
+{
+    int strategy;       // zlib strategy (Z_DEFAULT_STRATEGY, Z_FILTERED, Z_RLE...)
+    int memLevel;       // 1-9
+    int windowBits;     // 9-15
+
+    ZipCodecParameters() : strategy(0), memLevel(8), windowBits(15) {}
+
+    //! True if these are zlib's defaults (Z_DEFAULT_STRATEGY, 8 and MAX_WBITS).
+    inline bool isDefault() const { return !strategy && memLevel == 8 && windowBits == 15; }
+};
+
+/*!
+    A compression or decompression stream created by a ZipCodec.
+    Works much like a z_stream: set the input and output buffers and call
+    process() until the output buffer is no longer filled up.
+*/
+class ZipCodecStream
+{
+public:
+    enum Result
+    {
+        Ok,
+        StreamEnd,
+        DataError,
+        MemoryError
+    };
+
+    ZipCodecStream() : nextIn(0), availIn(0), nextOut(0), availOut(0) {}
+    virtual ~ZipCodecStream() {}
+
+    const char* nextIn;
+    quint32 availIn;
+    char* nextOut;
+    quint32 availOut;
+
+    /*! Consumes input and produces output. \p finish must be set once the
+        last chunk of input data has been set.
+        Returns StreamEnd once all the data has been flushed (compression)
+        or the end of the compressed stream has been reached (decompression).
+    */
+    virtual Result process(bool finish) = 0;
+
+    /*! Returns a new stream with a copy of the current state or 0 if the codec
+        can't copy its streams. The input and output buffers are not copied.
+        Used to seek in compressed entries without starting over.
+    */
+    virtual ZipCodecStream* clone() const { return 0; }
+
+    /*! Prepares the stream for a new entry with the same settings, keeping its
+        allocated state. Returns false if the codec can't reset its streams, in
+        which case a new stream must be created.
+    */
+    virtual bool reset() { return false; }
+
+private:
+    Q_DISABLE_COPY(ZipCodecStream)
+};
+
+/*!
+    Describes a compression method and creates the streams that actually
+    compress or decompress data. Codecs are stateless and shared.
+*/
+class ZipCodec
+{
+public:
+    enum Capability
+    {
+        CanCompress = 0x01,
+        CanDecompress = 0x02
+    };
+    Q_DECLARE_FLAGS(Capabilities, Capability)
+
+    virtual ~ZipCodec() {}
+
+    //! Method identifier as stored in the local and central directory headers.
+    virtual quint16 method() const = 0;
+    //! "version needed to extract" value for entries using this method.
+    virtual quint8 versionNeeded() const = 0;
+    virtual Capabilities capabilities() const = 0;
+    //! Bits to set in the low byte of the general purpose flag.
+    virtual quint8 gpFlag() const { return 0; }
+
+    /*! Returns a new compression stream or 0 on failure.
+        \p level is in the 1-9 range used by Zip::CompressionLevel.
+    */
+    virtual ZipCodecStream* createCompressor(int level, const ZipCodecParameters& params) const = 0;
+    //! Returns a new decompression stream or 0 on failure.
+    virtual ZipCodecStream* createDecompressor() const = 0;
+
+    static const ZipCodec* codecForMethod(quint16 method);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(ZipCodec::Capabilities)
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPCODEC_P__H
@@ -0,0 +1,334 @@
+/****************************************************************************
+** Filename: zipcrc32.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** CRC-32 (ISO 3309 / ITU-T V.42, as used by PKZip) for the Zip and UnZip classes.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zipcrc32_p.h"
+
+#if !defined(OSDAB_ZIP_NO_PCLMUL) \
+    && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) \
+    && (defined(__GNUC__) || defined(_MSC_VER))
+#define ZIP_CRC32_PCLMUL
+#endif
+
+#ifdef ZIP_CRC32_PCLMUL
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ZIP_CRC32_TARGET_PCLMUL
+#else
+#define ZIP_CRC32_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
+//! Reversed CRC-32 polynomial
+#define ZIP_CRC32_POLY 0xEDB88320UL
+
+//! Minimum buffer size for the PCLMULQDQ implementation
+#define ZIP_CRC32_PCLMUL_MIN 64
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+quint32 ZipCrc32::table[16][256];
+
+namespace {
+
+typedef quint32 (*Crc32Function)(quint32 crc, const uchar* buf, quint64 len);
+
+inline quint32 readULong(const uchar* p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+}
+
+/************************************************************************
+ Slice-by-16
+*************************************************************************/
+
+//! \internal \p crc is not pre/post conditioned
+quint32 crc32Slice16(quint32 crc, const uchar* buf, quint64 len)
+{
+    const quint32 (*t)[256] = ZipCrc32::table;
+
+    while (len >= 16) {
+        const quint32 a = crc ^ readULong(buf);
+        const quint32 b = readULong(buf + 4);
+        const quint32 c = readULong(buf + 8);
+        const quint32 d = readULong(buf + 12);
+
+        crc = t[15][a & 0xff] ^ t[14][(a >> 8) & 0xff] ^ t[13][(a >> 16) & 0xff] ^ t[12][a >> 24]
+            ^ t[11][b & 0xff] ^ t[10][(b >> 8) & 0xff] ^ t[9][(b >> 16) & 0xff] ^ t[8][b >> 24]
+            ^ t[7][c & 0xff] ^ t[6][(c >> 8) & 0xff] ^ t[5][(c >> 16) & 0xff] ^ t[4][c >> 24]
+            ^ t[3][d & 0xff] ^ t[2][(d >> 8) & 0xff] ^ t[1][(d >> 16) & 0xff] ^ t[0][d >> 24];
+
+        buf += 16;
+        len -= 16;
+    }
+
+    while (len--)
+        crc = t[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+
+    return crc;
+}
+
+/************************************************************************
+ PCLMULQDQ folding
+*************************************************************************/
+
+#ifdef ZIP_CRC32_PCLMUL
+
+/*!
+    \internal Folds four 128 bit lanes with carry-less multiplications and
+    reduces the result to 32 bits (Barrett reduction), as described in Intel's
+    "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+    \p len must be at least 64 and a multiple of 16; \p crc is not conditioned.
+*/
+ZIP_CRC32_TARGET_PCLMUL
+quint32 crc32FoldPclmul(quint32 crc, const uchar* buf, quint64 len)
+{
+    // Folding constants: x^(4*128+32), x^(4*128-32), x^(128+32), x^(128-32),
+    // x^64 and the Barrett constants (polynomial and mu)
+    const __m128i k1k2 = _mm_set_epi64x(Q_INT64_C(0x01c6e41596), Q_INT64_C(0x0154442bd4));
+    const __m128i k3k4 = _mm_set_epi64x(Q_INT64_C(0x00ccaa009e), Q_INT64_C(0x01751997d0));
+    const __m128i k5k0 = _mm_set_epi64x(0, Q_INT64_C(0x0163cd6124));
+    const __m128i poly = _mm_set_epi64x(Q_INT64_C(0x01f7011641), Q_INT64_C(0x01db710641));
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i*) (buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*) (buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*) (buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*) (buf + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+
+    buf += 64;
+    len -= 64;
+
+    // Fold 512 bits at a time
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*) (buf + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*) (buf + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*) (buf + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*) (buf + 0x30)));
+
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Fold the remaining 128 bit blocks
+    while (len >= 16) {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*) buf)), x5);
+
+        buf += 16;
+        len -= 16;
+    }
+
+    // Fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (quint32) _mm_extract_epi32(x1, 1);
+}
+
+//! \internal Uses PCLMULQDQ for the 16 byte aligned bulk and the tables for the rest.
+quint32 crc32Pclmul(quint32 crc, const uchar* buf, quint64 len)
+{
+    if (len >= ZIP_CRC32_PCLMUL_MIN) {
+        const quint64 bulk = len & ~Q_UINT64_C(15);
+        crc = crc32FoldPclmul(crc, buf, bulk);
+        buf += bulk;
+        len -= bulk;
+    }
+    return crc32Slice16(crc, buf, len);
+}
+
+//! \internal Returns true if the CPU supports PCLMULQDQ and SSE 4.1
+bool hasPclmul()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) && (info[2] & (1 << 19));
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+#endif // ZIP_CRC32_PCLMUL
+
+/************************************************************************
+ Initialization and dispatch
+*************************************************************************/
+
+struct Crc32Engine
+{
+    Crc32Function function;
+    const char* name;
+    //! Slice-by-16 tables (ZipCrc32::table)
+    const quint32 (*table)[256];
+    //! x^(2^n) mod p(x), used by combine()
+    quint32 x2n[32];
+
+    Crc32Engine();
+};
+
+//! \internal Multiplies \p a and \p b modulo the CRC polynomial (reflected).
+quint32 multModP(quint32 a, quint32 b)
+{
+    quint32 m = quint32(1) << 31;
+    quint32 p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ ZIP_CRC32_POLY : b >> 1;
+    }
+    return p;
+}
+
+Crc32Engine::Crc32Engine() : function(crc32Slice16), name("slice-by-16"), table(ZipCrc32::table)
+{
+    quint32 (*t)[256] = ZipCrc32::table;
+
+    for (quint32 i = 0; i < 256; ++i) {
+        quint32 c = i;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? (c >> 1) ^ ZIP_CRC32_POLY : c >> 1;
+        t[0][i] = c;
+    }
+    for (quint32 i = 0; i < 256; ++i) {
+        for (int k = 1; k < 16; ++k)
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+    }
+
+    // x^1 and its repeated squares
+    quint32 p = quint32(1) << 30;
+    x2n[0] = p;
+    for (int n = 1; n < 32; ++n)
+        x2n[n] = p = multModP(p, p);
+
+#ifdef ZIP_CRC32_PCLMUL
+    if (hasPclmul()) {
+        function = crc32Pclmul;
+        name = "pclmul";
+    }
+#endif
+}
+
+//! \internal Tables are built and the implementation is selected on first use.
+const Crc32Engine& engine()
+{
+    static const Crc32Engine e;
+    return e;
+}
+
+} // namespace
+
+
+/************************************************************************
+ ZipCrc32
+*************************************************************************/
+
+quint32 ZipCrc32::update(quint32 crc, const char* data, qint64 len)
+{
+    if (!data || len <= 0)
+        return crc;
+    return ~engine().function(~crc, (const uchar*) data, (quint64) len);
+}
+
+quint32 ZipCrc32::combine(quint32 crc1, quint32 crc2, qint64 len2)
+{
+    if (len2 <= 0)
+        return crc1;
+
+    // crc1 * x^(8 * len2) mod p(x), xor crc2
+    quint32 p = quint32(1) << 31;
+    quint64 n = (quint64) len2;
+    int k = 3;
+    while (n) {
+        if (n & 1)
+            p = multModP(engine().x2n[k & 31], p);
+        n >>= 1;
+        ++k;
+    }
+    return multModP(p, crc1) ^ crc2;
+}
+
+quint32 ZipCrc32::updateByte(quint32 crc, int c)
+{
+    const quint32 (*t)[256] = engine().table;
+    return t[0][(crc ^ c) & 0xff] ^ (crc >> 8);
+}
+
+const char* ZipCrc32::implementation()
+{
+    return engine().name;
+}
+
+OSDAB_END_NAMESPACE
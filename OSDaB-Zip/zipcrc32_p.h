@@ -0,0 +1,84 @@
+/****************************************************************************
+** Filename: zipcrc32_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** CRC-32 (ISO 3309 / ITU-T V.42, as used by PKZip) for the Zip and UnZip classes.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPCRC32_P__H
+#define OSDAB_ZIPCRC32_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QtGlobal>
+
+/*! #define OSDAB_ZIP_NO_PCLMUL to disable the PCLMULQDQ (carry-less multiplication)
+    implementation on x86 CPUs and always use the slice-by-16 tables.
+*/
+// #define OSDAB_ZIP_NO_PCLMUL
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/*!
+    CRC-32 engine shared by Zip and UnZip.
+    The fastest implementation available on the current CPU is selected
+    once at run time (PCLMULQDQ folding or slice-by-16 tables).
+*/
+class ZipCrc32
+{
+public:
+    /*! Updates a running crc with \p len bytes. Start with a crc of 0.
+        Same semantics as zlib's crc32().
+    */
+    static quint32 update(quint32 crc, const char* data, qint64 len);
+
+    /*! Returns the crc of two concatenated blocks given the crc of each block
+        and the length of the second one. Same semantics as zlib's crc32_combine().
+    */
+    static quint32 combine(quint32 crc1, quint32 crc2, qint64 len2);
+
+    //! Name of the selected implementation (for diagnostics only).
+    static const char* implementation();
+
+    /*! Updates a one-char-only, non conditioned crc; it's the Info-Zip macro
+        used by the traditional PKWARE encryption.
+    */
+    static quint32 updateByte(quint32 crc, int c);
+
+    static quint32 table[16][256];
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPCRC32_P__H
@@ -52,6 +52,8 @@ public:
         dataOffset(0),
         gpFlag(),
         compMethod(0),
+        aesStrength(0),
+        aesVersion(0),
         modTime(),
         modDate(),
         crc(0),
@@ -69,7 +71,9 @@ public:
 	quint32 lhOffset;			// Offset of the local header record for this entry
 	mutable quint32 dataOffset;	// Offset of the file data for this entry
 	unsigned char gpFlag[2];	// General purpose flag
-	quint16 compMethod;			// Compression method
+	quint16 compMethod;			// Compression method (the actual one for AES encrypted entries)
+	quint8 aesStrength;			// WinZip AES key strength (0 if not AES encrypted)
+	quint16 aesVersion;			// WinZip AES vendor version (AE-1 or AE-2)
 	unsigned char modTime[2];	// Last modified time
 	unsigned char modDate[2];	// Last modified date
 	quint32 crc;				// CRC32
@@ -84,6 +88,7 @@ public:
 
 	inline bool isEncrypted() const { return gpFlag[0] & 0x01; }
 	inline bool hasDataDescriptor() const { return gpFlag[0] & 0x08; }
+	inline bool isAesEncrypted() const { return aesStrength != 0; }
 };
 
 OSDAB_END_NAMESPACE
@@ -0,0 +1,289 @@
+/****************************************************************************
+** Filename: zipentrydevice.cpp
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Random access device reading an archive entry for the UnZip class.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+
+#include "zipentrydevice_p.h"
+#include "zipcodec_p.h"
+#include "zipcrc32_p.h"
+
+#include <QtCore/QFile>
+
+#include <string.h>
+
+//! Size of the compressed data read from the source device at a time
+#define ZIP_ENTRY_BUFFER (64*1024)
+//! Minimum output between two checkpoints of the seek index
+#define ZIP_ENTRY_SPAN (1024*1024)
+//! Larger entries have a larger span (a checkpoint costs about 40K)
+#define ZIP_ENTRY_MAX_CHECKPOINTS 256
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+ZipEntryDevice::ZipEntryDevice(QIODevice* source, const ZipEntryDeviceInfo& i, QObject* parent) :
+    QIODevice(parent),
+    dev(source),
+    info(i),
+    map(0),
+    offset(0),
+    crc(0),
+    crcValid(true),
+    stream(0),
+    consumed(0),
+    streamEnd(false),
+    span(qMax<qint64>(ZIP_ENTRY_SPAN, i.szUncomp / ZIP_ENTRY_MAX_CHECKPOINTS)),
+    nextCheckpoint(0)
+{
+    Q_ASSERT(dev);
+}
+
+ZipEntryDevice::~ZipEntryDevice()
+{
+    close();
+}
+
+bool ZipEntryDevice::open(OpenMode mode)
+{
+    if (mode & WriteOnly) {
+        setErrorString(QLatin1String("Archive entries are read only"));
+        return false;
+    }
+
+    if (info.method == ZIP_METHOD_STORED) {
+#if QT_VERSION >= 0x040400
+        // Stored entries are served straight from the archive
+        QFile* file = qobject_cast<QFile*>(dev);
+        if (file && info.szUncomp > 0)
+            map = file->map(info.dataOffset, info.szUncomp);
+#endif
+    } else if (!restart(0)) {
+        setErrorString(QLatin1String("Unable to read the entry"));
+        return false;
+    }
+
+    offset = 0;
+    crc = 0;
+    crcValid = true;
+    return QIODevice::open(mode);
+}
+
+void ZipEntryDevice::close()
+{
+    if (isOpen())
+        QIODevice::close();
+
+    delete stream;
+    stream = 0;
+    clearIndex();
+    input.clear();
+
+#if QT_VERSION >= 0x040400
+    if (map)
+        static_cast<QFile*>(dev)->unmap(map);
+#endif
+    map = 0;
+}
+
+bool ZipEntryDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 ZipEntryDevice::size() const
+{
+    return info.szUncomp;
+}
+
+bool ZipEntryDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > info.szUncomp || !QIODevice::seek(pos))
+        return false;
+    if (pos == offset)
+        return true;
+
+    // Only reads from the beginning of the entry are checked
+    crc = 0;
+    crcValid = !pos;
+    if (!stream) {
+        offset = pos;
+        return true;
+    }
+
+    // Nearest checkpoint before pos; the index is sorted by output offset
+    const Checkpoint* checkpoint = 0;
+    for (int i = 0; i < index.size() && index.at(i).out <= pos; ++i)
+        checkpoint = &index.at(i);
+
+    if (pos < offset || (checkpoint && checkpoint->out > offset)) {
+        if (!restart(checkpoint))
+            return false;
+    }
+
+    char skip[16 * 1024];
+    while (offset < pos) {
+        const qint64 n = inflate(skip, qMin<qint64>(sizeof(skip), pos - offset));
+        if (n <= 0)
+            return false;
+        offset += n;
+    }
+    return true;
+}
+
+qint64 ZipEntryDevice::readData(char* data, qint64 maxlen)
+{
+    maxlen = qMin(maxlen, info.szUncomp - offset);
+    if (maxlen <= 0)
+        return 0;
+
+    qint64 n = -1;
+    if (stream) {
+        n = inflate(data, maxlen);
+    } else if (map) {
+        memcpy(data, map + offset, maxlen);
+        n = maxlen;
+    } else if (dev->seek(info.dataOffset + offset)) {
+        n = dev->read(data, maxlen);
+    }
+
+    if (n <= 0) {
+        setErrorString(QLatin1String("Corrupted or truncated entry"));
+        return -1;
+    }
+
+    if (crcValid)
+        crc = ZipCrc32::update(crc, data, n);
+    offset += n;
+
+    if (crcValid && offset == info.szUncomp && crc != info.crc) {
+        setErrorString(QLatin1String("CRC mismatch"));
+        return -1;
+    }
+    return n;
+}
+
+qint64 ZipEntryDevice::writeData(const char* data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
+
+//! Restarts decompressing from \p checkpoint or from the beginning of the entry if it is 0.
+bool ZipEntryDevice::restart(const Checkpoint* checkpoint)
+{
+    delete stream;
+    if (checkpoint) {
+        stream = checkpoint->state->clone();
+        consumed = checkpoint->in;
+        offset = checkpoint->out;
+    } else {
+        const ZipCodec* codec = ZipCodec::codecForMethod(info.method);
+        stream = codec ? codec->createDecompressor() : 0;
+        consumed = 0;
+        offset = 0;
+    }
+    streamEnd = false;
+
+    // Checkpoints are only added past the end of the index
+    nextCheckpoint = (index.isEmpty() ? 0 : index.last().out) + span;
+
+    if (input.isEmpty())
+        input.resize(ZIP_ENTRY_BUFFER);
+    return stream;
+}
+
+//! Adds the current state of the decompressor to the seek index.
+void ZipEntryDevice::addCheckpoint()
+{
+    Checkpoint checkpoint;
+    checkpoint.state = stream->clone();
+    if (!checkpoint.state) {
+        // The codec can't copy its streams
+        nextCheckpoint = Q_INT64_C(0x7fffffffffffffff);
+        return;
+    }
+
+    // Input bytes still in the buffer have not been used yet
+    checkpoint.in = consumed - stream->availIn;
+    checkpoint.out = offset;
+    index.append(checkpoint);
+    nextCheckpoint = offset + span;
+}
+
+//! Decompresses up to \p maxlen bytes, reading the compressed data as needed.
+qint64 ZipEntryDevice::inflate(char* data, qint64 maxlen)
+{
+    Q_ASSERT(stream);
+
+    const qint64 start = offset;
+    qint64 done = 0;
+    while (done < maxlen && !streamEnd) {
+        // offset is only updated by the caller
+        offset = start + done;
+        if (offset >= nextCheckpoint)
+            addCheckpoint();
+
+        if (stream->availIn == 0 && consumed < info.szComp) {
+            if (!dev->seek(info.dataOffset + consumed))
+                break;
+            const qint64 read = dev->read(input.data(), qMin<qint64>(input.size(), info.szComp - consumed));
+            if (read <= 0)
+                break;
+            consumed += read;
+            stream->nextIn = input.constData();
+            stream->availIn = quint32(read);
+        }
+
+        // Stops at the next checkpoint
+        const quint32 chunk = quint32(qMin<qint64>(qMin(maxlen - done, nextCheckpoint - offset), 0x7fffffff));
+        stream->nextOut = data + done;
+        stream->availOut = chunk;
+
+        const quint32 availIn = stream->availIn;
+        const ZipCodecStream::Result result = stream->process(consumed == info.szComp);
+        const quint32 produced = chunk - stream->availOut;
+        done += produced;
+
+        if (result == ZipCodecStream::DataError || result == ZipCodecStream::MemoryError)
+            break;
+        if (result == ZipCodecStream::StreamEnd)
+            streamEnd = true;
+        else if (stream->availIn == availIn && !produced && consumed == info.szComp)
+            break; // Truncated stream
+    }
+
+    offset = start;
+    return done ? done : -1;
+}
+
+void ZipEntryDevice::clearIndex()
+{
+    for (int i = 0; i < index.size(); ++i)
+        delete index.at(i).state;
+    index.clear();
+}
+
+OSDAB_END_NAMESPACE
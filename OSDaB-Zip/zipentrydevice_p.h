@@ -0,0 +1,142 @@
+/****************************************************************************
+** Filename: zipentrydevice_p.h
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Random access device reading an archive entry for the UnZip class.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPENTRYDEVICE_P__H
+#define OSDAB_ZIPENTRYDEVICE_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QList>
+#include <QtCore/QtGlobal>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+class ZipCodecStream;
+
+//! Location of the entry data in the archive.
+struct ZipEntryDeviceInfo
+{
+    qint64 dataOffset;
+    qint64 szComp;
+    qint64 szUncomp;
+    quint16 method;
+    quint32 crc;
+
+    ZipEntryDeviceInfo() : dataOffset(0), szComp(0), szUncomp(0), method(0), crc(0) {}
+};
+
+/*!
+    Read only, random access device over the data of an unencrypted archive
+    entry, so that an archive stored in another archive can be opened by
+    UnZip without extracting it.
+
+    Stored entries are a bounded view of the source device (memory mapped
+    if the source is a file). Compressed entries are decompressed while they
+    are read; every span of output bytes a copy of the decompressor state is
+    kept in a seek index, so seeking back restarts from the nearest
+    checkpoint instead of from the beginning of the entry. Codecs that can't
+    copy their streams always restart from the beginning.
+
+    The source device is read with positional reads (seek + read), so it can
+    be shared with the UnZip object that created this device; a source
+    parented to this device is deleted with it.
+    The CRC is checked when the whole entry is read sequentially.
+*/
+class ZipEntryDevice : public QIODevice
+{
+public:
+    ZipEntryDevice(QIODevice* source, const ZipEntryDeviceInfo& info, QObject* parent = 0);
+    ~ZipEntryDevice();
+
+    bool open(OpenMode mode);
+    void close();
+
+    bool isSequential() const;
+    qint64 size() const;
+    bool seek(qint64 pos);
+
+    //! Checkpoints in the seek index of a compressed entry.
+    inline int checkpoints() const { return index.size(); }
+    //! Mapping of a stored entry of a file, 0 if the entry is not mapped.
+    inline uchar* mappedData() const { return map; }
+
+protected:
+    qint64 readData(char* data, qint64 maxlen);
+    qint64 writeData(const char* data, qint64 len);
+
+private:
+    //! Decompressor state after \a in bytes of input and \a out bytes of output.
+    struct Checkpoint
+    {
+        qint64 in;
+        qint64 out;
+        ZipCodecStream* state;
+    };
+
+    bool restart(const Checkpoint* checkpoint);
+    void addCheckpoint();
+    qint64 inflate(char* data, qint64 maxlen);
+    void clearIndex();
+
+    QIODevice* dev;
+    const ZipEntryDeviceInfo info;
+    uchar* map;
+
+    // Position in the entry
+    qint64 offset;
+    quint32 crc;
+    bool crcValid;
+
+    // Decompression state: offset is also the number of bytes produced by stream
+    ZipCodecStream* stream;
+    QByteArray input;
+    qint64 consumed;
+    bool streamEnd;
+
+    QList<Checkpoint> index;
+    qint64 span;
+    qint64 nextCheckpoint;
+
+    Q_DISABLE_COPY(ZipEntryDevice)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPENTRYDEVICE_P__H
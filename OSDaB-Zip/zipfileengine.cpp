@@ -0,0 +1,557 @@
+/****************************************************************************
+** Filename: zipfileengine.cpp
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Qt file engine giving access to the entries of zip archives through zip: paths.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+
+#include "zipfileengine_p.h"
+
+#ifndef OSDAB_ZIP_NO_FILE_ENGINE
+
+#include "unzip_p.h"
+#include "zipcodec_p.h"
+#include "zipentry_p.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/************************************************************************
+ ZipEngineArchive
+*************************************************************************/
+
+ZipEngineArchive::ZipEngineArchive(const QString& path) :
+    archivePath(path), size(-1)
+{
+}
+
+bool ZipEngineArchive::open()
+{
+    const QFileInfo info(archivePath);
+    modified = info.lastModified();
+    size = info.size();
+
+    const UnZip::ErrorCode ec = unzip.openArchive(archivePath);
+    return ec == UnZip::Ok || ec == UnZip::PartiallyCorrupted;
+}
+
+bool ZipEngineArchive::isCurrent() const
+{
+    const QFileInfo info(archivePath);
+    return info.size() == size && info.lastModified() == modified;
+}
+
+ZipEngineEntry ZipEngineArchive::entry(const QString& name)
+{
+    ZipEngineEntry e;
+    if (name.isEmpty()) {
+        e.exists = e.isDir = true;
+        e.modified = modified;
+        return e;
+    }
+
+    QMutexLocker locker(&mutex);
+    UnzipPrivate* d = unzip.d;
+
+    ZipEntryP buffer;
+    const ZipEntryP* h = d->findEntry(name, buffer);
+    if (h) {
+        // Sets the data offset
+        if (!h->lhEntryChecked) {
+            if (d->parseLocalHeaderRecord(name, *h) != UnZip::Ok)
+                return e;
+            h->lhEntryChecked = true;
+        }
+
+        e.exists = true;
+        e.encrypted = h->isEncrypted();
+        e.method = h->compMethod;
+        e.dataOffset = h->dataOffset;
+        e.szComp = h->szComp;
+        e.szUncomp = h->szUncomp;
+        e.crc = h->crc;
+        e.modified = unzip.entry(name).lastModified();
+        return e;
+    }
+
+    // Directories don't need an entry of their own
+    const QString dir = name + QLatin1Char('/');
+    const UnZip::EntryView view = unzip.entry(dir);
+    if (view.isValid() || hasPrefix(dir, 0)) {
+        e.exists = e.isDir = true;
+        e.modified = view.isValid() ? view.lastModified() : modified;
+    }
+    return e;
+}
+
+QStringList ZipEngineArchive::children(const QString& dir)
+{
+    QMutexLocker locker(&mutex);
+
+    const QString prefix = dir.isEmpty() ? QString() : dir + QLatin1Char('/');
+    const int count = unzip.entryCount();
+    QStringList list;
+
+    int i = 0;
+    hasPrefix(prefix, &i);
+    while (i < count) {
+        const QString name = unzip.entryAt(i).filename();
+        if (!name.startsWith(prefix))
+            break;
+
+        const int slash = name.indexOf(QLatin1Char('/'), prefix.length());
+        if (slash < 0) {
+            // The directory itself has no name here
+            if (name.length() > prefix.length())
+                list.append(name.mid(prefix.length()));
+            ++i;
+            continue;
+        }
+
+        if (slash > prefix.length())
+            list.append(name.mid(prefix.length(), slash - prefix.length()));
+
+        // Skips the rest of the subdirectory: '0' comes right after '/'
+        i = unzip.d->lowerBound(name.left(slash) + QLatin1Char('0'));
+    }
+
+    return list;
+}
+
+/*! Returns true if some entry starts with \p prefix and sets \p position
+    to the first entry not less than \p prefix. The mutex must be locked.
+*/
+bool ZipEngineArchive::hasPrefix(const QString& prefix, int* position)
+{
+    const int i = unzip.d->lowerBound(prefix);
+    if (position)
+        *position = i;
+    return i < unzip.entryCount() && unzip.entryAt(i).filename().startsWith(prefix);
+}
+
+
+/************************************************************************
+ ZipFileEngine
+*************************************************************************/
+
+ZipFileEngine::ZipFileEngine(const ZipFileEngineHandlerPrivate* h, const QString& fileName,
+    const ZipEngineArchivePtr& a, const QString& e) :
+    handler(h),
+    name(fileName),
+    archive(a),
+    entryName(e)
+{
+    if (archive)
+        info = archive->entry(entryName);
+}
+
+ZipFileEngine::~ZipFileEngine()
+{
+    close();
+}
+
+//! Looks \p file up again (see setFileName()).
+void ZipFileEngine::resolve(const QString& file)
+{
+    const QString path = QDir::cleanPath(file.mid(int(sizeof(ZIP_ENGINE_PREFIX)) - 1));
+    name = QLatin1String(ZIP_ENGINE_PREFIX) + path;
+    archive = handler->resolve(path, &entryName);
+    info = archive ? archive->entry(entryName) : ZipEngineEntry();
+}
+
+bool ZipFileEngine::open(QIODevice::OpenMode mode)
+{
+    if (!info.exists || info.isDir) {
+        setError(QFile::OpenError, QLatin1String("No such file in the archive"));
+        return false;
+    }
+    if (mode & QIODevice::WriteOnly) {
+        setError(QFile::OpenError, QLatin1String("Archive entries are read only"));
+        return false;
+    }
+    if (info.encrypted) {
+        setError(QFile::OpenError, QLatin1String("Encrypted entries are not supported"));
+        return false;
+    }
+    if (info.method != ZIP_METHOD_STORED && !ZipCodec::codecForMethod(info.method)) {
+        setError(QFile::OpenError, QLatin1String("Unsupported compression method"));
+        return false;
+    }
+
+    // A private handle: engines are used by different threads
+    file.setFileName(archive->path());
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(QFile::OpenError, file.errorString());
+        return false;
+    }
+
+    ZipEntryDeviceInfo i;
+    i.dataOffset = info.dataOffset;
+    i.szComp = info.szComp;
+    i.szUncomp = info.szUncomp;
+    i.method = info.method;
+    i.crc = info.crc;
+
+    // The QFile using this engine already buffers what it reads
+    entry.reset(new ZipEntryDevice(&file, i));
+    if (!entry->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        close();
+        setError(QFile::OpenError, QLatin1String("Unable to read the entry"));
+        return false;
+    }
+    return true;
+}
+
+bool ZipFileEngine::close()
+{
+    entry.reset();
+    file.close();
+    return true;
+}
+
+qint64 ZipFileEngine::size() const
+{
+    return info.isDir ? 0 : info.szUncomp;
+}
+
+qint64 ZipFileEngine::pos() const
+{
+    return entry ? entry->pos() : 0;
+}
+
+bool ZipFileEngine::seek(qint64 pos)
+{
+    return entry && entry->seek(pos);
+}
+
+bool ZipFileEngine::isSequential() const
+{
+    return false;
+}
+
+qint64 ZipFileEngine::read(char* data, qint64 maxlen)
+{
+    if (!entry)
+        return -1;
+
+    const qint64 n = entry->read(data, maxlen);
+    if (n < 0)
+        setError(QFile::ReadError, entry->errorString());
+    return n;
+}
+
+bool ZipFileEngine::caseSensitive() const
+{
+    return true;
+}
+
+bool ZipFileEngine::isRelativePath() const
+{
+    return false;
+}
+
+QAbstractFileEngine::FileFlags ZipFileEngine::fileFlags(FileFlags type) const
+{
+    FileFlags flags;
+    if (info.exists) {
+        flags |= ExistsFlag | ReadOwnerPerm | ReadUserPerm | ReadGroupPerm | ReadOtherPerm;
+        if (info.isDir)
+            flags |= DirectoryType | ExeOwnerPerm | ExeUserPerm | ExeGroupPerm | ExeOtherPerm;
+        else flags |= FileType;
+    }
+    return flags & type;
+}
+
+QString ZipFileEngine::fileName(FileName file) const
+{
+    const int slash = name.lastIndexOf(QLatin1Char('/'));
+    switch (file) {
+    case BaseName:
+        return name.mid(slash + 1);
+    case PathName:
+    case AbsolutePathName:
+    case CanonicalPathName:
+        return slash < 0 ? name : name.left(slash);
+    case LinkName:
+        return QString();
+    default:
+        return name;
+    }
+}
+
+QDateTime ZipFileEngine::fileTime(FileTime time) const
+{
+    Q_UNUSED(time);
+    return info.modified;
+}
+
+void ZipFileEngine::setFileName(const QString& file)
+{
+    close();
+    resolve(file);
+}
+
+QAbstractFileEngine::Iterator* ZipFileEngine::beginEntryList(QDir::Filters filters,
+    const QStringList& filterNames)
+{
+    if (!info.isDir)
+        return 0;
+    return new ZipFileEngineIterator(filters, filterNames, archive->children(entryName));
+}
+
+bool ZipFileEngine::supportsExtension(Extension extension) const
+{
+#if QT_VERSION >= 0x040400
+    return extension == MapExtension || extension == UnMapExtension;
+#else
+    Q_UNUSED(extension);
+    return false;
+#endif
+}
+
+bool ZipFileEngine::extension(Extension extension, const ExtensionOption* option, ExtensionReturn* output)
+{
+#if QT_VERSION >= 0x040400
+    if (extension == MapExtension) {
+        // Only stored entries are contiguous in the archive
+        const MapExtensionOption* o = static_cast<const MapExtensionOption*>(option);
+        uchar* map = entry ? entry->mappedData() : 0;
+        if (!map || !o || !output || o->offset < 0 || o->size < 0 || o->offset + o->size > info.szUncomp)
+            return false;
+        static_cast<MapExtensionReturn*>(output)->address = map + o->offset;
+        return true;
+    }
+    if (extension == UnMapExtension) {
+        // The mapping is released when the entry is closed
+        return entry && entry->mappedData();
+    }
+#else
+    Q_UNUSED(extension);
+    Q_UNUSED(option);
+    Q_UNUSED(output);
+#endif
+    return false;
+}
+
+
+/************************************************************************
+ ZipFileEngineIterator
+*************************************************************************/
+
+ZipFileEngineIterator::ZipFileEngineIterator(QDir::Filters filters,
+    const QStringList& nameFilters, const QStringList& e) :
+    QAbstractFileEngineIterator(filters, nameFilters),
+    entries(e),
+    current(-1)
+{
+}
+
+QString ZipFileEngineIterator::next()
+{
+    if (!hasNext())
+        return QString();
+    ++current;
+    return currentFilePath();
+}
+
+bool ZipFileEngineIterator::hasNext() const
+{
+    return current + 1 < entries.size();
+}
+
+QString ZipFileEngineIterator::currentFileName() const
+{
+    return current >= 0 && current < entries.size() ? entries.at(current) : QString();
+}
+
+
+/************************************************************************
+ ZipFileEngineHandlerPrivate
+*************************************************************************/
+
+ZipFileEngineHandlerPrivate::ZipFileEngineHandlerPrivate() :
+    maxArchives(8)
+{
+}
+
+QAbstractFileEngine* ZipFileEngineHandlerPrivate::create(const QString& fileName) const
+{
+    // Called for every file name used by the application
+    if (!fileName.startsWith(QLatin1String(ZIP_ENGINE_PREFIX)))
+        return 0;
+
+    const QString path = QDir::cleanPath(fileName.mid(int(sizeof(ZIP_ENGINE_PREFIX)) - 1));
+    QString entryName;
+    const ZipEngineArchivePtr archive = resolve(path, &entryName);
+    if (!archive)
+        return 0;
+
+    return new ZipFileEngine(this, QLatin1String(ZIP_ENGINE_PREFIX) + path, archive, entryName);
+}
+
+ZipEngineArchivePtr ZipFileEngineHandlerPrivate::resolve(const QString& path, QString* entryName) const
+{
+    QMutexLocker locker(&mutex);
+
+    for (int i = 0; i < archives.size(); ++i) {
+        const ZipEngineArchivePtr archive = archives.at(i);
+        const QString archivePath = archive->path();
+        if (!path.startsWith(archivePath)
+            || (path.length() > archivePath.length() && path.at(archivePath.length()) != QLatin1Char('/')))
+            continue;
+
+        // Engines still using the old archive keep it alive
+        if (!archive->isCurrent()) {
+            archives.removeAt(i);
+            break;
+        }
+
+        archives.move(i, 0);
+        *entryName = path.mid(archivePath.length() + 1);
+        return archive;
+    }
+
+    // The archive is the first existing file in the path
+    int slash = 0;
+    for (;;) {
+        slash = path.indexOf(QLatin1Char('/'), slash + 1);
+        const QString candidate = slash < 0 ? path : path.left(slash);
+        if (QFileInfo(candidate).isFile()) {
+            ZipEngineArchivePtr archive(new ZipEngineArchive(candidate));
+            if (!archive->open())
+                return ZipEngineArchivePtr();
+
+            archives.prepend(archive);
+            while (archives.size() > maxArchives)
+                archives.removeLast();
+
+            *entryName = slash < 0 ? QString() : path.mid(slash + 1);
+            return archive;
+        }
+        if (slash < 0)
+            break;
+    }
+
+    return ZipEngineArchivePtr();
+}
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIP_NO_FILE_ENGINE
+
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/************************************************************************
+ ZipFileEngineHandler
+*************************************************************************/
+
+/*! \class ZipFileEngineHandler zipfileengine.h
+
+ Makes the entries of zip archives available to QFile, QFileInfo, QDir and
+ all the Qt classes loading files by name (QImage, QSvgRenderer...) with
+ paths like "zip:/path/archive.zip/dir/file.png", without extracting them.
+ The handler is active as long as this object exists.
+
+ Archives are opened once and shared; the most recently used ones are kept
+ open (8 by default) and reopened if the archive file changes. Entries are
+ looked up through the parsed central directory (or the sidecar index, see
+ UnZip::setIndexFile()) and directories are listed from the sorted entry
+ table. Each open entry reads the archive through its own file handle:
+ stored entries are memory mapped (QFile::map() on them returns a pointer
+ into the archive) and compressed entries are decompressed while they are
+ read by the same ZipEntryDevice used by UnZip::openEntry(), so seeking
+ restarts from the nearest checkpoint. The CRC is checked when an entry is read sequentially up to its end.
+ Entries are read only and encrypted entries can't be opened.
+
+ Not available with Qt 6 or if OSDAB_ZIP_NO_FILE_ENGINE is defined (see
+ isAvailable()). Qt 5 builds need the QtCore private headers (QT += core-private).
+*/
+
+ZipFileEngineHandler::ZipFileEngineHandler() :
+    d(new ZipFileEngineHandlerPrivate)
+{
+}
+
+ZipFileEngineHandler::~ZipFileEngineHandler()
+{
+    delete d;
+}
+
+/*!
+ Sets the maximum number of archives kept open (at least 1).
+*/
+void ZipFileEngineHandler::setMaxOpenArchives(int count)
+{
+#ifndef OSDAB_ZIP_NO_FILE_ENGINE
+    QMutexLocker locker(&d->mutex);
+    d->maxArchives = qMax(1, count);
+    while (d->archives.size() > d->maxArchives)
+        d->archives.removeLast();
+#else
+    Q_UNUSED(count);
+#endif
+}
+
+/*!
+ Returns the maximum number of archives kept open.
+*/
+int ZipFileEngineHandler::maxOpenArchives() const
+{
+#ifndef OSDAB_ZIP_NO_FILE_ENGINE
+    QMutexLocker locker(&d->mutex);
+    return d->maxArchives;
+#else
+    return 0;
+#endif
+}
+
+/*!
+ Closes the archives that are not in use. Files and directories that are
+ still open keep their archive open.
+*/
+void ZipFileEngineHandler::clearCache()
+{
+#ifndef OSDAB_ZIP_NO_FILE_ENGINE
+    QMutexLocker locker(&d->mutex);
+    d->archives.clear();
+#endif
+}
+
+/*!
+ Returns false if the file engine has been left out of the build.
+*/
+bool ZipFileEngineHandler::isAvailable()
+{
+#ifndef OSDAB_ZIP_NO_FILE_ENGINE
+    return true;
+#else
+    return false;
+#endif
+}
+
+OSDAB_END_NAMESPACE
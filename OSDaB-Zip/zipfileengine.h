@@ -0,0 +1,61 @@
+/****************************************************************************
+** Filename: zipfileengine.h
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Qt file engine giving access to the entries of zip archives through zip: paths.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+
+#ifndef OSDAB_ZIPFILEENGINE__H
+#define OSDAB_ZIPFILEENGINE__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QtGlobal>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+class ZipFileEngineHandlerPrivate;
+
+class OSDAB_ZIP_EXPORT ZipFileEngineHandler
+{
+public:
+    ZipFileEngineHandler();
+    ~ZipFileEngineHandler();
+
+    void setMaxOpenArchives(int count);
+    int maxOpenArchives() const;
+
+    void clearCache();
+
+    static bool isAvailable();
+
+private:
+    ZipFileEngineHandlerPrivate* d;
+
+    Q_DISABLE_COPY(ZipFileEngineHandler)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPFILEENGINE__H
@@ -0,0 +1,224 @@
+/****************************************************************************
+** Filename: zipfileengine_p.h
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Qt file engine giving access to the entries of zip archives through zip: paths.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPFILEENGINE_P__H
+#define OSDAB_ZIPFILEENGINE_P__H
+
+#include "zipfileengine.h"
+#include "unzip.h"
+#include "zipentrydevice_p.h"
+
+#include <QtCore/QtGlobal>
+
+/*! #define OSDAB_ZIP_NO_FILE_ENGINE to leave the zip: file engine out.
+    QAbstractFileEngine is a public class in Qt 4 and a private one in Qt 5
+    (add core-private to QT); the engine is always left out with Qt 6.
+*/
+// #define OSDAB_ZIP_NO_FILE_ENGINE
+
+#if !defined(OSDAB_ZIP_NO_FILE_ENGINE) && QT_VERSION >= 0x060000
+#define OSDAB_ZIP_NO_FILE_ENGINE
+#endif
+
+#ifndef OSDAB_ZIP_NO_FILE_ENGINE
+
+#if QT_VERSION >= 0x050000
+#include <QtCore/private/qabstractfileengine_p.h>
+#else
+#include <QtCore/QAbstractFileEngine>
+#include <QtCore/QAbstractFileEngineHandler>
+#endif
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+//! Prefix of the paths handled by the engine
+#define ZIP_ENGINE_PREFIX "zip:"
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+//! What the file engine needs to know about an entry of an archive.
+struct ZipEngineEntry
+{
+    ZipEngineEntry() : exists(false), isDir(false), encrypted(false),
+        method(0), dataOffset(0), szComp(0), szUncomp(0), crc(0) {}
+
+    bool exists;
+    bool isDir;
+    bool encrypted;
+    quint16 method;
+    quint32 dataOffset;
+    quint32 szComp;
+    quint32 szUncomp;
+    quint32 crc;
+    QDateTime modified;
+};
+
+/*!
+    An archive opened by the handler and shared by all the engines of its
+    entries. The UnZip object is only used to look entries up (possibly
+    through its memory mapped index) and is protected by a mutex; engines
+    read the data through their own file handle.
+*/
+class ZipEngineArchive
+{
+public:
+    explicit ZipEngineArchive(const QString& path);
+
+    bool open();
+    //! True if the archive file has not been modified since it has been opened.
+    bool isCurrent() const;
+
+    inline QString path() const { return archivePath; }
+    inline QDateTime lastModified() const { return modified; }
+
+    //! Looks up \p name, parsing its local header; directories may be implicit.
+    ZipEngineEntry entry(const QString& name);
+    //! Names of the files and directories in directory \p dir ("" is the root).
+    QStringList children(const QString& dir);
+
+private:
+    bool hasPrefix(const QString& prefix, int* position);
+
+    QString archivePath;
+    QDateTime modified;
+    qint64 size;
+
+    QMutex mutex;
+    UnZip unzip;
+};
+
+typedef QSharedPointer<ZipEngineArchive> ZipEngineArchivePtr;
+
+class ZipFileEngine : public QAbstractFileEngine
+{
+public:
+    ZipFileEngine(const ZipFileEngineHandlerPrivate* handler, const QString& fileName,
+        const ZipEngineArchivePtr& archive, const QString& entryName);
+    ~ZipFileEngine();
+
+    bool open(QIODevice::OpenMode mode);
+    bool close();
+    qint64 size() const;
+    qint64 pos() const;
+    bool seek(qint64 pos);
+    bool isSequential() const;
+    qint64 read(char* data, qint64 maxlen);
+
+    bool caseSensitive() const;
+    bool isRelativePath() const;
+    FileFlags fileFlags(FileFlags type) const;
+    QString fileName(FileName file) const;
+    QDateTime fileTime(FileTime time) const;
+    void setFileName(const QString& file);
+
+    Iterator* beginEntryList(QDir::Filters filters, const QStringList& filterNames);
+
+    bool supportsExtension(Extension extension) const;
+    bool extension(Extension extension, const ExtensionOption* option = 0, ExtensionReturn* output = 0);
+
+private:
+    void resolve(const QString& file);
+
+    const ZipFileEngineHandlerPrivate* handler;
+    QString name;
+    ZipEngineArchivePtr archive;
+    QString entryName;
+    ZipEngineEntry info;
+
+    // Open entry, read through the same device as UnZip::openEntry()
+    QFile file;
+    QScopedPointer<ZipEntryDevice> entry;
+};
+
+//! Directory listing of a ZipFileEngine.
+class ZipFileEngineIterator : public QAbstractFileEngineIterator
+{
+public:
+    ZipFileEngineIterator(QDir::Filters filters, const QStringList& nameFilters,
+        const QStringList& entries);
+
+    QString next();
+    bool hasNext() const;
+    QString currentFileName() const;
+
+private:
+    QStringList entries;
+    int current;
+};
+
+class ZipFileEngineHandlerPrivate : public QAbstractFileEngineHandler
+{
+public:
+    ZipFileEngineHandlerPrivate();
+
+    QAbstractFileEngine* create(const QString& fileName) const;
+
+    /*! Returns the archive containing \p path (without the prefix) and sets
+        \p entryName to the rest of the path, or returns a null pointer.
+    */
+    ZipEngineArchivePtr resolve(const QString& path, QString* entryName) const;
+
+    mutable QMutex mutex;
+    // Most recently used first
+    mutable QList<ZipEngineArchivePtr> archives;
+    int maxArchives;
+};
+
+OSDAB_END_NAMESPACE
+
+#else // OSDAB_ZIP_NO_FILE_ENGINE
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+class ZipFileEngineHandlerPrivate
+{
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIP_NO_FILE_ENGINE
+
+#endif // OSDAB_ZIPFILEENGINE_P__H
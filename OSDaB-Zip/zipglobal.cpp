@@ -26,6 +26,7 @@
 **********************************************************************/
 
 #include "zipglobal.h"
+#include "ziptrace_p.h"
 
 #if defined(Q_OS_WIN) || defined(Q_OS_WINCE) || defined(Q_OS_LINUX) || defined (Q_OS_MACX)
 #define OSDAB_ZIP_HAS_UTC
@@ -42,6 +43,11 @@
 
 OSDAB_BEGIN_NAMESPACE(Zip)
 
+#ifdef ZIP_TRACE_CATEGORIES
+Q_LOGGING_CATEGORY(OSDAB_ZIP_MANGLE(zipLog), "osdab.zip", QtWarningMsg)
+Q_LOGGING_CATEGORY(OSDAB_ZIP_MANGLE(unzipLog), "osdab.unzip", QtWarningMsg)
+#endif
+
 /*! Returns the current UTC offset in seconds unless OSDAB_ZIP_NO_UTC is defined
     and method is implemented for the current platform and 0 otherwise.
 */
@@ -149,4 +155,58 @@ bool OSDAB_ZIP_MANGLE(setFileTimestamp)(const QString& fileName, const QDateTime
 
     return true;
 }
+
+/************************************************************************
+ ZipStatistics
+*************************************************************************/
+
+/*!
+    \class ZipStatistics zipglobal.h
+
+    \brief Bytes and time counters returned by Zip::statistics() and UnZip::statistics().
+
+    The per-entry counters refer to the last entry that has been (or is being)
+    processed; the other ones to all the entries since the archive has been
+    created or opened.
+*/
+
+//! Creates an object with all the counters set to 0.
+ZipStatistics::ZipStatistics()
+{
+    reset();
+}
+
+//! Sets all the counters to 0.
+void ZipStatistics::reset()
+{
+    entry.clear();
+    entrySize = entryBytesIn = entryBytesOut = 0;
+    entries = 0;
+    bytesIn = bytesOut = 0;
+    readTime = compressTime = writeTime = crcTime = 0;
+    cacheHits = cacheMisses = 0;
+}
+
+void ZipStatistics::merge(const ZipStatistics& other)
+{
+    entry = other.entry;
+    entrySize = other.entrySize;
+    entryBytesIn = other.entryBytesIn;
+    entryBytesOut = other.entryBytesOut;
+    entries += other.entries;
+    bytesIn += other.bytesIn;
+    bytesOut += other.bytesOut;
+    readTime += other.readTime;
+    compressTime += other.compressTime;
+    writeTime += other.writeTime;
+    crcTime += other.crcTime;
+    cacheHits += other.cacheHits;
+    cacheMisses += other.cacheMisses;
+}
+
+double ZipStatistics::ratio() const
+{
+    return bytesIn > 0 ? double(bytesOut) / bytesIn : 0;
+}
+
 OSDAB_END_NAMESPACE
@@ -29,6 +29,7 @@
 #define OSDAB_ZIPGLOBAL__H
 
 #include <QtCore/QDateTime>
+#include <QtCore/QString>
 #include <QtCore/QtGlobal>
 
 /* If you want to build the OSDaB Zip code as
@@ -72,6 +73,71 @@ OSDAB_ZIP_EXPORT int OSDAB_ZIP_MANGLE(currentUtcOffset)();
 OSDAB_ZIP_EXPORT QDateTime OSDAB_ZIP_MANGLE(fromFileTimestamp)(const QDateTime& dateTime);
 OSDAB_ZIP_EXPORT bool OSDAB_ZIP_MANGLE(setFileTimestamp)(const QString& fileName, const QDateTime& dateTime);
 
+/*!
+    Counters of a Zip or UnZip object, reset when an archive is created or opened.
+    Bytes in are the file data read (Zip) or the compressed data read (UnZip),
+    bytes out the compressed data written (Zip) or the file data written (UnZip).
+    Times are in nanoseconds and are only measured with Qt 4.8 or later.
+*/
+class OSDAB_ZIP_EXPORT ZipStatistics
+{
+public:
+    ZipStatistics();
+
+    void reset();
+    //! Takes the current entry of \p other and adds its counters and times.
+    void merge(const ZipStatistics& other);
+
+    //! Bytes out divided by bytes in, 0 if nothing has been read yet.
+    double ratio() const;
+
+    //! Entry being processed
+    QString entry;
+    //! Uncompressed size of the entry being processed
+    qint64 entrySize;
+    qint64 entryBytesIn;
+    qint64 entryBytesOut;
+
+    //! Entries completed
+    int entries;
+    qint64 bytesIn;
+    qint64 bytesOut;
+
+    qint64 readTime;
+    //! Time spent in the codecs and in encryption or decryption
+    qint64 compressTime;
+    qint64 writeTime;
+    qint64 crcTime;
+
+    //! Blocks read from and missing from the UnZip read cache (see UnZip::setReadCache())
+    qint64 cacheHits;
+    qint64 cacheMisses;
+};
+
+/*!
+    Receives the progress of a Zip or UnZip object.
+    The callbacks are usually invoked on the thread adding or extracting the
+    files. Parallel operations (UnZip::verifyArchive(int) and UnZip::search())
+    invoke them from their worker threads and Zip in concurrent mode from the
+    threads adding files; a mutex makes sure they are never called
+    concurrently, but the callbacks must not rely on thread affinity (e.g.
+    touch widgets directly) and should return quickly as the other threads
+    wait for them.
+*/
+class OSDAB_ZIP_EXPORT ZipProgressObserver
+{
+public:
+    virtual ~ZipProgressObserver() {}
+
+    /*! Called after each chunk of data. Return false to cancel the operation,
+        which then fails with the Canceled error code.
+    */
+    virtual bool progress(const ZipStatistics& stats) { Q_UNUSED(stats); return true; }
+
+    //! Called when an entry has been added or extracted.
+    virtual void entryFinished(const ZipStatistics& stats) { Q_UNUSED(stats); }
+};
+
 OSDAB_END_NAMESPACE
 
 #endif // OSDAB_ZIPGLOBAL__H
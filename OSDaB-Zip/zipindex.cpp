@@ -0,0 +1,354 @@
+/****************************************************************************
+** Filename: zipindex.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Persistent index of the central directory used by the UnZip class.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zipindex_p.h"
+#include "zipentry_p.h"
+#include "ziptrace_p.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QVector>
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <QtCore/qt_windows.h>
+#endif
+
+//! Written in the native byte order: a different value means a different machine
+#define ZIP_INDEX_BYTE_ORDER 0x01020304
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+struct ZipIndex::Header
+{
+    char magic[4];
+    quint32 byteOrder;
+    qint64 archiveSize;
+    qint64 modified;
+    quint32 cdOffset;
+    quint32 cdSize;
+    quint32 cdCrc;
+    quint32 cdEntryCount;
+    quint32 count;
+    quint32 unsupported;
+    // Power of two
+    quint32 bucketCount;
+    // In QChars
+    quint32 stringsLength;
+};
+
+ZipIndex::ZipIndex() :
+    map(0),
+    header(0),
+    entries(0),
+    buckets(0),
+    strings(0)
+{
+}
+
+ZipIndex::~ZipIndex()
+{
+    close();
+}
+
+bool ZipIndex::open(const QString& path, const Key& key)
+{
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(Header))) {
+        close();
+        return false;
+    }
+
+    const uchar* base = 0;
+#if QT_VERSION >= 0x040400
+    map = file.map(0, size);
+    base = map;
+#endif
+    if (!base) {
+        data = file.readAll();
+        if (data.size() != size) {
+            close();
+            return false;
+        }
+        base = (const uchar*) data.constData();
+    }
+
+    const Header* h = (const Header*) base;
+    const qint64 expected = qint64(sizeof(Header)) + qint64(h->count) * sizeof(Entry)
+        + qint64(h->bucketCount) * sizeof(quint32) + qint64(h->stringsLength) * sizeof(QChar);
+    const bool valid = memcmp(h->magic, ZIP_INDEX_MAGIC, 4) == 0
+        && h->byteOrder == ZIP_INDEX_BYTE_ORDER
+        && h->archiveSize == key.archiveSize && h->modified == key.modified
+        && h->cdOffset == key.cdOffset && h->cdSize == key.cdSize
+        && h->cdCrc == key.cdCrc && h->cdEntryCount == key.entryCount
+        && h->bucketCount > h->count && (h->bucketCount & (h->bucketCount - 1)) == 0
+        && expected == size;
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    header = h;
+    entries = (const Entry*) (base + sizeof(Header));
+    buckets = (const quint32*) (entries + h->count);
+    strings = (const QChar*) (buckets + h->bucketCount);
+    return true;
+}
+
+void ZipIndex::close()
+{
+#if QT_VERSION >= 0x040400
+    if (map)
+        file.unmap(map);
+#endif
+    map = 0;
+    file.close();
+    data.clear();
+
+    header = 0;
+    entries = 0;
+    buckets = 0;
+    strings = 0;
+}
+
+int ZipIndex::count() const
+{
+    return header ? int(header->count) : 0;
+}
+
+int ZipIndex::unsupportedEntries() const
+{
+    return header ? int(header->unsupported) : 0;
+}
+
+int ZipIndex::find(const QString& name) const
+{
+    if (!header)
+        return -1;
+
+    const quint32 mask = header->bucketCount - 1;
+    const int length = name.length();
+    quint32 b = hash(name.unicode(), length) & mask;
+
+    // There is always an empty bucket
+    for (quint32 probes = 0; probes <= mask; ++probes, b = (b + 1) & mask) {
+        const quint32 i = buckets[b];
+        if (!i)
+            return -1;
+        if (i > header->count)
+            continue;
+
+        const Entry& e = entries[i - 1];
+        if (e.nameLength == length && quint64(e.name) + length <= header->stringsLength
+            && memcmp(strings + e.name, name.unicode(), length * sizeof(QChar)) == 0)
+            return int(i - 1);
+    }
+    return -1;
+}
+
+QString ZipIndex::name(int i) const
+{
+    Q_ASSERT(header && i >= 0 && i < count());
+    const Entry& e = entries[i];
+    if (quint64(e.name) + e.nameLength > header->stringsLength)
+        return QString();
+    return QString(strings + e.name, e.nameLength);
+}
+
+bool ZipIndex::isDirectory(int i) const
+{
+    Q_ASSERT(header && i >= 0 && i < count());
+    const Entry& e = entries[i];
+    if (!e.nameLength || quint64(e.name) + e.nameLength > header->stringsLength)
+        return false;
+    return strings[e.name + e.nameLength - 1] == QLatin1Char('/');
+}
+
+QString ZipIndex::comment(int i) const
+{
+    Q_ASSERT(header && i >= 0 && i < count());
+    const Entry& e = entries[i];
+    if (!e.commentLength || quint64(e.comment) + e.commentLength > header->stringsLength)
+        return QString();
+    return QString(strings + e.comment, e.commentLength);
+}
+
+void ZipIndex::entry(int i, ZipEntryP& h) const
+{
+    Q_ASSERT(header && i >= 0 && i < count());
+    const Entry& e = entries[i];
+
+    h.lhOffset = e.lhOffset;
+    h.dataOffset = 0;
+    h.lhEntryChecked = false;
+    h.gpFlag[0] = e.gpFlag[0];
+    h.gpFlag[1] = e.gpFlag[1];
+    h.compMethod = e.compMethod;
+    h.aesStrength = e.aesStrength;
+    h.aesVersion = e.aesVersion;
+    h.modTime[0] = e.modTime[0];
+    h.modTime[1] = e.modTime[1];
+    h.modDate[0] = e.modDate[0];
+    h.modDate[1] = e.modDate[1];
+    h.crc = e.crc;
+    h.szComp = e.szComp;
+    h.szUncomp = e.szUncomp;
+    h.comment = comment(i);
+}
+
+bool ZipIndex::write(const QString& path, const Key& key,
+    const QMap<QString, ZipEntryP*>& headers, int unsupportedEntries)
+{
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ZIP_INDEX_MAGIC, 4);
+    h.byteOrder = ZIP_INDEX_BYTE_ORDER;
+    h.archiveSize = key.archiveSize;
+    h.modified = key.modified;
+    h.cdOffset = key.cdOffset;
+    h.cdSize = key.cdSize;
+    h.cdCrc = key.cdCrc;
+    h.cdEntryCount = key.entryCount;
+    h.count = headers.size();
+    h.unsupported = unsupportedEntries;
+
+    // Load factor of 0.5 at most
+    h.bucketCount = 2;
+    while (h.bucketCount < 2 * h.count)
+        h.bucketCount <<= 1;
+    const quint32 mask = h.bucketCount - 1;
+
+    QVector<Entry> table(h.count);
+    QVector<quint32> hashTable(h.bucketCount, 0);
+
+    quint32 i = 0;
+    quint32 offset = 0;
+    QMap<QString, ZipEntryP*>::ConstIterator it = headers.constBegin();
+    for (; it != headers.constEnd(); ++it, ++i) {
+        const QString& name = it.key();
+        const ZipEntryP& z = *it.value();
+        if (name.length() > 0xFFFF || z.comment.length() > 0xFFFF)
+            return false;
+
+        Entry& e = table[i];
+        memset(&e, 0, sizeof(e));
+        e.name = offset;
+        e.nameLength = name.length();
+        offset += e.nameLength;
+        e.comment = offset;
+        e.commentLength = z.comment.length();
+        offset += e.commentLength;
+        e.lhOffset = z.lhOffset;
+        e.crc = z.crc;
+        e.szComp = z.szComp;
+        e.szUncomp = z.szUncomp;
+        e.compMethod = z.compMethod;
+        e.aesVersion = z.aesVersion;
+        e.gpFlag[0] = z.gpFlag[0];
+        e.gpFlag[1] = z.gpFlag[1];
+        e.modTime[0] = z.modTime[0];
+        e.modTime[1] = z.modTime[1];
+        e.modDate[0] = z.modDate[0];
+        e.modDate[1] = z.modDate[1];
+        e.aesStrength = z.aesStrength;
+
+        quint32 b = hash(name.unicode(), name.length()) & mask;
+        while (hashTable[b])
+            b = (b + 1) & mask;
+        hashTable[b] = i + 1;
+    }
+    h.stringsLength = offset;
+
+    // Readers must never see a partial index
+    QTemporaryFile tmp(path + QLatin1String(".XXXXXX"));
+    tmp.setAutoRemove(false);
+    if (!tmp.open())
+        return false;
+
+    bool ok = tmp.write((const char*) &h, sizeof(h)) == qint64(sizeof(h))
+        && tmp.write((const char*) table.constData(), qint64(table.size()) * sizeof(Entry))
+            == qint64(table.size()) * qint64(sizeof(Entry))
+        && tmp.write((const char*) hashTable.constData(), qint64(hashTable.size()) * sizeof(quint32))
+            == qint64(hashTable.size()) * qint64(sizeof(quint32));
+
+    for (it = headers.constBegin(); ok && it != headers.constEnd(); ++it) {
+        const QString& name = it.key();
+        const QString& comment = it.value()->comment;
+        ok = tmp.write((const char*) name.unicode(), name.length() * sizeof(QChar))
+                == qint64(name.length() * sizeof(QChar))
+            && tmp.write((const char*) comment.unicode(), comment.length() * sizeof(QChar))
+                == qint64(comment.length() * sizeof(QChar));
+    }
+
+    tmp.close();
+    if (!ok) {
+        tmp.remove();
+        return false;
+    }
+
+    // QFile::rename() does not replace existing files: removing the old index
+    // first would leave no index at all if the rename fails
+    if (!replaceFile(tmp.fileName(), path)) {
+        // Fails on Windows while the old index is open: it is written again later
+        ZIP_WARNING(unzipLog) << "Unable to replace" << path;
+        QFile::remove(tmp.fileName());
+        return false;
+    }
+    return true;
+}
+
+//! Atomically replaces \p dest with \p src, overwriting it if it exists.
+bool ZipIndex::replaceFile(const QString& src, const QString& dest)
+{
+#ifdef Q_OS_WIN
+    return MoveFileExW((LPCWSTR) QDir::toNativeSeparators(src).utf16(),
+        (LPCWSTR) QDir::toNativeSeparators(dest).utf16(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return ::rename(QFile::encodeName(src).constData(), QFile::encodeName(dest).constData()) == 0;
+#endif
+}
+
+//! FNV-1a over the UTF-16 code units: qHash() is not the same in every Qt version.
+quint32 ZipIndex::hash(const QChar* name, int length)
+{
+    quint32 h = 2166136261u;
+    for (int i = 0; i < length; ++i) {
+        h = (h ^ (name[i].unicode() & 0xFF)) * 16777619u;
+        h = (h ^ (name[i].unicode() >> 8)) * 16777619u;
+    }
+    return h;
+}
+
+OSDAB_END_NAMESPACE
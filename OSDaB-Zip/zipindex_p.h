@@ -0,0 +1,154 @@
+/****************************************************************************
+** Filename: zipindex_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Persistent index of the central directory used by the UnZip class.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPINDEX_P__H
+#define OSDAB_ZIPINDEX_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QMap>
+#include <QtCore/QString>
+#include <QtCore/QtGlobal>
+
+//! Index files start with ZIP_INDEX_MAGIC
+#define ZIP_INDEX_MAGIC "OZI1"
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+class ZipEntryP;
+
+/*!
+    Pre-parsed central directory of an archive, stored in a sidecar file and
+    memory mapped: the entry records, an open addressing hash table of the
+    names and the names and comments as UTF-16 strings. Entries are sorted
+    like the keys of UnzipPrivate::headers. Nothing is allocated per entry
+    until an entry is actually requested.
+    The file is in the byte order of the machine that wrote it; an index
+    written on a different machine is simply not valid.
+*/
+class ZipIndex
+{
+public:
+    //! Properties of the archive the index must have been built for.
+    struct Key
+    {
+        qint64 archiveSize;
+        //! Modification time of the archive file in msecs
+        qint64 modified;
+        quint32 cdOffset;
+        quint32 cdSize;
+        quint32 cdCrc;
+        quint32 entryCount;
+    };
+
+    //! Central directory record of an entry, as stored in the index.
+    struct Entry
+    {
+        // Offsets in QChars from the start of the strings
+        quint32 name;
+        quint32 comment;
+        quint16 nameLength;
+        quint16 commentLength;
+        quint32 lhOffset;
+        quint32 crc;
+        quint32 szComp;
+        quint32 szUncomp;
+        quint16 compMethod;
+        quint16 aesVersion;
+        quint8 gpFlag[2];
+        quint8 modTime[2];
+        quint8 modDate[2];
+        quint8 aesStrength;
+        quint8 reserved;
+    };
+
+    ZipIndex();
+    ~ZipIndex();
+
+    //! Maps the index at \p path. Returns false if it is missing, broken or not built for \p key.
+    bool open(const QString& path, const Key& key);
+    void close();
+    inline bool isOpen() const { return header != 0; }
+
+    int count() const;
+    //! Number of central directory records skipped when the index has been built.
+    int unsupportedEntries() const;
+
+    //! Returns the position of \p name or -1. Does not allocate.
+    int find(const QString& name) const;
+    //! Returns a copy of the name of the entry at \p i.
+    QString name(int i) const;
+    //! Returns a copy of the comment of the entry at \p i.
+    QString comment(int i) const;
+    //! Returns true if the name of the entry at \p i ends with a '/'. Does not allocate.
+    bool isDirectory(int i) const;
+    //! Returns the mapped record of the entry at \p i. Does not allocate.
+    inline const Entry& record(int i) const { Q_ASSERT(header && i >= 0 && i < count()); return entries[i]; }
+    //! Fills \p entry with the central directory fields of the entry at \p i.
+    void entry(int i, ZipEntryP& entry) const;
+
+    /*! Writes an index of \p headers to \p path, replacing the file atomically.
+        If it can't be replaced, the old index is kept and the new one discarded.
+    */
+    static bool write(const QString& path, const Key& key,
+        const QMap<QString, ZipEntryP*>& headers, int unsupportedEntries);
+
+private:
+    struct Header;
+
+    static quint32 hash(const QChar* name, int length);
+    static bool replaceFile(const QString& src, const QString& dest);
+
+    QFile file;
+    uchar* map;
+    // Contents of the index if it could not be mapped
+    QByteArray data;
+
+    const Header* header;
+    const Entry* entries;
+    const quint32* buckets;
+    const QChar* strings;
+
+    Q_DISABLE_COPY(ZipIndex)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPINDEX_P__H
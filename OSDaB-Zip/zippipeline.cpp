@@ -0,0 +1,168 @@
+/****************************************************************************
+** Filename: zippipeline.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Reader and writer threads used by the Zip class to overlap I/O and compression.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zippipeline_p.h"
+
+#ifndef QT_NO_THREAD
+
+#include <QtCore/QIODevice>
+#include <QtCore/QMutexLocker>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/************************************************************************
+ ZipRingBuffer
+*************************************************************************/
+
+ZipRingBuffer::ZipRingBuffer(int buffers, int slotSize) :
+    data(new char[buffers * slotSize]),
+    lengths(new qint64[buffers]),
+    count(buffers),
+    size(slotSize),
+    head(0),
+    tail(0),
+    used(0),
+    aborted(false)
+{
+    Q_ASSERT(buffers > 0 && slotSize > 0);
+}
+
+ZipRingBuffer::~ZipRingBuffer()
+{
+    delete[] data;
+    delete[] lengths;
+}
+
+char* ZipRingBuffer::acquireWrite()
+{
+    QMutexLocker locker(&mutex);
+    while (used == count && !aborted)
+        notFull.wait(&mutex);
+    return aborted ? 0 : data + head * size;
+}
+
+void ZipRingBuffer::commitWrite(qint64 len)
+{
+    QMutexLocker locker(&mutex);
+    if (aborted)
+        return;
+    lengths[head] = len;
+    head = (head + 1) % count;
+    ++used;
+    notEmpty.wakeOne();
+}
+
+char* ZipRingBuffer::acquireRead(qint64& len)
+{
+    QMutexLocker locker(&mutex);
+    while (used == 0 && !aborted)
+        notEmpty.wait(&mutex);
+    if (aborted)
+        return 0;
+    len = lengths[tail];
+    return data + tail * size;
+}
+
+void ZipRingBuffer::releaseRead()
+{
+    QMutexLocker locker(&mutex);
+    if (aborted)
+        return;
+    tail = (tail + 1) % count;
+    --used;
+    notFull.wakeOne();
+}
+
+void ZipRingBuffer::abort()
+{
+    QMutexLocker locker(&mutex);
+    aborted = true;
+    notFull.wakeAll();
+    notEmpty.wakeAll();
+}
+
+
+/************************************************************************
+ ZipReaderThread
+*************************************************************************/
+
+ZipReaderThread::ZipReaderThread(QIODevice* dev, ZipRingBuffer* r) :
+    device(dev), ring(r)
+{
+    Q_ASSERT(device && ring);
+}
+
+void ZipReaderThread::run()
+{
+    for (;;) {
+        char* buffer = ring->acquireWrite();
+        if (!buffer)
+            return;
+
+        const qint64 read = device->read(buffer, ring->slotSize());
+        ring->commitWrite(read < 0 ? -1 : read);
+        if (read <= 0)
+            return;
+    }
+}
+
+
+/************************************************************************
+ ZipWriterThread
+*************************************************************************/
+
+ZipWriterThread::ZipWriterThread(QIODevice* dev, ZipRingBuffer* r) :
+    device(dev), ring(r), total(0), error(false)
+{
+    Q_ASSERT(device && ring);
+}
+
+void ZipWriterThread::run()
+{
+    for (;;) {
+        qint64 len = 0;
+        const char* buffer = ring->acquireRead(len);
+        if (!buffer || len <= 0)
+            return;
+
+        const qint64 written = device->write(buffer, len);
+        ring->releaseRead();
+
+        if (written > 0)
+            total += written;
+        if (written != len) {
+            // Stops the compressor too
+            error = true;
+            ring->abort();
+            return;
+        }
+    }
+}
+
+OSDAB_END_NAMESPACE
+
+#endif // QT_NO_THREAD
@@ -0,0 +1,138 @@
+/****************************************************************************
+** Filename: zippipeline_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Reader and writer threads used by the Zip class to overlap I/O and compression.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPPIPELINE_P__H
+#define OSDAB_ZIPPIPELINE_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QtGlobal>
+
+#ifndef QT_NO_THREAD
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+class QIODevice;
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/*!
+    Bounded ring of fixed size buffers shared by one producer and one consumer
+    thread. The size committed with a buffer is the number of valid bytes;
+    0 marks the end of the stream and -1 a read error.
+*/
+class ZipRingBuffer
+{
+public:
+    ZipRingBuffer(int buffers, int slotSize);
+    ~ZipRingBuffer();
+
+    inline int slotSize() const { return size; }
+
+    //! Waits for a free buffer and returns it or returns 0 if the ring has been aborted.
+    char* acquireWrite();
+    //! Hands the buffer returned by acquireWrite() over to the consumer.
+    void commitWrite(qint64 len);
+
+    //! Waits for a filled buffer and returns it or returns 0 if the ring has been aborted.
+    char* acquireRead(qint64& len);
+    //! Gives the buffer returned by acquireRead() back to the producer.
+    void releaseRead();
+
+    //! Wakes up and stops both the producer and the consumer.
+    void abort();
+
+private:
+    QMutex mutex;
+    QWaitCondition notFull;
+    QWaitCondition notEmpty;
+
+    char* data;
+    qint64* lengths;
+    int count;
+    int size;
+    int head;
+    int tail;
+    int used;
+    bool aborted;
+
+    Q_DISABLE_COPY(ZipRingBuffer)
+};
+
+//! Reads a device into a ring buffer until the end of the device.
+class ZipReaderThread : public QThread
+{
+public:
+    ZipReaderThread(QIODevice* device, ZipRingBuffer* ring);
+
+protected:
+    void run();
+
+private:
+    QIODevice* device;
+    ZipRingBuffer* ring;
+};
+
+//! Writes the buffers of a ring buffer to a device until the end of the stream.
+class ZipWriterThread : public QThread
+{
+public:
+    ZipWriterThread(QIODevice* device, ZipRingBuffer* ring);
+
+    //! Number of bytes written. Only valid after the thread has finished.
+    inline qint64 written() const { return total; }
+    //! True if a write failed. Only valid after the thread has finished.
+    inline bool failed() const { return error; }
+
+protected:
+    void run();
+
+private:
+    QIODevice* device;
+    ZipRingBuffer* ring;
+    qint64 total;
+    bool error;
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // QT_NO_THREAD
+
+#endif // OSDAB_ZIPPIPELINE_P__H
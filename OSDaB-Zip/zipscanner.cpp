@@ -0,0 +1,343 @@
+/****************************************************************************
+** Filename: zipscanner.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Parallel directory scanner used by Zip::addDirectory().
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zipscanner_p.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#ifndef QT_NO_THREAD
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#endif
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <QtCore/QDirIterator>
+#endif
+
+#ifdef Q_OS_WIN
+#define ZIP_SCAN_CASE Qt::CaseInsensitive
+#else
+#define ZIP_SCAN_CASE Qt::CaseSensitive
+#endif
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+namespace {
+
+inline bool sameChar(QChar a, QChar b)
+{
+    return ZIP_SCAN_CASE == Qt::CaseSensitive ? a == b : a.toLower() == b.toLower();
+}
+
+//! Matches \p c against the set starting after '['. Moves \p p past the closing ']'.
+bool matchSet(const QChar*& p, const QChar* pe, QChar c)
+{
+    bool negate = false;
+    if (p != pe && (*p == QLatin1Char('!') || *p == QLatin1Char('^'))) {
+        negate = true;
+        ++p;
+    }
+
+    if (ZIP_SCAN_CASE == Qt::CaseInsensitive)
+        c = c.toLower();
+
+    bool found = false;
+    bool first = true;
+    while (p != pe && (first || *p != QLatin1Char(']'))) {
+        first = false;
+        QChar lo = *p++;
+        QChar hi = lo;
+        if (p + 1 < pe && *p == QLatin1Char('-') && p[1] != QLatin1Char(']')) {
+            hi = p[1];
+            p += 2;
+        }
+        if (ZIP_SCAN_CASE == Qt::CaseInsensitive) {
+            lo = lo.toLower();
+            hi = hi.toLower();
+        }
+        if (c.unicode() >= lo.unicode() && c.unicode() <= hi.unicode())
+            found = true;
+    }
+
+    // Unterminated set
+    if (p == pe)
+        return false;
+
+    ++p;
+    return found != negate;
+}
+
+bool lessThanName(const ZipScanEntry& a, const ZipScanEntry& b)
+{
+    return a.name < b.name;
+}
+
+bool lessThanDir(const ZipScanDir* a, const ZipScanDir* b)
+{
+    return a->entry.name < b->entry.name;
+}
+
+} // namespace
+
+
+#ifndef QT_NO_THREAD
+//! Scans one directory and queues a new task for each of its subdirectories.
+class ZipScanTask : public QRunnable
+{
+public:
+    ZipScanTask(ZipDirScanner* s, ZipScanDir* d, const QString& r, QThreadPool* p) :
+        scanner(s), dir(d), relative(r), pool(p) {}
+
+    void run() { scanner->scanDir(dir, relative, pool); }
+
+private:
+    ZipDirScanner* scanner;
+    ZipScanDir* dir;
+    QString relative;
+    QThreadPool* pool;
+};
+#endif
+
+
+/************************************************************************
+ ZipDirScanner
+*************************************************************************/
+
+ZipDirScanner::ZipDirScanner(const QStringList& include, const QStringList& exclude) :
+    includes(include), excludes(exclude)
+{
+}
+
+ZipScanDir* ZipDirScanner::scan(const QString& path)
+{
+    const QFileInfo info(QDir::cleanPath(path));
+    if (!info.isDir())
+        return 0;
+
+    ZipScanDir* root = new ZipScanDir;
+    root->path = info.absoluteFilePath();
+    root->entry.name = info.fileName();
+    root->entry.size = info.size();
+    root->entry.modified = info.lastModified().toTime_t();
+
+#ifndef QT_NO_THREAD
+    // Directory listing is mostly I/O bound: use some more threads than cores
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(4, QThread::idealThreadCount() * 2));
+    pool.start(new ZipScanTask(this, root, QString(), &pool));
+    pool.waitForDone();
+#else
+    scanDir(root, QString(), 0);
+#endif
+
+    // Directories with no included file would end up as empty entries
+    if (!includes.isEmpty())
+        prune(root);
+
+    return root;
+}
+
+//! \internal Lists \p dir and scans its subdirectories (in parallel if \p pool is set).
+void ZipDirScanner::scanDir(ZipScanDir* dir, const QString& relative, QThreadPool* pool)
+{
+    listDir(dir, relative);
+
+    qSort(dir->files.begin(), dir->files.end(), lessThanName);
+    qSort(dir->dirs.begin(), dir->dirs.end(), lessThanDir);
+
+    for (int i = 0; i < dir->dirs.size(); ++i) {
+        ZipScanDir* sub = dir->dirs.at(i);
+        const QString subRelative = relative + sub->entry.name + QLatin1Char('/');
+#ifndef QT_NO_THREAD
+        if (pool) {
+            pool->start(new ZipScanTask(this, sub, subRelative, pool));
+            continue;
+        }
+#endif
+        scanDir(sub, subRelative, pool);
+    }
+}
+
+#ifdef Q_OS_UNIX
+//! \internal Reads the directory with readdir() and stats each child once with fstatat().
+void ZipDirScanner::listDir(ZipScanDir* dir, const QString& relative)
+{
+    DIR* d = opendir(QFile::encodeName(dir->path).constData());
+    if (!d)
+        return;
+
+    const int fd = dirfd(d);
+    struct dirent* de;
+    while ((de = readdir(d)) != 0) {
+        const char* name = de->d_name;
+        // ".", ".." and hidden files
+        if (name[0] == '.')
+            continue;
+
+        struct stat st;
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        // Symbolic links, devices, fifos and sockets are not added
+        const bool isDir = S_ISDIR(st.st_mode);
+        if (!isDir && !S_ISREG(st.st_mode))
+            continue;
+
+        addEntry(dir, relative, QFile::decodeName(name), isDir,
+            (qint64) st.st_size, (uint) st.st_mtime);
+    }
+
+    closedir(d);
+}
+#else
+//! \internal Reads the directory with QDirIterator; each QFileInfo caches its attributes.
+void ZipDirScanner::listDir(ZipScanDir* dir, const QString& relative)
+{
+    QDirIterator it(dir->path, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        addEntry(dir, relative, info.fileName(), info.isDir(),
+            info.size(), info.lastModified().toTime_t());
+    }
+}
+#endif
+
+//! \internal Applies the filters and adds a child to \p dir.
+void ZipDirScanner::addEntry(ZipScanDir* dir, const QString& relative, const QString& name,
+    bool isDir, qint64 size, uint modified)
+{
+    if (!excludes.isEmpty() && matches(excludes, name, relative))
+        return;
+
+    if (isDir) {
+        ZipScanDir* sub = new ZipScanDir;
+        sub->path = dir->path;
+        if (!sub->path.endsWith(QLatin1Char('/')))
+            sub->path.append(QLatin1Char('/'));
+        sub->path.append(name);
+        sub->entry.name = name;
+        sub->entry.size = size;
+        sub->entry.modified = modified;
+        dir->dirs.append(sub);
+        return;
+    }
+
+    if (!includes.isEmpty() && !matches(includes, name, relative))
+        return;
+
+    ZipScanEntry e;
+    e.name = name;
+    e.size = size;
+    e.modified = modified;
+    dir->files.append(e);
+}
+
+/*! \internal Patterns containing a '/' are matched against the path relative
+    to the scanned directory, the others against the file name only.
+*/
+bool ZipDirScanner::matches(const QStringList& patterns, const QString& name,
+    const QString& relative) const
+{
+    for (int i = 0; i < patterns.size(); ++i) {
+        const QString& pattern = patterns.at(i);
+        if (pattern.contains(QLatin1Char('/'))) {
+            if (wildcardMatch(pattern, relative + name))
+                return true;
+        } else if (wildcardMatch(pattern, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//! \internal Removes subdirectories with no files. Returns false if \p dir is empty.
+bool ZipDirScanner::prune(ZipScanDir* dir)
+{
+    for (int i = dir->dirs.size() - 1; i >= 0; --i) {
+        if (!prune(dir->dirs.at(i)))
+            delete dir->dirs.takeAt(i);
+    }
+    return !dir->files.isEmpty() || !dir->dirs.isEmpty();
+}
+
+bool ZipDirScanner::wildcardMatch(const QString& pattern, const QString& str)
+{
+    const QChar* p = pattern.constData();
+    const QChar* const pe = p + pattern.size();
+    const QChar* s = str.constData();
+    const QChar* const se = s + str.size();
+
+    // Position after the last '*' and the string position it has been tried at
+    const QChar* starP = 0;
+    const QChar* starS = 0;
+
+    while (s != se) {
+        if (p != pe && *p == QLatin1Char('*')) {
+            starP = ++p;
+            starS = s;
+            continue;
+        }
+
+        if (p != pe) {
+            const QChar* next = p + 1;
+            bool ok;
+            if (*p == QLatin1Char('?'))
+                ok = true;
+            else if (*p == QLatin1Char('['))
+                ok = matchSet(next, pe, *s);
+            else ok = sameChar(*p, *s);
+
+            if (ok) {
+                p = next;
+                ++s;
+                continue;
+            }
+        }
+
+        // Backtrack: let the last '*' eat one more character
+        if (!starP)
+            return false;
+        p = starP;
+        s = ++starS;
+    }
+
+    while (p != pe && *p == QLatin1Char('*'))
+        ++p;
+    return p == pe;
+}
+
+OSDAB_END_NAMESPACE
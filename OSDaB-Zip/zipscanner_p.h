@@ -0,0 +1,113 @@
+/****************************************************************************
+** Filename: zipscanner_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Parallel directory scanner used by Zip::addDirectory().
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPSCANNER_P__H
+#define OSDAB_ZIPSCANNER_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QtAlgorithms>
+#include <QtCore/QtGlobal>
+
+class QThreadPool;
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+//! A file or directory found by ZipDirScanner. The file system is queried once per entry.
+struct ZipScanEntry
+{
+    QString name;
+    qint64 size;
+    uint modified;      // Seconds since the epoch
+
+    ZipScanEntry() : size(0), modified(0) {}
+};
+
+//! A scanned directory. Files and subdirectories are sorted by name.
+struct ZipScanDir
+{
+    QString path;       // Absolute path, without trailing separator
+    ZipScanEntry entry;
+    QVector<ZipScanEntry> files;
+    QList<ZipScanDir*> dirs;
+
+    ~ZipScanDir() { qDeleteAll(dirs); }
+};
+
+/*!
+    Walks a directory tree, scanning subdirectories in parallel (one task per
+    directory in a private thread pool). Entries are filtered while walking:
+    excluded directories are not entered at all.
+
+    Like QDir::entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot |
+    QDir::NoSymLinks), hidden files, symbolic links and special files are skipped.
+*/
+class ZipDirScanner
+{
+public:
+    ZipDirScanner(const QStringList& include, const QStringList& exclude);
+
+    //! Scans \p path recursively. Returns 0 if \p path is not a directory.
+    ZipScanDir* scan(const QString& path);
+
+    /*! Returns true if \p str matches the wildcard \p pattern ('*' matches any
+        sequence, including separators, '?' any character and [...] a set).
+    */
+    static bool wildcardMatch(const QString& pattern, const QString& str);
+
+private:
+    friend class ZipScanTask;
+
+    void scanDir(ZipScanDir* dir, const QString& relative, QThreadPool* pool);
+    void listDir(ZipScanDir* dir, const QString& relative);
+    void addEntry(ZipScanDir* dir, const QString& relative, const QString& name,
+        bool isDir, qint64 size, uint modified);
+    bool matches(const QStringList& patterns, const QString& name, const QString& relative) const;
+    static bool prune(ZipScanDir* dir);
+
+    QStringList includes;
+    QStringList excludes;
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPSCANNER_P__H
@@ -0,0 +1,267 @@
+/****************************************************************************
+** Filename: zipsearch.cpp
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Incremental content search of archive entries for the UnZip class.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+
+#include "zipsearch_p.h"
+
+#include <string.h>
+
+//! Lines longer than this are scanned in pieces
+#define ZIP_SEARCH_MAX_LINE (64*1024)
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+namespace {
+
+inline char foldAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+inline bool isAscii(const QByteArray& s)
+{
+    for (int i = 0; i < s.size(); ++i)
+        if (uchar(s.at(i)) >= 0x80)
+            return false;
+    return true;
+}
+
+//! \internal Compares \p data to the lower case \p folded ignoring ASCII case.
+bool equalFolded(const char* data, const char* folded, int size)
+{
+    for (int i = 0; i < size; ++i)
+        if (foldAscii(data[i]) != folded[i])
+            return false;
+    return true;
+}
+
+}
+
+ZipSearchSink::ZipSearchSink(const QString& pattern, UnZip::SearchOptions options) :
+    regExp(options & UnZip::SearchRegExp),
+    foldCase(false),
+    offset(0),
+    lines(0),
+    blockBegin(0),
+    blockOffset(0)
+{
+    if (!regExp) {
+        literal = pattern.toUtf8();
+        if (options & UnZip::SearchCaseInsensitive) {
+            // Only ASCII folds byte by byte
+            foldCase = isAscii(literal);
+            regExp = !foldCase;
+            for (int i = 0; foldCase && i < literal.size(); ++i)
+                literal[i] = foldAscii(literal.at(i));
+        }
+    }
+
+    if (regExp) {
+        literal.clear();
+        // Case insensitive non-ASCII literals are escaped regular expressions
+#if QT_VERSION >= 0x050000
+        const QString rx = (options & UnZip::SearchRegExp) ? pattern : QRegularExpression::escape(pattern);
+        expression = QRegularExpression(rx, (options & UnZip::SearchCaseInsensitive)
+            ? QRegularExpression::CaseInsensitiveOption : QRegularExpression::NoPatternOption);
+#else
+        const QString rx = (options & UnZip::SearchRegExp) ? pattern : QRegExp::escape(pattern);
+        expression = QRegExp(rx, (options & UnZip::SearchCaseInsensitive)
+            ? Qt::CaseInsensitive : Qt::CaseSensitive, QRegExp::RegExp2);
+#endif
+    }
+
+    open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+}
+
+bool ZipSearchSink::isValid() const
+{
+    return regExp ? expression.isValid() && !expression.pattern().isEmpty() : !literal.isEmpty();
+}
+
+void ZipSearchSink::start(const QString& name)
+{
+    entry = name;
+    found.clear();
+    pending.clear();
+    offset = 0;
+    lines = 0;
+}
+
+void ZipSearchSink::finish()
+{
+    if (!pending.isEmpty())
+        scan(pending.constData(), pending.constData() + pending.size());
+    pending.clear();
+}
+
+qint64 ZipSearchSink::readData(char* data, qint64 maxlen)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxlen);
+    return -1;
+}
+
+qint64 ZipSearchSink::writeData(const char* data, qint64 len)
+{
+    const char* p = data;
+    const char* const end = data + len;
+
+    // Completes the partial line of the previous write
+    if (!pending.isEmpty()) {
+        const char* nl = (const char*) memchr(p, '\n', end - p);
+        const char* const stop = nl ? nl + 1 : end;
+        pending.append(p, int(stop - p));
+        p = stop;
+        if (!nl && pending.size() < ZIP_SEARCH_MAX_LINE)
+            return len;
+        scan(pending.constData(), pending.constData() + pending.size());
+        pending.clear();
+    }
+
+    // Whole lines are scanned in place
+    const char* stop = end;
+    while (stop > p && stop[-1] != '\n')
+        --stop;
+    if (stop == p && end - p >= ZIP_SEARCH_MAX_LINE)
+        stop = end;
+    if (stop > p)
+        scan(p, stop);
+
+    pending.append(stop, int(end - stop));
+    return len;
+}
+
+//! Scans a block of whole lines (or a piece of a long line) following the previous block.
+void ZipSearchSink::scan(const char* begin, const char* end)
+{
+    blockBegin = begin;
+    blockOffset = offset;
+    if (regExp)
+        scanRegExp(begin, end);
+    else scanLiteral(begin, end);
+    offset += end - begin;
+}
+
+void ZipSearchSink::scanLiteral(const char* begin, const char* end)
+{
+    const char first = literal.at(0);
+    // Upper case first byte of a folded literal
+    const char other = (foldCase && first >= 'a' && first <= 'z') ? char(first - ('a' - 'A')) : first;
+    const int size = literal.size();
+    const char* counted = begin;
+
+    const char* p = begin;
+    while (end - p >= size) {
+        // Candidates by first byte, then a full compare
+        const qint64 span = (end - p) - size + 1;
+        const char* match = (const char*) memchr(p, first, span);
+        if (other != first) {
+            const char* upper = (const char*) memchr(p, other, match ? match - p : span);
+            if (upper)
+                match = upper;
+        }
+        if (!match)
+            break;
+        if (foldCase ? !equalFolded(match + 1, literal.constData() + 1, size - 1)
+                : memcmp(match + 1, literal.constData() + 1, size - 1)) {
+            p = match + 1;
+            continue;
+        }
+
+        countLines(counted, match);
+        counted = match;
+
+        const char* line = match;
+        while (line > begin && line[-1] != '\n')
+            --line;
+        const char* lineEnd = (const char*) memchr(match, '\n', end - match);
+        if (!lineEnd)
+            lineEnd = end;
+
+        addHit(line, lineEnd, match);
+
+        // One hit per line
+        p = lineEnd;
+    }
+
+    countLines(counted, end);
+}
+
+void ZipSearchSink::scanRegExp(const char* begin, const char* end)
+{
+    const char* line = begin;
+    while (line < end) {
+        const char* lineEnd = (const char*) memchr(line, '\n', end - line);
+        if (!lineEnd)
+            lineEnd = end;
+        const char* textEnd = lineEnd;
+        if (textEnd > line && textEnd[-1] == '\r')
+            --textEnd;
+
+        const QString text = QString::fromUtf8(line, int(textEnd - line));
+#if QT_VERSION >= 0x050000
+        const QRegularExpressionMatch match = expression.match(text);
+        const int index = match.hasMatch() ? match.capturedStart() : -1;
+#else
+        const int index = expression.indexIn(text);
+#endif
+        if (index >= 0)
+            addHit(line, lineEnd, line + text.left(index).toUtf8().size());
+
+        if (lineEnd == end)
+            break;
+        ++lines;
+        line = lineEnd + 1;
+    }
+}
+
+//! Adds the line breaks in [begin, end) to the line count.
+void ZipSearchSink::countLines(const char* begin, const char* end)
+{
+    while (begin < end) {
+        begin = (const char*) memchr(begin, '\n', end - begin);
+        if (!begin)
+            break;
+        ++lines;
+        ++begin;
+    }
+}
+
+void ZipSearchSink::addHit(const char* line, const char* lineEnd, const char* match)
+{
+    if (lineEnd > line && lineEnd[-1] == '\r')
+        --lineEnd;
+
+    UnZip::SearchHit hit;
+    hit.filename = entry;
+    hit.offset = blockOffset + (match - blockBegin);
+    hit.line = lines + 1;
+    hit.text = QByteArray(line, int(lineEnd - line));
+    found.append(hit);
+}
+
+OSDAB_END_NAMESPACE
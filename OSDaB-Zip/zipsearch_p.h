@@ -0,0 +1,125 @@
+/****************************************************************************
+** Filename: zipsearch_p.h
+** Last updated [dd/mm/yyyy]: 19/10/2026
+**
+** Incremental content search of archive entries for the UnZip class.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+
+#ifndef OSDAB_ZIPSEARCH_P__H
+#define OSDAB_ZIPSEARCH_P__H
+
+#include "zipglobal.h"
+#include "unzip.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QtGlobal>
+
+#if QT_VERSION >= 0x050000
+#include <QtCore/QRegularExpression>
+#else
+#include <QtCore/QRegExp>
+#endif
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/*!
+    Write only device scanning the data written to it (the output of
+    UnZip's decompressor) for a literal or a regular expression and
+    collecting one hit per matching line. Complete lines are scanned
+    straight from the written data; only the last, partial line is kept
+    until the next write. Lines longer than 64K are scanned in pieces.
+    Literals are searched with memchr() and memcmp(), which use SIMD
+    instructions in most C libraries; case insensitive ASCII literals
+    look for both cases of their first byte and compare the rest folded.
+    Regular expressions and case insensitive non-ASCII literals are
+    matched line by line on the UTF-8 decoded text.
+    Every worker thread needs its own device.
+*/
+class ZipSearchSink : public QIODevice
+{
+public:
+    ZipSearchSink(const QString& pattern, UnZip::SearchOptions options);
+
+    //! False if the regular expression is not valid.
+    bool isValid() const;
+
+    //! Starts scanning a new entry and clears the hits.
+    void start(const QString& entry);
+    //! Scans the last line of the entry.
+    void finish();
+
+    inline const QList<UnZip::SearchHit>& hits() const { return found; }
+
+protected:
+    qint64 readData(char* data, qint64 maxlen);
+    qint64 writeData(const char* data, qint64 len);
+
+private:
+    void scan(const char* begin, const char* end);
+    void scanLiteral(const char* begin, const char* end);
+    void scanRegExp(const char* begin, const char* end);
+    void countLines(const char* begin, const char* end);
+    void addHit(const char* line, const char* lineEnd, const char* match);
+
+    bool regExp;
+    // ASCII case folding of a literal, stored in lower case
+    bool foldCase;
+    QByteArray literal;
+#if QT_VERSION >= 0x050000
+    QRegularExpression expression;
+#else
+    QRegExp expression;
+#endif
+
+    QString entry;
+    QList<UnZip::SearchHit> found;
+    // Partial line and its offset in the entry
+    QByteArray pending;
+    qint64 offset;
+    // Line breaks before offset (plus those counted in the block being scanned)
+    qint64 lines;
+    // Offset of the block being scanned
+    const char* blockBegin;
+    qint64 blockOffset;
+
+    Q_DISABLE_COPY(ZipSearchSink)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPSEARCH_P__H
@@ -0,0 +1,136 @@
+/****************************************************************************
+** Filename: ziptrace_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Trace points and diagnostics of the Zip and UnZip classes.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPTRACE_P__H
+#define OSDAB_ZIPTRACE_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QtDebug>
+#include <QtCore/QtGlobal>
+
+/*! #define OSDAB_ZIP_NO_TRACE to compile out the trace points.
+    Otherwise, with Qt 5.4 or later, trace events are logged (disabled by
+    default) in the "osdab.zip" and "osdab.unzip" logging categories and
+    warnings in the same categories (enabled by default).
+    With older Qt versions there are no trace events and warnings go to qDebug().
+*/
+// #define OSDAB_ZIP_NO_TRACE
+
+#if QT_VERSION >= 0x050400 && !defined(OSDAB_ZIP_NO_TRACE)
+#define ZIP_TRACE_CATEGORIES
+#endif
+
+#ifdef ZIP_TRACE_CATEGORIES
+
+#include <QtCore/QLoggingCategory>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+Q_DECLARE_LOGGING_CATEGORY(OSDAB_ZIP_MANGLE(zipLog))
+Q_DECLARE_LOGGING_CATEGORY(OSDAB_ZIP_MANGLE(unzipLog))
+
+OSDAB_END_NAMESPACE
+
+//! True if the trace events of \p category are being logged.
+#define ZIP_TRACE_ENABLED(category) OSDAB_ZIP_MANGLE(category)().isDebugEnabled()
+/*! Stream for a trace event: "event field=value field=value...".
+    Nothing after the macro is evaluated if the category is disabled.
+*/
+#define ZIP_TRACE(category) qCDebug(OSDAB_ZIP_MANGLE(category)).nospace()
+//! Stream for a warning; nothing after the macro is evaluated if the category is disabled.
+#define ZIP_WARNING(category) qCWarning(OSDAB_ZIP_MANGLE(category))
+
+#else
+
+#define ZIP_TRACE_ENABLED(category) false
+#define ZIP_TRACE(category) while (false) qDebug()
+#define ZIP_WARNING(category) qDebug()
+
+#endif // ZIP_TRACE_CATEGORIES
+
+#if QT_VERSION >= 0x040800
+#include <QtCore/QElapsedTimer>
+#endif
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+//! Measures the duration of a traced operation; does nothing if tracing is disabled.
+class ZipTraceTimer
+{
+public:
+#ifdef ZIP_TRACE_CATEGORIES
+    explicit ZipTraceTimer(bool enabled) { if (enabled) timer.start(); else timer.invalidate(); }
+    inline qint64 usecs() const { return timer.isValid() ? timer.nsecsElapsed() / 1000 : 0; }
+
+private:
+    QElapsedTimer timer;
+#else
+    explicit ZipTraceTimer(bool) {}
+    inline qint64 usecs() const { return 0; }
+#endif
+};
+
+//! Splits the duration of an operation in stages for ZipStatistics; does nothing before Qt 4.8.
+class ZipStopwatch
+{
+public:
+#if QT_VERSION >= 0x040800
+    ZipStopwatch() : last(0) { timer.start(); }
+    //! Adds the time elapsed since the previous lap (or since construction) to \p nsecs.
+    inline void lap(qint64& nsecs)
+    {
+        const qint64 now = timer.nsecsElapsed();
+        nsecs += now - last;
+        last = now;
+    }
+    //! Starts the next lap without accounting the time elapsed since the previous one.
+    inline void restart() { last = timer.nsecsElapsed(); }
+
+private:
+    QElapsedTimer timer;
+    qint64 last;
+#else
+    inline void lap(qint64&) {}
+    inline void restart() {}
+#endif
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPTRACE_P__H
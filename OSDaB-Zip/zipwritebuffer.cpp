@@ -0,0 +1,103 @@
+/****************************************************************************
+** Filename: zipwritebuffer.cpp
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Write-combining buffer used by the Zip class for headers and the central directory.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+#include "zipwritebuffer_p.h"
+
+#include <QtCore/QIODevice>
+
+#include <cstring>
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+ZipWriteBuffer::ZipWriteBuffer(int size) :
+    dev(0),
+    data(new char[size]),
+    capacity(size),
+    used(0)
+{
+    Q_ASSERT(size > 0);
+}
+
+ZipWriteBuffer::~ZipWriteBuffer()
+{
+    delete[] data;
+}
+
+void ZipWriteBuffer::setDevice(QIODevice* device)
+{
+    dev = device;
+    used = 0;
+}
+
+bool ZipWriteBuffer::write(const char* buffer, qint64 len)
+{
+    Q_ASSERT(dev);
+
+    // Large blocks don't need to be copied
+    if (len >= capacity) {
+        if (!flush())
+            return false;
+        return dev->write(buffer, len) == len;
+    }
+
+    while (len > 0) {
+        // Room left before the next multiple of capacity (sequential
+        // devices have no position: the whole buffer is used)
+        const qint64 end = dev->isSequential() ? used : dev->pos() + used;
+        const qint64 room = capacity - end % capacity;
+        const qint64 n = qMin(len, room);
+
+        memcpy(data + used, buffer, n);
+        used += n;
+        buffer += n;
+        len -= n;
+
+        if (n == room && !flush())
+            return false;
+    }
+
+    return true;
+}
+
+bool ZipWriteBuffer::flush()
+{
+    if (!used)
+        return true;
+
+    Q_ASSERT(dev);
+    const qint64 written = dev->write(data, used);
+    const bool ok = written == used;
+    used = 0;
+    return ok;
+}
+
+qint64 ZipWriteBuffer::pos() const
+{
+    return dev ? dev->pos() + used : used;
+}
+
+OSDAB_END_NAMESPACE
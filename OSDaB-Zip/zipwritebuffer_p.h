@@ -0,0 +1,93 @@
+/****************************************************************************
+** Filename: zipwritebuffer_p.h
+** Last updated [dd/mm/yyyy]: 18/10/2026
+**
+** Write-combining buffer used by the Zip class for headers and the central directory.
+**
+** Some of the code has been inspired by other open source projects,
+** (mainly Info-Zip and Gilles Vollant's minizip).
+** Compression and decompression actually uses the zlib library.
+**
+** Copyright (C) 2007-2016 Angius Fabrizio. All rights reserved.
+**
+** This file is part of the OSDaB project (http://osdab.42cows.org/).
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See the file LICENSE.GPL that came with this software distribution or
+** visit http://www.gnu.org/licenses/gpl-3.0.en.html for GPL licensing information.
+**
+**********************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Zip/UnZip API.  It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef OSDAB_ZIPWRITEBUFFER_P__H
+#define OSDAB_ZIPWRITEBUFFER_P__H
+
+#include "zipglobal.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtGlobal>
+
+class QIODevice;
+
+//! Size (and alignment in the device) of the writes issued by ZipWriteBuffer
+#define ZIP_WRITE_BUFFER (64*1024)
+
+OSDAB_BEGIN_NAMESPACE(Zip)
+
+/*!
+    Collects the small writes of headers, data descriptors and central
+    directory records and passes them to the device in large writes that end
+    on a multiple of the buffer size (relative to the start of the device).
+    Nothing else may write to or seek the device while data is pending:
+    call flush() first.
+*/
+class ZipWriteBuffer
+{
+public:
+    explicit ZipWriteBuffer(int capacity = ZIP_WRITE_BUFFER);
+    ~ZipWriteBuffer();
+
+    //! Sets the target device. Pending data is discarded.
+    void setDevice(QIODevice* device);
+    inline QIODevice* device() const { return dev; }
+
+    //! Appends \p len bytes. Returns false if a write to the device failed.
+    bool write(const char* data, qint64 len);
+    inline bool write(const QByteArray& data) { return write(data.constData(), data.size()); }
+
+    //! Writes out the pending data. Returns false if the write failed.
+    bool flush();
+
+    //! Position in the device of the next byte written, pending data included.
+    qint64 pos() const;
+    inline int pending() const { return used; }
+
+private:
+    QIODevice* dev;
+    char* data;
+    int capacity;
+    int used;
+
+    Q_DISABLE_COPY(ZipWriteBuffer)
+};
+
+OSDAB_END_NAMESPACE
+
+#endif // OSDAB_ZIPWRITEBUFFER_P__H
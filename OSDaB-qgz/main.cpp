@@ -2,7 +2,7 @@
 #include <QFileDialog>
 #include <QDataStream>
 #include <QMessageBox>
-#include "zlib/zlib.h"
+#include "gzbackend.h"
 
 #define UNZIP_READ_BUFFER (256*1024)
 
@@ -64,6 +64,18 @@ bool inflate(const QString& s)
 	decompressedFileName = outFileName;
 	QDataStream dev(&out);
 
+#ifdef OSDAB_LIBDEFLATE
+	QByteArray whole;
+	if (inflateWholeFile(file, whole)) {
+		if (dev.writeRawData(whole.constData(), whole.size()) != whole.size()) {
+			qDebug("Write error");
+			return false;
+		}
+		return true;
+	}
+	file.seek(0);
+#endif
+
 	quint64 compressedSize = file.size();
 
 	uInt rep = compressedSize / UNZIP_READ_BUFFER;
@@ -78,7 +90,7 @@ bool inflate(const QString& s)
 	char buffer2[UNZIP_READ_BUFFER];
 
 	/* Allocate inflate state */
-	z_stream zstr;
+	gz_z_stream zstr;
 	zstr.zalloc = Z_NULL;
 	zstr.zfree = Z_NULL;
 	zstr.opaque = Z_NULL;
@@ -94,7 +106,7 @@ bool inflate(const QString& s)
 	return a Z_DATA_ERROR.  If a gzip stream is being decoded, strm->adler is
 	a crc32 instead of an adler32.
 	*/
-	if ( (zret = inflateInit2_(&zstr, MAX_WBITS + 16, ZLIB_VERSION, sizeof(z_stream))) != Z_OK ) {
+	if ( (zret = GZ_Z(inflateInit2)(&zstr, MAX_WBITS + 16)) != Z_OK ) {
 		qDebug("Failed to initialize zlib");
 		return false;
 	}
@@ -109,7 +121,7 @@ bool inflate(const QString& s)
 			break;
 		if (read < 0)
 		{
-			(void)inflateEnd(&zstr);
+			(void)GZ_Z(inflateEnd)(&zstr);
 			qDebug("Read error");
 			return false;
 		}
@@ -126,13 +138,13 @@ bool inflate(const QString& s)
 			zstr.avail_out = UNZIP_READ_BUFFER;
 			zstr.next_out = (Bytef*) buffer2;;
 
-			zret = inflate(&zstr, Z_NO_FLUSH);
+			zret = GZ_Z(inflate)(&zstr, Z_NO_FLUSH);
 
 			switch (zret) {
 				case Z_NEED_DICT:
 				case Z_DATA_ERROR:
 				case Z_MEM_ERROR:
-					inflateEnd(&zstr);
+					GZ_Z(inflateEnd)(&zstr);
 					qDebug("zlib failed to decode file");
 					return false;
 				default:
@@ -142,7 +154,7 @@ bool inflate(const QString& s)
 			szDecomp = UNZIP_READ_BUFFER - zstr.avail_out;
 			if (dev.writeRawData(buffer2, szDecomp) != szDecomp)
 			{
-				inflateEnd(&zstr);
+				GZ_Z(inflateEnd)(&zstr);
 				qDebug("Write error");
 				return false;
 			}
@@ -152,7 +164,7 @@ bool inflate(const QString& s)
 	}
 	while (zret != Z_STREAM_END);
 
-	inflateEnd(&zstr);
+	GZ_Z(inflateEnd)(&zstr);
 
 	return true;
 }
@@ -11,4 +11,9 @@ QMAKE_TARGET_PRODUCT = qgz
 QMAKE_TARGET_COPYRIGHT = Copyright (C) 2007 Angius Fabrizio - GNU GPL v2 or later
 QMAKE_TARGET_DESCRIPTION = Qt gzip test application.
 
+HEADERS = gzbackend.h
 SOURCES = main.cpp
+
+# Optional faster deflate backends (see the comments in the sources)
+# DEFINES += OSDAB_ZLIB_NG OSDAB_LIBDEFLATE
+# LIBS += -lz-ng -ldeflate